@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <common/integer.hpp>
 #include <memory>
 
 #include "stereo.hpp"
@@ -25,10 +26,16 @@ struct RingBuffer : Stream<T> {
 
   auto Available() -> int { return count; }
 
+  /// Values that were written and values that were dropped because the (blocking) buffer was full.
+  auto GetWriteCount() const -> u64 { return writes; }
+  auto GetDropCount() const -> u64 { return drops; }
+
   void Reset() {
     rd_ptr = 0;
     wr_ptr = 0;
     count  = 0;
+    writes = 0;
+    drops  = 0;
     // Zero-initialize to avoid reading garbage when reading from an empty buffer.
     for (int i = 0; i < length; i++) {
       data[i] = {};
@@ -50,11 +57,13 @@ struct RingBuffer : Stream<T> {
 
   void Write(T const& value) {
     if (blocking && count == length) {
+      drops++;
       return;
     }
     data[wr_ptr] = value;
     wr_ptr = (wr_ptr + 1) % length;
     count++;
+    writes++;
   }
 
 private:
@@ -65,6 +74,8 @@ private:
   int length;
   int count;
   bool blocking;
+  u64 writes;
+  u64 drops;
 };
 
 template <typename T>
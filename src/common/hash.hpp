@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+#include <common/punning.hpp>
+#include <stddef.h>
+
+namespace common {
+
+namespace detail {
+
+constexpr u64 kXXH64Prime1 = 0x9E3779B185EBCA87ULL;
+constexpr u64 kXXH64Prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr u64 kXXH64Prime3 = 0x165667B19E3779F9ULL;
+constexpr u64 kXXH64Prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr u64 kXXH64Prime5 = 0x27D4EB2F165667C5ULL;
+
+inline auto rotl64(u64 value, int amount) -> u64 {
+  return (value << amount) | (value >> (64 - amount));
+}
+
+inline auto xxh64_round(u64 acc, u64 input) -> u64 {
+  acc += input * kXXH64Prime2;
+  return rotl64(acc, 31) * kXXH64Prime1;
+}
+
+inline auto xxh64_merge(u64 acc, u64 value) -> u64 {
+  acc ^= xxh64_round(0, value);
+  return acc * kXXH64Prime1 + kXXH64Prime4;
+}
+
+} // namespace common::detail
+
+/**
+ * Computes the 64-bit xxHash (XXH64) of a buffer.
+ * Assumes a little-endian host.
+ */
+inline auto xxh64(void const* data, size_t size, u64 seed = 0) -> u64 {
+  using namespace detail;
+
+  auto bytes = (u8 const*)data;
+  size_t offset = 0;
+  u64 hash;
+
+  if (size >= 32) {
+    u64 v1 = seed + kXXH64Prime1 + kXXH64Prime2;
+    u64 v2 = seed + kXXH64Prime2;
+    u64 v3 = seed;
+    u64 v4 = seed - kXXH64Prime1;
+
+    for (; offset + 32 <= size; offset += 32) {
+      v1 = xxh64_round(v1, read<u64>(bytes, offset +  0));
+      v2 = xxh64_round(v2, read<u64>(bytes, offset +  8));
+      v3 = xxh64_round(v3, read<u64>(bytes, offset + 16));
+      v4 = xxh64_round(v4, read<u64>(bytes, offset + 24));
+    }
+
+    hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    hash = xxh64_merge(hash, v1);
+    hash = xxh64_merge(hash, v2);
+    hash = xxh64_merge(hash, v3);
+    hash = xxh64_merge(hash, v4);
+  } else {
+    hash = seed + kXXH64Prime5;
+  }
+
+  hash += size;
+
+  for (; offset + 8 <= size; offset += 8) {
+    hash ^= xxh64_round(0, read<u64>(bytes, offset));
+    hash  = rotl64(hash, 27) * kXXH64Prime1 + kXXH64Prime4;
+  }
+
+  if (offset + 4 <= size) {
+    hash ^= read<u32>(bytes, offset) * kXXH64Prime1;
+    hash  = rotl64(hash, 23) * kXXH64Prime2 + kXXH64Prime3;
+    offset += 4;
+  }
+
+  for (; offset < size; offset++) {
+    hash ^= bytes[offset] * kXXH64Prime5;
+    hash  = rotl64(hash, 11) * kXXH64Prime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kXXH64Prime2;
+  hash ^= hash >> 29;
+  hash *= kXXH64Prime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+} // namespace common
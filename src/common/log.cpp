@@ -5,15 +5,72 @@
  * Refer to the included LICENSE file.
  */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "log.hpp"
 
 #ifdef WIN32
 #include <stdio.h>
 #include <windows.h>
+#else
+#include <unistd.h>
 #endif
 
 namespace common::logger {
 
+/**
+ * Messages of one thread, which is the only one to write to it, while the writer thread reads from it.
+ * If the writer falls behind, the thread writes the pending messages itself.
+ */
+struct Ring {
+  static constexpr size_t kCapacity = 1024;
+
+  struct Slot {
+    alignas(std::max_align_t) unsigned char storage[detail::kSlotSize];
+    /// Points into the storage, unless the message did not fit and was allocated.
+    detail::Message* message;
+    bool in_place;
+  };
+
+  std::array<Slot, kCapacity> slots;
+  std::atomic<size_t> head = 0;
+  std::atomic<size_t> tail = 0;
+};
+
+/// The most recently written lines, which are printed again if the program crashes.
+struct Tail {
+  static constexpr int kLength = 32;
+  static constexpr int kLineLength = 256;
+
+  char lines[kLength][kLineLength];
+  int next = 0;
+  int count = 0;
+};
+
+static thread_local Sink t_sink;
+static thread_local std::shared_ptr<Ring> t_ring;
+
+static std::mutex g_rings_lock;
+static std::vector<std::shared_ptr<Ring>> g_rings;
+
+static std::mutex g_writer_lock;
+static std::condition_variable g_writer_wakeup;
+static bool g_stop_writer;
+static std::atomic_bool g_writer_running = false;
+static std::atomic_bool g_writer_stopped = false;
+static Tail g_tail;
+
 auto trim_filepath(const char* file) -> std::string {
   auto tmp = std::string{file};
 #ifdef WIN32
@@ -27,6 +84,154 @@ auto trim_filepath(const char* file) -> std::string {
   return tmp.substr(pos);
 }
 
+static auto format(detail::Message const& message) -> std::string {
+  try {
+    return message.Format();
+  } catch (fmt::format_error const& error) {
+    return fmt::format("(bad log message \"{0}\": {1})", message.format, error.what());
+  }
+}
+
+static void write(detail::Message const& message) {
+  const char* prefix = "";
+
+  switch (message.level) {
+    case Level::Trace:
+      prefix = "\e[36m[T]";
+      break;
+    case Level::Debug:
+      prefix = "\e[34m[D]";
+      break;
+    case Level::Info:
+      prefix = "\e[37m[I]";
+      break;
+    case Level::Warn:
+      prefix = "\e[33m[W]";
+      break;
+    case Level::Error:
+      prefix = "\e[35m[E]";
+      break;
+    case Level::Fatal:
+      prefix = "\e[31m[F]";
+      break;
+  }
+
+  auto line = fmt::format("{0} {1}:{2} [{3}]: {4}\e[39m\n", prefix, trim_filepath(message.file), message.line, message.function, format(message));
+
+  std::fwrite(line.data(), 1, line.size(), stdout);
+
+  auto& tail = g_tail.lines[g_tail.next];
+  auto length = std::min(line.size(), size_t(Tail::kLineLength - 1));
+  std::memcpy(tail, line.data(), length);
+  tail[length] = '\0';
+  g_tail.next = (g_tail.next + 1) % Tail::kLength;
+  g_tail.count = std::min(g_tail.count + 1, Tail::kLength);
+}
+
+/// Writes the messages that were logged so far, must hold g_writer_lock.
+static void drain() {
+  auto rings = std::vector<std::shared_ptr<Ring>>{};
+  {
+    std::lock_guard guard{g_rings_lock};
+    rings = g_rings;
+  }
+
+  for (auto& ring : rings) {
+    auto head = ring->head.load(std::memory_order_acquire);
+    auto tail = ring->tail.load(std::memory_order_relaxed);
+
+    for (; tail != head; tail++) {
+      auto& slot = ring->slots[tail % Ring::kCapacity];
+      write(*slot.message);
+      if (slot.in_place) {
+        slot.message->~Message();
+      } else {
+        delete slot.message;
+      }
+    }
+    ring->tail.store(head, std::memory_order_release);
+  }
+
+  std::fflush(stdout);
+
+  // Forget the rings of threads that have exited, which are only held by g_rings and the copy above.
+  std::lock_guard guard{g_rings_lock};
+  for (auto it = g_rings.begin(); it != g_rings.end();) {
+    if (it->use_count() == 2 && (*it)->head == (*it)->tail) {
+      it = g_rings.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+static void run_writer() {
+  std::unique_lock lock{g_writer_lock};
+
+  while (!g_stop_writer) {
+    drain();
+    g_writer_wakeup.wait_for(lock, std::chrono::milliseconds{20});
+  }
+  drain();
+}
+
+/// Owns the writer thread, which is stopped when the program exits, after writing the remaining messages.
+static struct Writer {
+  void Start() {
+    std::lock_guard guard{g_writer_lock};
+    if (!thread.joinable()) {
+      g_stop_writer = false;
+      thread = std::thread{run_writer};
+      g_writer_running = true;
+    }
+  }
+
+ ~Writer() {
+    {
+      std::lock_guard guard{g_writer_lock};
+      if (!thread.joinable()) {
+        return;
+      }
+      g_writer_running = false;
+      g_writer_stopped = true;
+      g_stop_writer = true;
+    }
+    g_writer_wakeup.notify_one();
+    thread.join();
+  }
+
+  std::thread thread;
+} g_writer;
+
+static auto get_ring() -> Ring& {
+  if (!t_ring) {
+    t_ring = std::make_shared<Ring>();
+    std::lock_guard guard{g_rings_lock};
+    g_rings.push_back(t_ring);
+  }
+  return *t_ring;
+}
+
+#ifndef WIN32
+static void write_raw(const char* text) {
+  [[maybe_unused]] auto result = ::write(STDERR_FILENO, text, std::strlen(text));
+}
+
+/**
+ * Prints the last lines that were written, since the console output may not have been flushed.
+ * Messages that were not formatted yet are lost, since formatting is not safe in a signal handler.
+ */
+static void on_crash(int signal) {
+  write_raw("\n\e[31mCrashed, the last log messages were:\e[39m\n");
+  for (int i = 0; i < g_tail.count; i++) {
+    write_raw(g_tail.lines[(g_tail.next - g_tail.count + i + Tail::kLength) % Tail::kLength]);
+  }
+
+  std::signal(signal, SIG_DFL);
+  std::raise(signal);
+}
+#endif
+
 void init() {
 #ifdef WIN32
   // We require ANSI escape sequences for colored output.
@@ -47,38 +252,94 @@ void init() {
   freopen ("log.txt", "w", stdout);
 #endif
 
+#else
+  for (auto signal : { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT }) {
+    std::signal(signal, on_crash);
+  }
 #endif
 }
 
-void append(Level level,
-            const char* file,
-            const char* function,
-            int line,
-            std::string const& message) {
-  std::string prefix;
+void flush() {
+  std::lock_guard guard{g_writer_lock};
+  drain();
+}
 
-  switch (level) {
-    case Level::Trace:
-      prefix = "\e[36m[T]";
-      break;
-    case Level::Debug:
-      prefix = "\e[34m[D]";
-      break;
-    case Level::Info:
-      prefix = "\e[37m[I]";
-      break;
-    case Level::Warn:
-      prefix = "\e[33m[W]";
-      break;
-    case Level::Error:
-      prefix = "\e[35m[E]";
-      break;
-    case Level::Fatal:
-      prefix = "\e[31m[F]";
-      break;
+void set_thread_sink(Sink sink) {
+  t_sink = std::move(sink);
+}
+
+/// Whether messages are queued for the writer thread rather than written right away.
+static bool queue_messages() {
+  if (t_sink || g_writer_stopped) {
+    return false;
+  }
+  if (!g_writer_running) {
+    g_writer.Start();
+  }
+  return true;
+}
+
+static void push(detail::Message* message, bool in_place) {
+  auto& ring = get_ring();
+  auto head = ring.head.load(std::memory_order_relaxed);
+  auto used = head - ring.tail.load(std::memory_order_acquire);
+
+  // Write the pending messages right away if the writer falls behind.
+  if (used == Ring::kCapacity) {
+    flush();
+  }
+
+  auto level = message->level;
+  auto& slot = ring.slots[head % Ring::kCapacity];
+
+  slot.message = message;
+  slot.in_place = in_place;
+  ring.head.store(head + 1, std::memory_order_release);
+
+  // Warnings and errors should not wait for the next periodic write, since the program may be about to exit.
+  if (level >= Level::Warn || used == Ring::kCapacity / 2) {
+    g_writer_wakeup.notify_one();
+  }
+}
+
+auto detail::acquire_slot() -> void* {
+  if (!queue_messages()) {
+    return nullptr;
+  }
+
+  auto& ring = get_ring();
+  auto head = ring.head.load(std::memory_order_relaxed);
+
+  // The slot at the head is still in use if the ring is full.
+  if (head - ring.tail.load(std::memory_order_acquire) == Ring::kCapacity) {
+    flush();
+  }
+
+  return ring.slots[head % Ring::kCapacity].storage;
+}
+
+void detail::append_in_place(Message* message) {
+  push(message, true);
+}
+
+void detail::append(std::unique_ptr<Message> message) {
+  if (!queue_messages()) {
+    write_now(*message);
+    return;
+  }
+  push(message.release(), false);
+}
+
+void detail::write_now(Message const& message) {
+  if (t_sink) {
+    t_sink(message.level, fmt::format("{0}:{1} [{2}]: {3}", trim_filepath(message.file), message.line, message.function, format(message)));
+    return;
   }
 
-  fmt::print("{0} {1}:{2} [{3}]: {4}\e[39m\n", prefix, trim_filepath(file), line, function, message);
+  // Messages that are logged while the program exits are written right away.
+  std::lock_guard guard{g_writer_lock};
+  write(message);
+  std::fflush(stdout);
 }
 
 } // namespace common::logger
@@ -7,9 +7,16 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdlib>
 #include <fmt/format.h>
+#include <functional>
+#include <memory>
+#include <new>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 
 namespace common::logger {
 
@@ -22,32 +29,132 @@ enum class Level {
   Fatal
 };
 
+/**
+ * Messages below this level are removed at compile time, together with their arguments.
+ * Set through NBA_LOG_LEVEL (0 = trace to 5 = fatal), see the LOG_LEVEL option in CMake.
+ */
+#ifdef NBA_LOG_LEVEL
+static constexpr Level kMinLevel = Level(NBA_LOG_LEVEL);
+#else
+static constexpr Level kMinLevel = Level::Trace;
+#endif
+
+/**
+ * Enables colored output on Windows and installs a handler that,
+ * if the program crashes, prints the last messages that were logged.
+ */
 void init();
 
-void append(Level level,
-            const char* file,
-            const char* function,
-            int line,
-            std::string const& message);
+/// Blocks until every message that was logged so far has been written.
+void flush();
+
+using Sink = std::function<void(Level level, std::string const& line)>;
+
+/**
+ * Redirects all messages that are logged on the calling thread to a sink,
+ * e.g. to keep the log of each emulator instance on a thread pool apart.
+ * Messages for a sink are formatted and passed on right away, on the calling thread.
+ * An empty sink restores the console output.
+ */
+void set_thread_sink(Sink sink);
+
+namespace detail {
+
+/**
+ * Messages are formatted later, on the thread that writes them,
+ * so that logging only costs copying the arguments.
+ */
+struct Message {
+  Message(Level level, const char* format, const char* file, const char* function, int line)
+      : level(level)
+      , format(format)
+      , file(file)
+      , function(function)
+      , line(line) {
+  }
+
+  virtual ~Message() = default;
+
+  virtual auto Format() const -> std::string = 0;
+
+  Level level;
+  const char* format;
+  const char* file;
+  const char* function;
+  int line;
+};
+
+/// Strings that are referred to are copied, since they may be gone by the time the message is formatted.
+template<typename T>
+using Capture = std::conditional_t<
+  std::is_same_v<std::decay_t<T>, const char*> ||
+  std::is_same_v<std::decay_t<T>, char*> ||
+  std::is_same_v<std::decay_t<T>, std::string_view>, std::string, std::decay_t<T>>;
+
+template<typename... Args>
+struct FormatMessage final : Message {
+  FormatMessage(Level level, const char* format, const char* file, const char* function, int line, Args const&... args)
+      : Message(level, format, file, function, line)
+      , args(args...) {
+  }
+
+  auto Format() const -> std::string override {
+    return std::apply([this](auto const&... args) {
+      return fmt::vformat(format, fmt::make_format_args(args...));
+    }, args);
+  }
+
+  std::tuple<Capture<Args>...> args;
+};
+
+/// Messages that fit are constructed right in the ring of the logging thread, larger ones are allocated.
+static constexpr size_t kSlotSize = 128;
+
+/**
+ * Returns the storage of the next free slot in the ring of the calling thread,
+ * or nullptr if the message is to be written right away instead (see write_now()).
+ */
+auto acquire_slot() -> void*;
+
+/// Queues a message that was constructed in the slot returned by acquire_slot().
+void append_in_place(Message* message);
+
+/// Queues a message that did not fit into a slot.
+void append(std::unique_ptr<Message> message);
 
-#define LOG_TRACE(message, ...) common::logger::append(common::logger::Level::Trace, __FILE__, __func__, __LINE__, \
-                                                       fmt::format(message, ## __VA_ARGS__));
+/// Formats and writes a message on the calling thread, to its sink or the console.
+void write_now(Message const& message);
 
-#define LOG_DEBUG(message, ...) common::logger::append(common::logger::Level::Debug, __FILE__, __func__, __LINE__, \
-                                                       fmt::format(message, ## __VA_ARGS__));
+template<typename... Args>
+void log(Level level, const char* file, const char* function, int line, const char* format, Args const&... args) {
+  using Type = FormatMessage<Args...>;
 
-#define LOG_INFO(message, ...) common::logger::append(common::logger::Level::Info, __FILE__, __func__, __LINE__, \
-                                                      fmt::format(message, ## __VA_ARGS__));
+  if constexpr (sizeof(Type) <= kSlotSize && alignof(Type) <= alignof(std::max_align_t)) {
+    if (auto slot = acquire_slot()) {
+      append_in_place(new (slot) Type{level, format, file, function, line, args...});
+    } else {
+      write_now(Type{level, format, file, function, line, args...});
+    }
+  } else {
+    append(std::make_unique<Type>(level, format, file, function, line, args...));
+  }
+}
 
-#define LOG_WARN(message, ...) common::logger::append(common::logger::Level::Warn, __FILE__, __func__, __LINE__, \
-                                                      fmt::format(message, ## __VA_ARGS__));
+} // namespace detail
 
-#define LOG_ERROR(message, ...) common::logger::append(common::logger::Level::Error, __FILE__, __func__, __LINE__, \
-                                                       fmt::format(message, ## __VA_ARGS__));
+#define LOG_AT(level, message, ...) do { \
+    if constexpr (common::logger::Level::level >= common::logger::kMinLevel) { \
+      common::logger::detail::log(common::logger::Level::level, __FILE__, __func__, __LINE__, message, ## __VA_ARGS__); \
+    } \
+  } while (0)
 
-#define LOG_FATAL(message, ...) common::logger::append(logger::detail::Level::Fatal, __FILE__, __func__, __LINE__, \
-                                                       fmt::format(message, ## __VA_ARGS__));
+#define LOG_TRACE(message, ...) LOG_AT(Trace, message, ## __VA_ARGS__);
+#define LOG_DEBUG(message, ...) LOG_AT(Debug, message, ## __VA_ARGS__);
+#define LOG_INFO(message, ...)  LOG_AT(Info,  message, ## __VA_ARGS__);
+#define LOG_WARN(message, ...)  LOG_AT(Warn,  message, ## __VA_ARGS__);
+#define LOG_ERROR(message, ...) LOG_AT(Error, message, ## __VA_ARGS__);
+#define LOG_FATAL(message, ...) LOG_AT(Fatal, message, ## __VA_ARGS__);
 
-#define ASSERT(condition, message, ...) if (!(condition)) { LOG_ERROR(message, ## __VA_ARGS__); std::exit(-1); }
+#define ASSERT(condition, message, ...) if (!(condition)) { LOG_ERROR(message, ## __VA_ARGS__); common::logger::flush(); std::exit(-1); }
 
 } // namespace common::logger
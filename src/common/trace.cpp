@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "log.hpp"
+#include "trace.hpp"
+
+namespace common::trace {
+
+namespace detail {
+
+std::atomic_bool g_active = false;
+
+} // namespace detail
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr u64 kCyclesPerSecond = 16777216;
+
+static constexpr int kHostProcess = 1;
+static constexpr int kEmulatedProcess = 2;
+
+struct Event {
+  const char* category;
+  const char* name;
+  u64 nanoseconds;
+  u64 cycles;
+  u64 id;
+  detail::Phase phase;
+};
+
+/**
+ * Events of one thread, which is the only one to write to it, while the writer thread reads from it.
+ * If the writer falls behind, new events are dropped.
+ */
+struct Buffer {
+  static constexpr size_t kCapacity = 1 << 16;
+
+  std::array<Event, kCapacity> events;
+  std::atomic<size_t> head = 0;
+  std::atomic<size_t> tail = 0;
+  std::atomic<u64> dropped = 0;
+  int thread_id;
+  std::string thread_name;
+};
+
+static std::mutex g_buffers_lock;
+static std::vector<std::shared_ptr<Buffer>> g_buffers;
+static thread_local std::shared_ptr<Buffer> t_buffer;
+
+static std::mutex g_writer_lock;
+static std::condition_variable g_writer_wakeup;
+static std::thread g_writer;
+static bool g_stop_writer;
+static std::ofstream g_file;
+static bool g_first_event;
+static Clock::time_point g_start;
+
+static auto get_buffer() -> Buffer& {
+  if (!t_buffer) {
+    std::lock_guard guard{g_buffers_lock};
+    t_buffer = std::make_shared<Buffer>();
+    t_buffer->thread_id = int(g_buffers.size()) + 1;
+    t_buffer->thread_name = fmt::format("thread {0}", t_buffer->thread_id);
+    t_buffer->tail = t_buffer->head.load();
+    g_buffers.push_back(t_buffer);
+  }
+  return *t_buffer;
+}
+
+void detail::record(Phase phase, const char* category, const char* name, u64 cycles, u64 id) {
+  auto& buffer = get_buffer();
+  auto head = buffer.head.load(std::memory_order_relaxed);
+  auto used = head - buffer.tail.load(std::memory_order_acquire);
+
+  if (used == Buffer::kCapacity) {
+    buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // Do not wait for the next periodic flush if events come in fast.
+  if (used == Buffer::kCapacity / 2) {
+    g_writer_wakeup.notify_one();
+  }
+
+  auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - g_start).count();
+
+  buffer.events[head % Buffer::kCapacity] = {category, name, u64(nanoseconds), cycles, id, phase};
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+static auto escape(std::string_view value) -> std::string {
+  auto escaped = std::string{};
+  for (auto c : value) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+/// Timestamps are in microseconds, written with integer math since this is the bottleneck of the writer.
+static void write_event(fmt::memory_buffer& out, int pid, int tid, Event const& event, u64 nanoseconds) {
+  auto name = std::strpbrk(event.name, "\"\\") == nullptr ? std::string{} : escape(event.name);
+
+  fmt::format_to(std::back_inserter(out), "{0}\n{{\"name\":\"{1}\",\"cat\":\"{2}\",\"ph\":\"{3}\",\"pid\":{4},\"tid\":{5},\"ts\":{6}.{7:03}",
+    g_first_event ? "" : ",", name.empty() ? event.name : name.c_str(), event.category, char(event.phase), pid, tid,
+    nanoseconds / 1000, nanoseconds % 1000);
+
+  switch (event.phase) {
+    case detail::Phase::Instant:
+      fmt::format_to(std::back_inserter(out), ",\"s\":\"t\"");
+      break;
+    case detail::Phase::AsyncBegin:
+    case detail::Phase::AsyncEnd:
+      fmt::format_to(std::back_inserter(out), ",\"id\":{0}", event.id);
+      break;
+    default:
+      break;
+  }
+
+  out.push_back('}');
+  g_first_event = false;
+}
+
+static void write_metadata(int pid, int tid, const char* name, std::string const& value) {
+  g_file << fmt::format("{0}\n{{\"name\":\"{1}\",\"ph\":\"M\",\"pid\":{2},\"tid\":{3},\"args\":{{\"name\":\"{4}\"}}}}",
+    g_first_event ? "" : ",", name, pid, tid, escape(value));
+  g_first_event = false;
+}
+
+/**
+ * Writes the events that were recorded since the last call, must hold g_writer_lock.
+ * Returns true if a thread recorded events faster than they are written.
+ */
+static bool flush() {
+  auto busy = false;
+  auto buffers = std::vector<std::shared_ptr<Buffer>>{};
+  {
+    std::lock_guard guard{g_buffers_lock};
+    buffers = g_buffers;
+  }
+
+  auto out = fmt::memory_buffer{};
+
+  for (auto& buffer : buffers) {
+    auto head = buffer->head.load(std::memory_order_acquire);
+    auto tail = buffer->tail.load(std::memory_order_relaxed);
+
+    busy = busy || head - tail >= Buffer::kCapacity / 4;
+
+    for (; tail != head; tail++) {
+      auto& event = buffer->events[tail % Buffer::kCapacity];
+
+      write_event(out, kHostProcess, buffer->thread_id, event, event.nanoseconds);
+      if (event.cycles != kNoCycles) {
+        auto nanoseconds = event.cycles / kCyclesPerSecond * 1'000'000'000 + event.cycles % kCyclesPerSecond * 1'000'000'000 / kCyclesPerSecond;
+        write_event(out, kEmulatedProcess, buffer->thread_id, event, nanoseconds);
+      }
+    }
+
+    // Free the events before writing them out, so that the thread can go on recording.
+    buffer->tail.store(head, std::memory_order_release);
+    g_file.write(out.data(), out.size());
+    out.clear();
+  }
+
+  return busy;
+}
+
+static void run_writer() {
+  std::unique_lock lock{g_writer_lock};
+
+  while (!g_stop_writer) {
+    if (!flush()) {
+      g_writer_wakeup.wait_for(lock, std::chrono::milliseconds{50});
+    }
+  }
+}
+
+bool start(std::string const& path) {
+  if constexpr (!kEnabled) {
+    LOG_WARN("Tracing is not available, configure with ENABLE_TRACE=ON.");
+    return false;
+  }
+
+  std::lock_guard guard{g_writer_lock};
+
+  if (g_file.is_open()) {
+    return false;
+  }
+
+  g_file.open(path, std::ios::trunc);
+  if (!g_file.good()) {
+    return false;
+  }
+
+  // Discard whatever was recorded while no trace was running.
+  {
+    std::lock_guard guard{g_buffers_lock};
+    for (auto& buffer : g_buffers) {
+      buffer->tail = buffer->head.load();
+      buffer->dropped = 0;
+    }
+  }
+
+  g_file << "{\"traceEvents\":[";
+  g_first_event = true;
+  g_start = Clock::now();
+  g_stop_writer = false;
+  g_writer = std::thread{run_writer};
+  detail::g_active = true;
+  return true;
+}
+
+void stop() {
+  {
+    std::lock_guard guard{g_writer_lock};
+    if (!g_writer.joinable()) {
+      return;
+    }
+    detail::g_active = false;
+    g_stop_writer = true;
+  }
+
+  g_writer_wakeup.notify_one();
+  g_writer.join();
+
+  std::lock_guard guard{g_writer_lock};
+
+  flush();
+
+  write_metadata(kHostProcess, 0, "process_name", "Host time");
+  write_metadata(kEmulatedProcess, 0, "process_name", "Emulated time");
+
+  auto dropped = u64(0);
+  {
+    std::lock_guard guard{g_buffers_lock};
+    for (auto& buffer : g_buffers) {
+      write_metadata(kHostProcess, buffer->thread_id, "thread_name", buffer->thread_name);
+      write_metadata(kEmulatedProcess, buffer->thread_id, "thread_name", buffer->thread_name);
+      dropped += buffer->dropped.load();
+    }
+  }
+
+  g_file << "\n]}\n";
+  g_file.close();
+
+  if (dropped != 0) {
+    LOG_WARN("Trace: dropped {0} events, the trace file could not be written fast enough.", dropped);
+  }
+}
+
+void set_thread_name(std::string const& name) {
+  if constexpr (!kEnabled) {
+    return;
+  }
+
+  auto& buffer = get_buffer();
+  std::lock_guard guard{g_buffers_lock};
+  buffer.thread_name = name;
+}
+
+} // namespace common::trace
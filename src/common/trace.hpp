@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <common/integer.hpp>
+#include <string>
+
+/**
+ * Records a timeline of what the emulator and the frontend are doing
+ * and writes it as a Chrome trace (JSON), which can be opened in chrome://tracing or Perfetto.
+ * Each event appears twice: on the host time line and, if it belongs to an emulator,
+ * on the emulated time line, so that hitches on the host can be told apart from busy frames.
+ *
+ * Events are only recorded if the program is built with NBA_TRACE and a trace was started,
+ * otherwise all functions compile to nothing.
+ * Category and event names must be string literals (or otherwise live forever).
+ */
+namespace common::trace {
+
+#ifdef NBA_TRACE
+static constexpr bool kEnabled = true;
+#else
+static constexpr bool kEnabled = false;
+#endif
+
+/// Emulated time of events that do not belong to an emulator, e.g. drawing in the frontend.
+static constexpr u64 kNoCycles = ~u64(0);
+
+/**
+ * Starts writing a trace to a file, events are written on a thread of their own.
+ * Returns false if the file cannot be created or a trace is already running.
+ */
+bool start(std::string const& path);
+
+/// Writes the remaining events and closes the file.
+void stop();
+
+/// Names the calling thread in the trace.
+void set_thread_name(std::string const& name);
+
+namespace detail {
+
+enum class Phase : char {
+  Begin = 'B',
+  End = 'E',
+  Instant = 'i',
+  AsyncBegin = 'b',
+  AsyncEnd = 'e'
+};
+
+extern std::atomic_bool g_active;
+
+void record(Phase phase, const char* category, const char* name, u64 cycles, u64 id);
+
+inline bool active() {
+  return g_active.load(std::memory_order_acquire);
+}
+
+} // namespace detail
+
+inline void begin([[maybe_unused]] const char* category, [[maybe_unused]] const char* name, [[maybe_unused]] u64 cycles = kNoCycles) {
+#ifdef NBA_TRACE
+  if (detail::active()) {
+    detail::record(detail::Phase::Begin, category, name, cycles, 0);
+  }
+#endif
+}
+
+inline void end([[maybe_unused]] const char* category, [[maybe_unused]] const char* name, [[maybe_unused]] u64 cycles = kNoCycles) {
+#ifdef NBA_TRACE
+  if (detail::active()) {
+    detail::record(detail::Phase::End, category, name, cycles, 0);
+  }
+#endif
+}
+
+inline void instant([[maybe_unused]] const char* category, [[maybe_unused]] const char* name, [[maybe_unused]] u64 cycles = kNoCycles) {
+#ifdef NBA_TRACE
+  if (detail::active()) {
+    detail::record(detail::Phase::Instant, category, name, cycles, 0);
+  }
+#endif
+}
+
+/**
+ * Asynchronous events have a track of their own, so they may start and end
+ * in different scopes, e.g. an interrupt that is entered and returned from.
+ */
+inline void async_begin([[maybe_unused]] const char* category, [[maybe_unused]] const char* name, [[maybe_unused]] u64 id, [[maybe_unused]] u64 cycles = kNoCycles) {
+#ifdef NBA_TRACE
+  if (detail::active()) {
+    detail::record(detail::Phase::AsyncBegin, category, name, cycles, id);
+  }
+#endif
+}
+
+inline void async_end([[maybe_unused]] const char* category, [[maybe_unused]] const char* name, [[maybe_unused]] u64 id, [[maybe_unused]] u64 cycles = kNoCycles) {
+#ifdef NBA_TRACE
+  if (detail::active()) {
+    detail::record(detail::Phase::AsyncEnd, category, name, cycles, id);
+  }
+#endif
+}
+
+/// Clock of events that do not belong to an emulator.
+struct NoClock {
+  auto GetTimestampNow() const -> u64 {
+    return kNoCycles;
+  }
+};
+
+inline constexpr NoClock kNoClock{};
+
+/**
+ * Records an event for the lifetime of the scope.
+ * The clock (e.g. the scheduler) provides the emulated time through GetTimestampNow().
+ */
+template<typename Clock = NoClock>
+struct Scope {
+#ifdef NBA_TRACE
+  Scope(const char* category, const char* name, Clock const& clock = kNoClock)
+      : category(category)
+      , name(name)
+      , clock(clock)
+      , recorded(detail::active()) {
+    if (recorded) {
+      detail::record(detail::Phase::Begin, category, name, clock.GetTimestampNow(), 0);
+    }
+  }
+
+ ~Scope() {
+    if (recorded) {
+      detail::record(detail::Phase::End, category, name, clock.GetTimestampNow(), 0);
+    }
+  }
+
+private:
+  const char* category;
+  const char* name;
+  Clock const& clock;
+  bool recorded;
+#else
+  Scope(const char*, const char*, Clock const& = kNoClock) { }
+#endif
+};
+
+} // namespace common::trace
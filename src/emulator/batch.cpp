@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <algorithm>
+#include <common/log.hpp>
+#include <cstring>
+
+#include "batch.hpp"
+
+namespace nba {
+
+BatchEmulator::BatchEmulator(std::shared_ptr<Config> config, int count, int thread_count) {
+  framebuffers.resize(size_t(count) * kFrameSize);
+  instances.resize(count);
+
+  for (int i = 0; i < count; i++) {
+    auto& instance = instances[i];
+    auto instance_config = std::make_shared<Config>(*config);
+    auto video_dev = std::make_shared<BatchVideoDevice>();
+
+    video_dev->output = &framebuffers[size_t(i) * kFrameSize];
+    instance.input_dev = std::make_shared<BatchInputDevice>();
+
+    instance_config->audio_dev = std::make_shared<NullAudioDevice>();
+    instance_config->input_dev = instance.input_dev;
+    instance_config->video_dev = video_dev;
+
+    // The instances must not share the save file, nor spend memory and threads on frontend features.
+    instance_config->memory_save = true;
+    instance_config->rewind.enable = false;
+    instance_config->run_ahead = 0;
+    instance_config->suspend_resume = false;
+    instance.emulator = std::make_unique<Emulator>(instance_config);
+  }
+
+  if (thread_count <= 0) {
+    thread_count = std::max(1, int(std::thread::hardware_concurrency()));
+  }
+
+  // The thread that calls Step() does its share of the work as well.
+  for (int i = 1; i < std::min(thread_count, count); i++) {
+    threads.emplace_back(&BatchEmulator::WorkerThreadMain, this);
+  }
+}
+
+BatchEmulator::~BatchEmulator() {
+  mutex.lock();
+  quit = true;
+  mutex.unlock();
+  start_cv.notify_all();
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+auto BatchEmulator::LoadGame(std::string const& path) -> Emulator::StatusCode {
+  for (auto& instance : instances) {
+    auto status = instance.emulator->LoadGame(path);
+    if (status != Emulator::StatusCode::Ok) {
+      return status;
+    }
+  }
+  return Emulator::StatusCode::Ok;
+}
+
+void BatchEmulator::Reset() {
+  for (auto& instance : instances) {
+    instance.emulator->Reset();
+  }
+}
+
+bool BatchEmulator::AddRAMView(u32 address, size_t length) {
+  auto scratch = std::vector<u8>(length);
+
+  if (instances.empty() || !instances[0].emulator->ReadRAM(address, length, scratch.data())) {
+    LOG_ERROR("BatchEmulator: RAM view at 0x{0:08X} with {1} bytes is not in EWRAM or IWRAM.", address, length);
+    return false;
+  }
+
+  ram_views.push_back({address, length});
+  ram_view_size += length;
+  ram_buffer.resize(instances.size() * ram_view_size);
+  return true;
+}
+
+void BatchEmulator::Step(u16 const* inputs, int frames) {
+  // Input changes may raise the keypad interrupt, so apply them before any instance runs.
+  for (int i = 0; i < Count(); i++) {
+    instances[i].input_dev->SetKeys(inputs[i]);
+  }
+
+  this->frames = frames;
+  pending_jobs = Count();
+  next_job = 0;
+
+  mutex.lock();
+  generation++;
+  mutex.unlock();
+  start_cv.notify_all();
+
+  RunJobs();
+
+  std::unique_lock lock{mutex};
+  done_cv.wait(lock, [this]() { return pending_jobs == 0; });
+}
+
+void BatchEmulator::WorkerThreadMain() {
+  u64 current_generation = 0;
+  std::unique_lock lock{mutex};
+
+  for (;;) {
+    start_cv.wait(lock, [&]() { return quit || generation != current_generation; });
+
+    if (quit) {
+      break;
+    }
+
+    current_generation = generation;
+    lock.unlock();
+    RunJobs();
+    lock.lock();
+  }
+}
+
+void BatchEmulator::RunJobs() {
+  /* Instances are handed out one at a time, so that threads which finish
+   * their instances early pick up the remaining ones.
+   */
+  int index;
+
+  while ((index = next_job++) < Count()) {
+    StepInstance(index);
+
+    if (--pending_jobs == 0) {
+      std::lock_guard guard{mutex};
+      done_cv.notify_one();
+    }
+  }
+}
+
+void BatchEmulator::StepInstance(int index) {
+  auto& emulator = *instances[index].emulator;
+  auto ram = ram_buffer.data() + index * ram_view_size;
+
+  for (int i = 0; i < frames; i++) {
+    emulator.Frame();
+  }
+
+  for (auto& view : ram_views) {
+    emulator.ReadRAM(view.address, view.length, ram);
+    ram += view.length;
+  }
+}
+
+void BatchEmulator::BatchVideoDevice::Draw(u32* buffer) {
+  std::memcpy(output, buffer, kFrameSize * sizeof(u32));
+}
+
+void BatchEmulator::BatchInputDevice::SetKeys(u16 keys) {
+  if (keys != this->keys) {
+    this->keys = keys;
+    if (callback) {
+      callback();
+    }
+  }
+}
+
+auto BatchEmulator::BatchInputDevice::Poll(Key key) -> bool {
+  return keys & (1 << int(key));
+}
+
+void BatchEmulator::BatchInputDevice::SetOnChangeCallback(std::function<void(void)> callback) {
+  this->callback = callback;
+}
+
+} // namespace nba
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <common/integer.hpp>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "emulator.hpp"
+
+namespace nba {
+
+/**
+ * Steps many emulator instances in lockstep on a pool of worker threads.
+ *
+ * Each call to Step() advances every instance by the same number of frames,
+ * with its own input, and leaves the most recent frame and a configurable
+ * set of RAM ranges of every instance in contiguous output buffers.
+ * Those buffers are allocated once, so stepping does not allocate.
+ */
+struct BatchEmulator {
+  static constexpr int kFrameWidth = 240;
+  static constexpr int kFrameHeight = 160;
+  static constexpr int kFrameSize = kFrameWidth * kFrameHeight;
+
+  /**
+   * Every instance gets a copy of the config, with its devices replaced,
+   * its backup kept in memory and rewind, run-ahead and suspend/resume disabled.
+   * A thread count of zero uses one thread per hardware thread.
+   */
+  BatchEmulator(std::shared_ptr<Config> config, int count, int thread_count = 0);
+ ~BatchEmulator();
+
+  auto LoadGame(std::string const& path) -> Emulator::StatusCode;
+  void Reset();
+
+  /**
+   * Adds a RAM range that is copied to the RAM output buffer after each step.
+   * The ranges of one instance are packed in the order they were added.
+   * Only EWRAM and IWRAM ranges are supported, see Emulator::ReadRAM().
+   */
+  bool AddRAMView(u32 address, size_t length);
+
+  /**
+   * Emulates the given number of frames on all instances.
+   * The input of every instance is a mask with bit N set if InputDevice::Key(N) is pressed.
+   */
+  void Step(u16 const* inputs, int frames = 1);
+
+  auto Count() const -> int { return int(instances.size()); }
+
+  auto GetEmulator(int index) -> Emulator& { return *instances[index].emulator; }
+
+  /// kFrameSize pixels per instance, in ARGB8888 format.
+  auto GetFramebuffers() const -> u32 const* { return framebuffers.data(); }
+
+  /// GetRAMViewSize() bytes per instance.
+  auto GetRAMViews() const -> u8 const* { return ram_buffer.data(); }
+  auto GetRAMViewSize() const -> size_t { return ram_view_size; }
+
+private:
+  struct BatchVideoDevice : VideoDevice {
+    void Draw(u32* buffer) final;
+
+    u32* output;
+  };
+
+  struct BatchInputDevice : InputDevice {
+    void SetKeys(u16 keys);
+    auto Poll(Key key) -> bool final;
+    void SetOnChangeCallback(std::function<void(void)> callback) final;
+
+  private:
+    u16 keys = 0;
+    std::function<void(void)> callback;
+  };
+
+  struct Instance {
+    std::unique_ptr<Emulator> emulator;
+    std::shared_ptr<BatchInputDevice> input_dev;
+  };
+
+  struct RAMView {
+    u32 address;
+    size_t length;
+  };
+
+  void WorkerThreadMain();
+  void RunJobs();
+  void StepInstance(int index);
+
+  std::vector<Instance> instances;
+  std::vector<u32> framebuffers;
+  std::vector<RAMView> ram_views;
+  std::vector<u8> ram_buffer;
+  size_t ram_view_size = 0;
+
+  int frames;
+  std::atomic<int> next_job;
+  std::atomic<int> pending_jobs;
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable start_cv;
+  std::condition_variable done_cv;
+  u64 generation = 0;
+  bool quit = false;
+};
+
+} // namespace nba
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <common/integer.hpp>
+#include <emulator/save_state.hpp>
+#include <memory>
 
 namespace nba { 
 
@@ -17,6 +19,21 @@ struct Backup {
   virtual void Reset() = 0;
   virtual auto Read (u32 address) -> u8 = 0;
   virtual void Write(u32 address, u8 value) = 0;
+
+  virtual void LoadState(SaveState const& state) = 0;
+  virtual void CopyState(SaveState& state) = 0;
+
+  /// Called periodically at points where the save data may be persisted.
+  virtual void Commit() = 0;
+
+  /**
+   * While speculative, writes only update memory and never reach the save file.
+   * The state from before must be restored before leaving speculative mode.
+   */
+  virtual void SetSpeculative(bool speculative) = 0;
+
+  /// Creates an erased backup chip of the same type and size, that is kept in memory only.
+  virtual auto Clone() const -> std::unique_ptr<Backup> = 0;
 };
 
 } // namespace nba
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <common/log.hpp>
+#include <cstdio>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "backup_file.hpp"
+
+namespace nba {
+
+BackupFile::~BackupFile() {
+  if (mode == Mode::Memory) {
+    return;
+  }
+
+  Commit(true);
+
+  if (writer.thread.joinable()) {
+    writer.mutex.lock();
+    writer.quit = true;
+    writer.mutex.unlock();
+    writer.cv.notify_one();
+    writer.thread.join();
+  }
+}
+
+void BackupFile::Commit(bool force) {
+  if (mode == Mode::Direct && deferred && !dirty) {
+    std::lock_guard guard{writer.mutex};
+    deferred = writer.pending || writer.busy;
+    return;
+  }
+
+  if (mode == Mode::Memory || !dirty) {
+    return;
+  }
+
+  if (written_since_commit && !force && postponed_commits < kMaxPostponedCommits) {
+    written_since_commit = false;
+    postponed_commits++;
+    return;
+  }
+
+  if (!writer.thread.joinable()) {
+    writer.thread = std::thread{&BackupFile::WriterThreadMain, this};
+  }
+
+  writer.mutex.lock();
+  writer.snapshot.assign(&memory[0], &memory[file_size]);
+  writer.pending = true;
+  writer.mutex.unlock();
+  writer.cv.notify_one();
+
+  dirty = false;
+  written_since_commit = false;
+  postponed_commits = 0;
+}
+
+void BackupFile::LoadState(SaveState::Backup const& state) {
+  if (state.size != file_size) {
+    LOG_WARN("BackupFile: save state has {0} bytes of backup memory but {1} are expected.", state.size, file_size);
+    return;
+  }
+
+  /* Rewind, run-ahead and lockstep restore states all the time,
+   * so the file is rewritten by the I/O thread on the next commit.
+   */
+  if (std::memcmp(memory.get(), state.data, file_size) != 0) {
+    std::memcpy(memory.get(), state.data, file_size);
+
+    // Speculative writes never left memory, so undoing them needs no file update.
+    if (speculative) {
+      return;
+    }
+    if (mode == Mode::Direct) {
+      deferred = true;
+    }
+    Update(0, file_size);
+  }
+}
+
+void BackupFile::CopyState(SaveState::Backup& state) {
+  state.size = u32(file_size);
+  std::memcpy(state.data, memory.get(), file_size);
+}
+
+void BackupFile::WriterThreadMain() {
+  std::vector<u8> snapshot;
+  std::unique_lock lock{writer.mutex};
+
+  for (;;) {
+    writer.cv.wait(lock, [this]() { return writer.pending || writer.quit; });
+
+    if (writer.pending) {
+      // Only the most recent snapshot is of interest, older ones are dropped.
+      std::swap(snapshot, writer.snapshot);
+      writer.pending = false;
+      writer.busy = true;
+      lock.unlock();
+      if (mode == Mode::Atomic) {
+        WriteSnapshot(snapshot);
+      } else {
+        WriteInPlace(snapshot);
+      }
+      lock.lock();
+      writer.busy = false;
+    } else {
+      break;
+    }
+  }
+}
+
+/* The emulation thread leaves the stream alone until the file has been rewritten,
+ * see BackupFile::Commit().
+ */
+void BackupFile::WriteInPlace(std::vector<u8> const& snapshot) {
+  stream.seekp(0);
+  stream.write((char const*)snapshot.data(), snapshot.size());
+  stream.flush();
+
+  if (!stream.good()) {
+    LOG_ERROR("BackupFile: failed to write save file: {0}", save_path);
+    stream.clear();
+  }
+}
+
+void BackupFile::WriteSnapshot(std::vector<u8> const& snapshot) {
+  namespace fs = std::filesystem;
+
+  auto tmp_path = save_path + ".tmp";
+  auto file = std::fopen(tmp_path.c_str(), "wb");
+
+  if (file == nullptr) {
+    LOG_ERROR("BackupFile: unable to create temporary file: {0}", tmp_path);
+    return;
+  }
+
+  bool success = std::fwrite(snapshot.data(), 1, snapshot.size(), file) == snapshot.size() &&
+                 std::fflush(file) == 0;
+
+  // Make sure the data reached the disk before the rename makes it visible.
+#ifdef WIN32
+  success = success && _commit(_fileno(file)) == 0;
+#else
+  success = success && fsync(fileno(file)) == 0;
+#endif
+
+  success = std::fclose(file) == 0 && success;
+
+  if (!success) {
+    LOG_ERROR("BackupFile: failed to write temporary file: {0}", tmp_path);
+    return;
+  }
+
+  std::error_code error;
+  fs::rename(tmp_path, save_path, error);
+  if (error) {
+    LOG_ERROR("BackupFile: unable to replace save file: {0} ({1})", save_path, error.message());
+  }
+}
+
+} // namespace nba
@@ -8,27 +8,52 @@
 #pragma once
 
 #include <algorithm>
+#include <condition_variable>
 #include <filesystem>
 #include <common/integer.hpp>
 #include <cstring>
+#include <emulator/save_state.hpp>
 #include <stdexcept>
 #include <string>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace nba {
 
 struct BackupFile {
+  enum class Mode {
+    /// Every write is forwarded to the save file immediately.
+    Direct,
+    /// Writes only update memory. Snapshots of the memory are written
+    /// to a temporary file on an I/O thread and then renamed over the save file.
+    Atomic,
+    /// The save file is never accessed. The memory starts out erased.
+    Memory
+  };
+
   static auto OpenOrCreate(std::string const& save_path,
                            std::vector<size_t> const& valid_sizes,
-                           int& default_size) -> std::unique_ptr<BackupFile> {
+                           int& default_size,
+                           Mode mode = Mode::Direct) -> std::unique_ptr<BackupFile> {
     namespace fs = std::filesystem;
 
     bool create = true;
     auto flags = std::ios::binary | std::ios::in | std::ios::out;
     std::unique_ptr<BackupFile> file { new BackupFile() };
 
+    file->mode = mode;
+    file->save_path = save_path;
+
+    if (mode == Mode::Memory) {
+      file->file_size = default_size;
+      file->memory.reset(new u8[default_size]);
+      std::memset(file->memory.get(), 0xFF, default_size);
+      return file;
+    }
+
     // TODO: check file type and permissions?
     if (fs::is_regular_file(save_path)) {
       auto size = fs::file_size(save_path);
@@ -45,6 +70,11 @@ struct BackupFile {
         file->memory.reset(new u8[size]);
         file->stream.read((char*)file->memory.get(), size);
         create = false;
+
+        // In atomic mode the file is only ever replaced as a whole.
+        if (mode == Mode::Atomic) {
+          file->stream.close();
+        }
       }
     }
 
@@ -54,17 +84,25 @@ struct BackupFile {
      * or when the existing file has an invalid size.
      */
     if (create) {
-      file->stream.open(save_path, flags | std::ios::trunc);
-      if (file->stream.fail()) {
-        throw std::runtime_error("BackupFile: unable to create file: " + save_path);
-      }
       file->memory.reset(new u8[default_size]);
-      file->MemorySet(0, default_size, 0xFF);
+
+      if (mode == Mode::Atomic) {
+        file->MemorySet(0, default_size, 0xFF);
+        file->Commit(true);
+      } else {
+        file->stream.open(save_path, flags | std::ios::trunc);
+        if (file->stream.fail()) {
+          throw std::runtime_error("BackupFile: unable to create file: " + save_path);
+        }
+        file->MemorySet(0, default_size, 0xFF);
+      }
     }
 
     return file;
   }
 
+ ~BackupFile();
+
   auto Read(unsigned index) -> u8 {
     if (index >= file_size) {
       throw std::runtime_error("BackupFile: out-of-bounds index while reading.");
@@ -96,18 +134,73 @@ struct BackupFile {
     if ((index + length) > file_size) {
       throw std::runtime_error("BackupFile: out-of-bounds index while updating file.");
     }
+    if (mode == Mode::Memory || speculative) {
+      return;
+    }
+    if (mode == Mode::Atomic || deferred) {
+      dirty = true;
+      written_since_commit = true;
+      return;
+    }
     stream.seekg(index);
     stream.write((char*)&memory[index], length);
   }
 
+  /**
+   * Restores the memory from a save state.
+   * The save file is only updated by the next commit and only if the memory actually changed.
+   */
+  void LoadState(SaveState::Backup const& state);
+  void CopyState(SaveState::Backup& state);
+
+  /**
+   * Hands a snapshot of the memory to the I/O thread, if it changed.
+   * In direct mode this only happens after a save state was loaded, since the
+   * whole file must be rewritten then. Writes go through directly again once
+   * the I/O thread has caught up.
+   * Unless forced, the snapshot is postponed while the game is still
+   * writing, so that multi-write sequences (e.g. programming a FLASH sector)
+   * end up in a single file update and never get torn apart on disk.
+   * A game that keeps writing is still committed after kMaxPostponedCommits.
+   */
+  void Commit(bool force = false);
+
   bool auto_update = true;
 
+  /// See Backup::SetSpeculative().
+  bool speculative = false;
+
+  static constexpr int kMaxPostponedCommits = 4;
+
 private:
   BackupFile() { }
 
+  void WriterThreadMain();
+  void WriteSnapshot(std::vector<u8> const& snapshot);
+  void WriteInPlace(std::vector<u8> const& snapshot);
+
+  Mode mode = Mode::Direct;
+  std::string save_path;
   size_t file_size;
   std::fstream stream;
   std::unique_ptr<u8[]> memory;
+
+  bool dirty = false;
+  bool written_since_commit = false;
+
+  /// Direct mode only: writes only update memory until the I/O thread has rewritten the file.
+  bool deferred = false;
+  int postponed_commits = 0;
+
+  struct Writer {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<u8> snapshot;
+    bool pending = false;
+    bool busy = false;
+    bool quit = false;
+  } writer;
 };
 
 } // namespace nba
@@ -15,9 +15,10 @@ namespace nba {
 static constexpr int g_addr_bits[2] = { 6, 14 };
 static constexpr int g_save_size[2] = { 512, 8192 };
 
-EEPROM::EEPROM(std::string const& save_path, Size size_hint)
+EEPROM::EEPROM(std::string const& save_path, Size size_hint, BackupFile::Mode mode)
     : size(size_hint)
-    , save_path(save_path) {
+    , save_path(save_path)
+    , mode(mode) {
   Reset();
 }
 
@@ -28,7 +29,7 @@ void EEPROM::Reset() {
 
   int bytes = g_save_size[size];
   
-  file = BackupFile::OpenOrCreate(save_path, { 512, 8192 }, bytes);
+  file = BackupFile::OpenOrCreate(save_path, { 512, 8192 }, bytes, mode);
   if (bytes == g_save_size[0]) {
     size = SIZE_4K;
   } else {
@@ -36,6 +37,10 @@ void EEPROM::Reset() {
   }
 }
 
+auto EEPROM::Clone() const -> std::unique_ptr<Backup> {
+  return std::make_unique<EEPROM>(save_path, Size(size), BackupFile::Mode::Memory);
+}
+
 void EEPROM::ResetSerialBuffer() {
   serial_buffer = 0;
   transmitted_bits = 0;
@@ -11,9 +11,10 @@ namespace nba {
 
 static constexpr int g_save_size[2] = { 65536, 131072 };
 
-FLASH::FLASH(std::string const& save_path, Size size_hint)
+FLASH::FLASH(std::string const& save_path, Size size_hint, BackupFile::Mode mode)
     : size(size_hint)
-    , save_path(save_path) {
+    , save_path(save_path)
+    , mode(mode) {
   Reset();
 }
   
@@ -27,7 +28,7 @@ void FLASH::Reset() {
   
   int bytes = g_save_size[size];
   
-  file = BackupFile::OpenOrCreate(save_path, { 65536, 131072 }, bytes);
+  file = BackupFile::OpenOrCreate(save_path, { 65536, 131072 }, bytes, mode);
   if (bytes == g_save_size[0]) {
     size = SIZE_64K;
   } else {
@@ -35,6 +36,10 @@ void FLASH::Reset() {
   }
 }
 
+auto FLASH::Clone() const -> std::unique_ptr<Backup> {
+  return std::make_unique<FLASH>(save_path, size, BackupFile::Mode::Memory);
+}
+
 auto FLASH::Read (u32 address) -> u8 {
   address &= 0xFFFF;
   
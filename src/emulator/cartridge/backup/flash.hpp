@@ -20,11 +20,18 @@ struct FLASH : Backup {
     SIZE_128K = 1
   };
   
-  FLASH(std::string const& save_path, Size size_hint);
+  FLASH(std::string const& save_path, Size size_hint, BackupFile::Mode mode = BackupFile::Mode::Direct);
   
   void Reset() final;
   auto Read (u32 address) -> u8 final;
   void Write(u32 address, u8 value) final;
+  void Commit() final { file->Commit(); }
+  void SetSpeculative(bool speculative) final { file->speculative = speculative; }
+
+  auto Clone() const -> std::unique_ptr<Backup> final;
+
+  void LoadState(SaveState const& state) final;
+  void CopyState(SaveState& state) final;
 
 private:
   
@@ -45,6 +52,7 @@ private:
   
   Size size;
   std::string save_path;
+  BackupFile::Mode mode;
   std::unique_ptr<BackupFile> file;
   
   int current_bank;
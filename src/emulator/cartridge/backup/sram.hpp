@@ -15,14 +15,15 @@
 namespace nba {
 
 struct SRAM : Backup {
-  SRAM(std::string const& save_path)
-    : save_path(save_path) {
+  SRAM(std::string const& save_path, BackupFile::Mode mode = BackupFile::Mode::Direct)
+    : save_path(save_path)
+    , mode(mode) {
     Reset();
   }
   
   void Reset() final {
     int bytes = 32768;
-    file = BackupFile::OpenOrCreate(save_path, { 32768 }, bytes);
+    file = BackupFile::OpenOrCreate(save_path, { 32768 }, bytes, mode);
   }
   
   auto Read(u32 address) -> u8 final {
@@ -32,9 +33,30 @@ struct SRAM : Backup {
   void Write(u32 address, u8 value) final {
     file->Write(address & 0x7FFF, value);
   }
+
+  void Commit() final {
+    file->Commit();
+  }
+
+  void SetSpeculative(bool speculative) final {
+    file->speculative = speculative;
+  }
+
+  auto Clone() const -> std::unique_ptr<Backup> final {
+    return std::make_unique<SRAM>(save_path, BackupFile::Mode::Memory);
+  }
+
+  void LoadState(SaveState const& state) final {
+    file->LoadState(state.backup);
+  }
+
+  void CopyState(SaveState& state) final {
+    file->CopyState(state.backup);
+  }
   
 private:
   std::string save_path;
+  BackupFile::Mode mode;
   std::unique_ptr<BackupFile> file;
 };
 
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include "game_pak.hpp"
+
+namespace nba {
+
+namespace {
+
+/* Open bus reads return the lower 16 bits of the halfword address.
+ * Within a 64 KiB page those only depend on whether the page number is odd or even.
+ */
+struct OpenBusPages {
+  OpenBusPages() {
+    for (int parity = 0; parity < 2; parity++) {
+      for (u32 offset = 0; offset < 0x10000; offset += 2) {
+        common::write<u16>(data[parity], offset, u16(((parity << 16) | offset) >> 1));
+      }
+    }
+  }
+
+  u8 data[2][0x10000];
+};
+
+auto GetOpenBusPage(u32 address) -> u8 const* {
+  static const OpenBusPages open_bus;
+  return open_bus.data[(address >> 16) & 1];
+}
+
+} // namespace
+
+void GamePak::BuildPageTable() {
+  auto size = rom->Size();
+
+  /* Pages that are only partially filled with ROM data and pages of small ROMs
+   * that are mirrored within a page combine ROM data and open bus values.
+   * There can only be one such page: either the last partially filled page,
+   * which may appear multiple times due to mirroring, or the page of a small ROM.
+   */
+  auto GetMaterializedPage = [&](u32 page_address) -> u8 const* {
+    if (!materialized_page) {
+      materialized_page = std::make_unique<u8[]>(kPageSize);
+
+      for (u32 offset = 0; offset < kPageSize; offset += 2) {
+        u32 address = (page_address | offset) & rom_mask;
+
+        if (address < size) {
+          common::write<u16>(materialized_page.get(), offset, common::read<u16>(rom->Data(), address));
+        } else {
+          common::write<u16>(materialized_page.get(), offset, u16(address >> 1));
+        }
+      }
+    }
+
+    return materialized_page.get();
+  };
+
+  materialized_page.reset();
+
+  for (int i = 0; i < kPageCount; i++) {
+    u32 address = i << kPageBits;
+    u32 eeprom_page_mask = eeprom_mask & ~kPageMask;
+
+    pages[i] = nullptr;
+
+    if ((gpio && i == 0) || (backup_eeprom && (address & eeprom_page_mask) == eeprom_page_mask)) {
+      continue;
+    }
+
+    if ((rom_mask & kPageMask) == kPageMask) {
+      u32 base = address & rom_mask;
+
+      if (base + kPageSize <= size) {
+        pages[i] = rom->Data() + base;
+        continue;
+      }
+
+      if (base >= size) {
+        pages[i] = GetOpenBusPage(base);
+        continue;
+      }
+    }
+
+    /* If the ROM size is not a multiple of four bytes, 16-bit and 32-bit reads
+     * past the end of the ROM disagree, so those must use the slow path.
+     */
+    if ((size & 3) == 0) {
+      pages[i] = GetMaterializedPage(address);
+    }
+  }
+}
+
+} // namespace nba
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <common/integer.hpp>
 #include <common/compiler.hpp>
 #include <common/punning.hpp>
@@ -18,28 +19,33 @@
 #include "backup/flash.hpp"
 #include "backup/sram.hpp"
 #include "gpio/rtc.hpp"
+#include "rom.hpp"
+#include "rom_analysis.hpp"
 
 namespace nba {
 
 // TODO: handle Nseq access resets EEPROM chip?
-// TODO: optimize EEPROM check away for lower-half ROM address space
 
 struct GamePak {
-  GamePak() {}
+  GamePak() : rom(std::make_shared<ROM const>(std::vector<u8>{})) {
+    BuildPageTable();
+  }
 
   GamePak(
-    std::vector<u8>&& rom,
+    std::shared_ptr<ROM const> rom,
+    RomAnalysis&& analysis,
     std::unique_ptr<Backup>&& backup,
     std::unique_ptr<GPIO>&& gpio,
     u32 rom_mask = 0x01FF'FFFF
   )   : rom(std::move(rom))
+      , analysis(std::move(analysis))
       , gpio(std::move(gpio))
       , rom_mask(rom_mask) {
     if (backup != nullptr) {
       if (typeid(*backup.get()) == typeid(EEPROM)) {
         backup_eeprom = std::move(backup);
       
-        if (this->rom.size() >= 0x0200'0000) {
+        if (this->rom->Size() >= 0x0200'0000) {
           eeprom_mask = 0x01FF'FF00;
         } else {
           eeprom_mask = 0x0100'0000;
@@ -48,6 +54,8 @@ struct GamePak {
         backup_sram = std::move(backup);
       }
     }
+
+    BuildPageTable();
   }
 
   GamePak(GamePak const&) = delete;
@@ -60,21 +68,78 @@ struct GamePak {
 
   auto operator=(GamePak&& other) -> GamePak& {
     std::swap(rom, other.rom);
+    std::swap(analysis, other.analysis);
     std::swap(backup_sram, other.backup_sram);
     std::swap(backup_eeprom, other.backup_eeprom);
+    std::swap(file_backup_sram, other.file_backup_sram);
+    std::swap(file_backup_eeprom, other.file_backup_eeprom);
     std::swap(gpio, other.gpio);
     std::swap(rom_mask, other.rom_mask);
     std::swap(eeprom_mask, other.eeprom_mask);
+    std::swap(pages, other.pages);
+    std::swap(materialized_page, other.materialized_page);
     return *this;
   }
 
-  auto GetRawROM() const -> std::vector<u8> const& {
-    return rom;
+  /**
+   * Creates a cartridge for another machine, which shares the ROM with this one.
+   * The backup memory is kept in memory only and starts out erased,
+   * the actual contents are expected to be restored from a save state.
+   */
+  auto Clone(core::Scheduler* scheduler, core::IRQ* irq) const -> GamePak {
+    auto clone = GamePak{};
+
+    clone.rom = rom;
+    clone.analysis = analysis;
+    clone.rom_mask = rom_mask;
+    clone.eeprom_mask = eeprom_mask;
+    if (backup_sram != nullptr) {
+      clone.backup_sram = backup_sram->Clone();
+    }
+    if (backup_eeprom != nullptr) {
+      clone.backup_eeprom = backup_eeprom->Clone();
+    }
+    if (gpio != nullptr) {
+      clone.gpio = gpio->Clone(scheduler, irq);
+    }
+    clone.BuildPageTable();
+    return clone;
+  }
+
+  auto GetRawROM() const -> ROM const& {
+    return *rom;
+  }
+
+  auto GetAnalysis() const -> RomAnalysis const& {
+    return analysis;
   }
 
   auto ALWAYS_INLINE ReadROM16(u32 address) -> u16 {
     address &= 0x01FF'FFFE;
 
+    if (auto page = pages[address >> kPageBits]; likely(page != nullptr)) {
+      return common::read<u16>(page, address & kPageMask);
+    }
+
+    return ReadROM16Slow(address);
+  }
+
+  auto ALWAYS_INLINE ReadROM32(u32 address) -> u32 {
+    address &= 0x01FF'FFFC;
+
+    if (auto page = pages[address >> kPageBits]; likely(page != nullptr)) {
+      return common::read<u32>(page, address & kPageMask);
+    }
+
+    return ReadROM32Slow(address);
+  }
+
+  /* Reference implementation of ROM reads, used for pages
+   * which contain GPIO or EEPROM registers.
+   */
+  auto ReadROM16Slow(u32 address) -> u16 {
+    address &= 0x01FF'FFFE;
+
     if (unlikely(IsGPIO(address)) && gpio->IsReadable()) {
       return gpio->Read(address);
     }
@@ -85,14 +150,14 @@ struct GamePak {
 
     address &= rom_mask;
 
-    if (unlikely(address >= rom.size())) {
+    if (unlikely(address >= rom->Size())) {
       return u16(address >> 1);
     }
 
-    return common::read<u16>(rom.data(), address);
+    return common::read<u16>(rom->Data(), address);
   }
 
-  auto ALWAYS_INLINE ReadROM32(u32 address) -> u32 {
+  auto ReadROM32Slow(u32 address) -> u32 {
     address &= 0x01FF'FFFC;
 
     if (unlikely(IsGPIO(address)) && gpio->IsReadable()) {
@@ -109,13 +174,13 @@ struct GamePak {
 
     address &= rom_mask;
 
-    if (unlikely(address >= rom.size())) {
+    if (unlikely(address >= rom->Size())) {
       auto lsw = u16(address >> 1);
       auto msw = u16(lsw + 1);
       return (msw << 16) | lsw;
     }
 
-    return common::read<u32>(rom.data(), address);
+    return common::read<u32>(rom->Data(), address);
   }
 
   void ALWAYS_INLINE WriteROM(u32 address, u16 value) {
@@ -143,7 +208,72 @@ struct GamePak {
     }
   }
 
+  void CommitBackup() {
+    if (backup_sram != nullptr) {
+      backup_sram->Commit();
+    }
+    if (backup_eeprom != nullptr) {
+      backup_eeprom->Commit();
+    }
+  }
+
+  /// See Backup::SetSpeculative().
+  void SetBackupSpeculative(bool speculative) {
+    if (backup_sram != nullptr) {
+      backup_sram->SetSpeculative(speculative);
+    }
+    if (backup_eeprom != nullptr) {
+      backup_eeprom->SetSpeculative(speculative);
+    }
+  }
+
+  /**
+   * Puts the backup memory aside for an erased one that is kept in memory only,
+   * e.g. while a movie plays, so that the save file is neither read nor written,
+   * or puts the original back. The contents of the memory-only backup
+   * are expected to be restored from a save state.
+   */
+  void SetBackupInMemory(bool in_memory) {
+    if (in_memory == (file_backup_sram || file_backup_eeprom)) {
+      return;
+    }
+
+    if (in_memory) {
+      std::swap(backup_sram, file_backup_sram);
+      std::swap(backup_eeprom, file_backup_eeprom);
+      if (file_backup_sram != nullptr) {
+        backup_sram = file_backup_sram->Clone();
+      }
+      if (file_backup_eeprom != nullptr) {
+        backup_eeprom = file_backup_eeprom->Clone();
+      }
+    } else {
+      backup_sram = std::move(file_backup_sram);
+      backup_eeprom = std::move(file_backup_eeprom);
+    }
+  }
+
+  /// See RTC, does nothing if the cartridge has no clock.
+  void SetClockBaseTime(s64 base_time) {
+    if (gpio != nullptr) {
+      gpio->SetClockBaseTime(base_time);
+    }
+  }
+
+  /**
+   * Sends every ROM read down the reference path instead of the page table,
+   * e.g. to check the page table against the reference path.
+   */
+  void DisablePageTable() {
+    pages.fill(nullptr);
+  }
+
+  void LoadState(SaveState const& state);
+  void CopyState(SaveState& state);
+
 private:
+  void BuildPageTable();
+
   bool ALWAYS_INLINE IsGPIO(u32 address) {
     return gpio && address >= 0xC4 && address <= 0xC8;
   }
@@ -152,13 +282,32 @@ private:
     return backup_eeprom && (address & eeprom_mask) == eeprom_mask;
   }
 
-  std::vector<u8> rom;
+  std::shared_ptr<ROM const> rom;
+  RomAnalysis analysis;
   std::unique_ptr<Backup> backup_sram;
   std::unique_ptr<Backup> backup_eeprom;
   std::unique_ptr<GPIO> gpio;
 
+  /// The backup memory that is put aside by SetBackupInMemory().
+  std::unique_ptr<Backup> file_backup_sram;
+  std::unique_ptr<Backup> file_backup_eeprom;
+
   u32 rom_mask = 0;
   u32 eeprom_mask = 0;
+
+  static constexpr int kPageBits = 16;
+  static constexpr int kPageSize = 1 << kPageBits;
+  static constexpr int kPageMask = kPageSize - 1;
+  static constexpr int kPageCount = 0x0200'0000 >> kPageBits;
+
+  /* Pointer to the data for each 64 KiB page of the ROM address space,
+   * with mirroring and open bus already taken care of.
+   * Pages that contain GPIO or EEPROM registers are set to nullptr.
+   */
+  std::array<u8 const*, kPageCount> pages;
+
+  /// Page holding both ROM data and open bus values, if the ROM needs one.
+  std::unique_ptr<u8[]> materialized_page;
 };
 
 } // namespace nba
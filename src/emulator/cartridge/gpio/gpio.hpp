@@ -10,6 +10,8 @@
 #include <cassert>
 #include <emulator/core/scheduler.hpp>
 #include <emulator/core/hw/interrupt.hpp>
+#include <emulator/save_state.hpp>
+#include <memory>
 
 namespace nba {
 
@@ -33,6 +35,15 @@ struct GPIO {
 
   void Reset();
 
+  virtual void LoadState(SaveState const& state);
+  virtual void CopyState(SaveState& state);
+
+  /// Creates a device of the same type in its reset state, that is connected to another machine.
+  virtual auto Clone(nba::core::Scheduler* scheduler, nba::core::IRQ* irq) const -> std::unique_ptr<GPIO> = 0;
+
+  /// See RTC. Devices without a clock ignore it.
+  virtual void SetClockBaseTime(s64) { }
+
   auto GetPortDirection(int port) const -> PortDirection {
     assert(port < 4);
     return direction[port];
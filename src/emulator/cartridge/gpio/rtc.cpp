@@ -14,6 +14,8 @@ namespace nba {
 
 constexpr int RTC::s_argument_count[8];
 
+static constexpr u64 kCyclesPerSecond = 16777216;
+
 void RTC::Reset() {
   // FIXME: this is a very funky construct.
   // This method should probably be virtual, but it's called
@@ -183,23 +185,21 @@ void RTC::ReadRegister() {
       break;
     }
     case Register::DateTime: {
-      auto timestamp = std::time(nullptr);
-      auto time = std::localtime(&timestamp);
-      buffer[0] = ConvertDecimalToBCD(time->tm_year - 100);
-      buffer[1] = ConvertDecimalToBCD(1 + time->tm_mon);
-      buffer[2] = ConvertDecimalToBCD(time->tm_mday);
-      buffer[3] = ConvertDecimalToBCD(time->tm_wday);
-      buffer[4] = ConvertDecimalToBCD(time->tm_hour);
-      buffer[5] = ConvertDecimalToBCD(time->tm_min);
-      buffer[6] = ConvertDecimalToBCD(time->tm_sec);
+      auto time = GetDateTime();
+      buffer[0] = ConvertDecimalToBCD(time.tm_year - 100);
+      buffer[1] = ConvertDecimalToBCD(1 + time.tm_mon);
+      buffer[2] = ConvertDecimalToBCD(time.tm_mday);
+      buffer[3] = ConvertDecimalToBCD(time.tm_wday);
+      buffer[4] = ConvertDecimalToBCD(time.tm_hour);
+      buffer[5] = ConvertDecimalToBCD(time.tm_min);
+      buffer[6] = ConvertDecimalToBCD(time.tm_sec);
       break;
     }
     case Register::Time: {
-      auto timestamp = std::time(nullptr);
-      auto time = std::localtime(&timestamp);
-      buffer[0] = ConvertDecimalToBCD(time->tm_hour);
-      buffer[1] = ConvertDecimalToBCD(time->tm_min);
-      buffer[2] = ConvertDecimalToBCD(time->tm_sec);
+      auto time = GetDateTime();
+      buffer[0] = ConvertDecimalToBCD(time.tm_hour);
+      buffer[1] = ConvertDecimalToBCD(time.tm_min);
+      buffer[2] = ConvertDecimalToBCD(time.tm_sec);
       break;
     }
   }
@@ -229,4 +229,27 @@ void RTC::WriteRegister() {
   }
 }
 
+auto RTC::GetDateTime() const -> std::tm {
+  auto time = std::tm{};
+
+  // The reentrant variants, since other emulator instances may run on other threads.
+  if (base_time >= 0) {
+    auto timestamp = std::time_t(base_time + s64(scheduler->GetTimestampNow() / kCyclesPerSecond));
+#ifdef WIN32
+    gmtime_s(&time, &timestamp);
+#else
+    gmtime_r(&timestamp, &time);
+#endif
+  } else {
+    auto timestamp = std::time(nullptr);
+#ifdef WIN32
+    localtime_s(&time, &timestamp);
+#else
+    localtime_r(&timestamp, &time);
+#endif
+  }
+
+  return time;
+}
+
 } // namespace nba
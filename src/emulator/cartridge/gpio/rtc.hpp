@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <ctime>
+
 #include "gpio.hpp"
 
 namespace nba {
@@ -34,15 +36,32 @@ struct RTC : GPIO {
     Free = 7
   };
 
+  /**
+   * With a base time (seconds since the Unix epoch, UTC) the clock shows that time at reset
+   * and advances with the emulated cycles. Without one (a negative value) it shows the host's local time.
+   */
   RTC(
     nba::core::Scheduler* scheduler,
-    nba::core::IRQ* irq
-  )   : GPIO(scheduler, irq) {
+    nba::core::IRQ* irq,
+    s64 base_time = -1
+  )   : GPIO(scheduler, irq)
+      , base_time(base_time) {
     Reset();
   }
 
   void Reset();
 
+  void LoadState(SaveState const& state) final;
+  void CopyState(SaveState& state) final;
+
+  auto Clone(nba::core::Scheduler* scheduler, nba::core::IRQ* irq) const -> std::unique_ptr<GPIO> final {
+    return std::make_unique<RTC>(scheduler, irq, base_time);
+  }
+
+  void SetClockBaseTime(s64 base_time) final {
+    this->base_time = base_time;
+  }
+
 protected:
   auto ReadPort() -> u8 final;
   void WritePort(u8 value) final;
@@ -54,6 +73,7 @@ private:
   void TransmitBufferSIO();
   void ReadRegister();
   void WriteRegister();
+  auto GetDateTime() const -> std::tm;
 
   static auto ConvertDecimalToBCD(u8 x) -> u8 {
     u8 y = 0;
@@ -68,6 +88,8 @@ private:
     return y;
   }
 
+  s64 base_time;
+
   int current_bit;
   int current_byte;
 
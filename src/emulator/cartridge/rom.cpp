@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <common/hash.hpp>
+#include <common/log.hpp>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <tuple>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define NBA_ROM_MMAP
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+#include "rom.hpp"
+
+namespace nba {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct CacheKey {
+  std::string path;
+  fs::file_time_type mtime;
+  uintmax_t size;
+
+  bool operator<(CacheKey const& other) const {
+    return std::tie(path, mtime, size) < std::tie(other.path, other.mtime, other.size);
+  }
+};
+
+std::mutex g_cache_lock;
+std::map<CacheKey, std::weak_ptr<ROM const>> g_cache;
+
+} // namespace
+
+ROM::ROM(std::vector<u8>&& buffer) : buffer(std::move(buffer)) {
+  size = this->buffer.size();
+  // Pad to the next 32-bit boundary, see ROM class comment.
+  this->buffer.resize((size + 3) & ~size_t(3));
+  data = this->buffer.data();
+  hash = common::xxh64(data, size);
+}
+
+ROM::~ROM() {
+#ifdef NBA_ROM_MMAP
+  if (mapping != nullptr) {
+    munmap(mapping, mapping_size);
+  }
+#endif
+}
+
+auto ROM::Open(std::string const& path) -> std::shared_ptr<ROM const> {
+  std::error_code error;
+
+  auto key = CacheKey{
+    fs::canonical(path, error).string(),
+    fs::last_write_time(path, error),
+    fs::file_size(path, error)
+  };
+
+  if (error) {
+    return {};
+  }
+
+  std::lock_guard guard{g_cache_lock};
+
+  if (auto match = g_cache.find(key); match != g_cache.end()) {
+    if (auto rom = match->second.lock()) {
+      return rom;
+    }
+  }
+
+  // Drop entries of images that are not in use anymore.
+  for (auto it = g_cache.begin(); it != g_cache.end();) {
+    if (it->second.expired()) {
+      it = g_cache.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  auto rom = Map(key.path, key.size);
+
+  if (!rom) {
+    std::ifstream stream{key.path, std::ios::binary};
+    if (!stream.good()) {
+      return {};
+    }
+
+    auto buffer = std::vector<u8>(key.size);
+    stream.read((char*)buffer.data(), key.size);
+    if (!stream.good()) {
+      return {};
+    }
+    rom = std::make_shared<ROM const>(std::move(buffer));
+  }
+
+  g_cache[key] = rom;
+  return rom;
+}
+
+auto ROM::Map(std::string const& path, size_t size) -> std::shared_ptr<ROM const> {
+#ifdef NBA_ROM_MMAP
+  if (size == 0) {
+    return {};
+  }
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return {};
+  }
+
+  // Mapping a file also maps the remainder of its last page, which reads as zero.
+  // If the size is page-aligned it is also 32-bit aligned, so no padding is needed.
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  // Prefault the whole image now, rather than taking page faults during emulation.
+  flags |= MAP_POPULATE;
+#endif
+
+  void* mapping = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    LOG_WARN("ROM: unable to memory-map {0}, falling back to reading it.", path);
+    return {};
+  }
+
+#ifdef MADV_HUGEPAGE
+  // Larger ROMs benefit from fewer TLB misses if the kernel can back them with huge pages.
+  madvise(mapping, size, MADV_HUGEPAGE);
+#endif
+  madvise(mapping, size, MADV_WILLNEED);
+
+  auto rom = std::shared_ptr<ROM>{new ROM{}};
+  rom->data = (u8 const*)mapping;
+  rom->size = size;
+  rom->mapping = mapping;
+  rom->mapping_size = size;
+  rom->hash = common::xxh64(rom->data, size);
+  return rom;
+#else
+  return {};
+#endif
+}
+
+} // namespace nba
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nba {
+
+/**
+ * Read-only ROM image.
+ *
+ * Images opened from disk are memory-mapped where the platform supports it,
+ * so that all emulator instances and processes running the same ROM share
+ * a single page cache copy. Images are always readable up to the next
+ * 32-bit boundary past their size, which allows word reads near the end
+ * of the ROM without a bounds check.
+ */
+struct ROM {
+  ROM(std::vector<u8>&& buffer);
+ ~ROM();
+
+  ROM(ROM const&) = delete;
+  auto operator=(ROM const&) -> ROM& = delete;
+
+  /**
+   * Opens a ROM image from disk. If the same (unmodified) file is
+   * currently opened by another emulator instance, the existing image is reused.
+   * Returns nullptr if the file could not be opened or read.
+   */
+  static auto Open(std::string const& path) -> std::shared_ptr<ROM const>;
+
+  auto Data() const -> u8 const* { return data; }
+  auto Size() const -> size_t { return size; }
+
+  /// XXH64 hash of the image, computed once when the image is loaded.
+  auto Hash() const -> u64 { return hash; }
+
+private:
+  ROM() = default;
+
+  static auto Map(std::string const& path, size_t size) -> std::shared_ptr<ROM const>;
+
+  u8 const* data = nullptr;
+  size_t size = 0;
+  u64 hash = 0;
+
+  /// Set if the image is memory-mapped.
+  void* mapping = nullptr;
+  size_t mapping_size = 0;
+
+  /// Set if the image lives on the heap.
+  std::vector<u8> buffer;
+};
+
+} // namespace nba
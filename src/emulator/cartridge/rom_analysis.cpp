@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <common/compiler.hpp>
+#include <common/log.hpp>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define NBA_ROM_ANALYSIS_SSE2
+  #include <emmintrin.h>
+#endif
+
+#include "rom_analysis.hpp"
+
+namespace nba {
+
+using namespace std::string_view_literals;
+using BackupType = Config::BackupType;
+
+namespace {
+
+enum class PatternType {
+  Backup,
+  M4ASampleFreqSet,
+  IdleLoop
+};
+
+struct Pattern {
+  std::string_view bytes;
+  PatternType type;
+  int alignment;
+  BackupType backup_type = BackupType::Detect;
+};
+
+/* All patterns must be at least two bytes long,
+ * since candidates are filtered by their first two bytes.
+ * Backup strings that are found at the same offset are resolved in table order.
+ */
+const Pattern g_patterns[] {
+  { "EEPROM_V"sv,   PatternType::Backup, 4, BackupType::EEPROM_64 },
+  { "SRAM_V"sv,     PatternType::Backup, 4, BackupType::SRAM      },
+  { "SRAM_F_V"sv,   PatternType::Backup, 4, BackupType::SRAM      },
+  { "FLASH_V"sv,    PatternType::Backup, 4, BackupType::FLASH_64  },
+  { "FLASH512_V"sv, PatternType::Backup, 4, BackupType::FLASH_64  },
+  { "FLASH1M_V"sv,  PatternType::Backup, 4, BackupType::FLASH_128 },
+
+  { "\x53\x6D\x73\x68\x70\xB5\x02\x1C\x1E\x48\x04\x68\xF0\x20\x00\x03\x10\x40\x02\x0C"sv, PatternType::M4ASampleFreqSet, 1 },
+
+  /* swi 0x02 (Halt), swi 0x04 (IntrWait) and swi 0x05 (VBlankIntrWait) followed by bx lr. */
+  { "\x02\xDF\x70\x47"sv, PatternType::IdleLoop, 2 },
+  { "\x04\xDF\x70\x47"sv, PatternType::IdleLoop, 2 },
+  { "\x05\xDF\x70\x47"sv, PatternType::IdleLoop, 2 }
+};
+
+/* The M4A SampleFreqSet() routine starts after the "Smsh" signature and a pointer. */
+constexpr u32 g_m4a_setfreq_offset = 8;
+
+bool IsComplete(RomAnalysis const& analysis) {
+  return analysis.backup_type != BackupType::Detect &&
+         analysis.m4a_setfreq_address != 0 &&
+         analysis.idle_loops.size() == RomAnalysis::kMaxIdleLoops;
+}
+
+void Match(u8 const* rom, size_t size, size_t offset, RomAnalysis& analysis) {
+  for (auto const& pattern : g_patterns) {
+    auto& bytes = pattern.bytes;
+
+    if (rom[offset] != u8(bytes[0]) ||
+        (offset % pattern.alignment) != 0 ||
+        (offset + bytes.size()) > size ||
+        std::memcmp(&rom[offset], bytes.data(), bytes.size()) != 0) {
+      continue;
+    }
+
+    u32 address = 0x08000000 + offset;
+
+    switch (pattern.type) {
+      case PatternType::Backup:
+        if (analysis.backup_type == BackupType::Detect) {
+          LOG_INFO("Found ROM string indicating {0} backup type.", std::to_string(pattern.backup_type));
+          analysis.backup_type = pattern.backup_type;
+        }
+        break;
+      case PatternType::M4ASampleFreqSet:
+        if (analysis.m4a_setfreq_address == 0) {
+          analysis.m4a_setfreq_address = address + g_m4a_setfreq_offset;
+          LOG_INFO("Found M4A SetSampleFreq() routine at 0x{0:08X}.", analysis.m4a_setfreq_address);
+        }
+        break;
+      case PatternType::IdleLoop:
+        if (analysis.idle_loops.size() < RomAnalysis::kMaxIdleLoops) {
+          analysis.idle_loops.push_back(address);
+        }
+        break;
+    }
+  }
+}
+
+} // namespace
+
+auto RomAnalysis::Analyze(u8 const* rom, size_t size) -> RomAnalysis {
+  auto analysis = RomAnalysis{};
+  size_t offset = 0;
+
+#ifdef NBA_ROM_ANALYSIS_SSE2
+  /* Test 16 offsets at once against the first two bytes of every pattern
+   * and only run the full comparison for offsets that passed this filter.
+   */
+  __m128i first[std::size(g_patterns)];
+  __m128i second[std::size(g_patterns)];
+
+  for (size_t i = 0; i < std::size(g_patterns); i++) {
+    first[i] = _mm_set1_epi8(g_patterns[i].bytes[0]);
+    second[i] = _mm_set1_epi8(g_patterns[i].bytes[1]);
+  }
+
+  for (; offset + 17 <= size; offset += 16) {
+    auto lo = _mm_loadu_si128((__m128i const*)&rom[offset + 0]);
+    auto hi = _mm_loadu_si128((__m128i const*)&rom[offset + 1]);
+    auto hits = _mm_setzero_si128();
+
+    for (size_t i = 0; i < std::size(g_patterns); i++) {
+      hits = _mm_or_si128(hits, _mm_and_si128(_mm_cmpeq_epi8(lo, first[i]), _mm_cmpeq_epi8(hi, second[i])));
+    }
+
+    int mask = _mm_movemask_epi8(hits);
+
+    if (likely(mask == 0)) {
+      continue;
+    }
+
+    for (int bit = 0; mask != 0; bit++, mask >>= 1) {
+      if (mask & 1) {
+        Match(rom, size, offset + bit, analysis);
+      }
+    }
+
+    if (IsComplete(analysis)) {
+      return analysis;
+    }
+  }
+#endif
+
+  for (; offset < size; offset++) {
+    Match(rom, size, offset, analysis);
+  }
+
+  return analysis;
+}
+
+} // namespace nba
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+#include <emulator/config/config.hpp>
+#include <vector>
+
+namespace nba {
+
+/**
+ * Information gathered from a single scan over the ROM image,
+ * looking for strings and SDK routines of interest.
+ */
+struct RomAnalysis {
+  static constexpr int kMaxIdleLoops = 16;
+
+  /// Backup type indicated by a Nintendo SDK string, or Detect if none was found.
+  Config::BackupType backup_type = Config::BackupType::Detect;
+
+  /// Address of the M4A SampleFreqSet() routine, or zero if none was found.
+  u32 m4a_setfreq_address = 0;
+
+  /// Addresses of Thumb BIOS call stubs that wait for an interrupt.
+  std::vector<u32> idle_loops;
+
+  static auto Analyze(u8 const* rom, size_t size) -> RomAnalysis;
+};
+
+} // namespace nba
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <common/log.hpp>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <system_error>
+
+#include "rom_analysis_cache.hpp"
+
+namespace nba {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/* Bump this whenever the meaning of an entry changes,
+ * for example when new patterns are added to the ROM analysis.
+ */
+constexpr auto g_cache_header = "nba-rom-analysis-cache 2";
+
+/* Serializes read-modify-write cycles of emulator instances in this process.
+ * Other processes may still race, in which case the last writer wins
+ * and the cache merely misses the other entry.
+ */
+std::mutex g_cache_lock;
+
+auto ParseEntry(std::string const& line, u64& hash, RomAnalysis& analysis) -> bool {
+  std::istringstream stream{line};
+  int backup_type;
+  size_t idle_loop_count;
+
+  stream >> std::hex >> hash >> std::dec >> backup_type;
+  stream >> std::hex >> analysis.m4a_setfreq_address >> std::dec >> idle_loop_count;
+
+  if (stream.fail() ||
+      backup_type < 0 || backup_type > (int)Config::BackupType::EEPROM_64 ||
+      idle_loop_count > RomAnalysis::kMaxIdleLoops) {
+    return false;
+  }
+
+  analysis.backup_type = (Config::BackupType)backup_type;
+  analysis.idle_loops.resize(idle_loop_count);
+
+  for (auto& address : analysis.idle_loops) {
+    stream >> std::hex >> address;
+  }
+
+  return !stream.fail();
+}
+
+void WriteEntry(std::ostream& stream, u64 hash, RomAnalysis const& analysis) {
+  stream << std::hex << hash << std::dec;
+  stream << ' ' << (int)analysis.backup_type;
+  stream << ' ' << std::hex << analysis.m4a_setfreq_address << std::dec;
+  stream << ' ' << analysis.idle_loops.size();
+
+  for (auto address : analysis.idle_loops) {
+    stream << ' ' << std::hex << address << std::dec;
+  }
+
+  stream << '\n';
+}
+
+} // namespace
+
+auto RomAnalysisCache::Find(u64 hash) -> std::optional<RomAnalysis> {
+  std::lock_guard guard{g_cache_lock};
+
+  auto entries = Load();
+
+  if (auto match = entries.find(hash); match != entries.end()) {
+    return match->second;
+  }
+
+  return {};
+}
+
+void RomAnalysisCache::Insert(u64 hash, RomAnalysis const& analysis) {
+  std::lock_guard guard{g_cache_lock};
+
+  auto entries = Load();
+  entries[hash] = analysis;
+
+  // Write to a uniquely named temporary file, then atomically replace the cache.
+  auto tmp_path = path + "." + std::to_string(std::random_device{}()) + ".tmp";
+
+  {
+    std::ofstream stream{tmp_path, std::ios::out | std::ios::trunc};
+
+    stream << g_cache_header << '\n';
+    for (auto const& [hash, analysis] : entries) {
+      WriteEntry(stream, hash, analysis);
+    }
+
+    if (!stream.good()) {
+      LOG_ERROR("Failed to write ROM analysis cache: {0}", tmp_path);
+      stream.close();
+      std::error_code error;
+      fs::remove(tmp_path, error);
+      return;
+    }
+  }
+
+  std::error_code error;
+  fs::rename(tmp_path, path, error);
+  if (error) {
+    LOG_ERROR("Unable to replace ROM analysis cache: {0} ({1})", path, error.message());
+    fs::remove(tmp_path, error);
+  }
+}
+
+auto RomAnalysisCache::Load() -> std::map<u64, RomAnalysis> {
+  auto entries = std::map<u64, RomAnalysis>{};
+  auto stream = std::ifstream{path};
+  auto line = std::string{};
+
+  if (!stream.good() || !std::getline(stream, line) || line != g_cache_header) {
+    return entries;
+  }
+
+  while (std::getline(stream, line)) {
+    u64 hash;
+    RomAnalysis analysis;
+
+    if (ParseEntry(line, hash, analysis)) {
+      entries[hash] = std::move(analysis);
+    } else {
+      LOG_WARN("Skipping malformed ROM analysis cache entry: {0}", line);
+    }
+  }
+
+  return entries;
+}
+
+} // namespace nba
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "rom_analysis.hpp"
+
+namespace nba {
+
+/**
+ * On-disk cache of ROM analysis results, keyed by the hash of the ROM image.
+ * The cache file may be shared between multiple emulator instances and processes.
+ * Game database matches are cheap and not cached, so that fixes to the database apply at once.
+ */
+struct RomAnalysisCache {
+  RomAnalysisCache(std::string const& path) : path(path) {}
+
+  auto Find(u64 hash) -> std::optional<RomAnalysis>;
+  void Insert(u64 hash, RomAnalysis const& analysis);
+
+private:
+  auto Load() -> std::map<u64, RomAnalysis>;
+
+  std::string path;
+};
+
+} // namespace nba
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include "game_pak.hpp"
+
+namespace nba {
+
+void GamePak::LoadState(SaveState const& state) {
+  if (backup_sram != nullptr) {
+    backup_sram->LoadState(state);
+  }
+  if (backup_eeprom != nullptr) {
+    backup_eeprom->LoadState(state);
+  }
+  if (gpio != nullptr) {
+    gpio->LoadState(state);
+  }
+}
+
+void GamePak::CopyState(SaveState& state) {
+  state.backup.size = 0;
+  state.gpio = {};
+
+  if (backup_sram != nullptr) {
+    backup_sram->CopyState(state);
+  }
+  if (backup_eeprom != nullptr) {
+    backup_eeprom->CopyState(state);
+  }
+  if (gpio != nullptr) {
+    gpio->CopyState(state);
+  }
+}
+
+void FLASH::LoadState(SaveState const& state) {
+  file->LoadState(state.backup);
+  current_bank = state.backup.flash.current_bank;
+  phase = state.backup.flash.phase;
+  enable_chip_id = state.backup.flash.enable_chip_id;
+  enable_erase = state.backup.flash.enable_erase;
+  enable_write = state.backup.flash.enable_write;
+  enable_select = state.backup.flash.enable_select;
+}
+
+void FLASH::CopyState(SaveState& state) {
+  file->CopyState(state.backup);
+  state.backup.flash.current_bank = current_bank;
+  state.backup.flash.phase = phase;
+  state.backup.flash.enable_chip_id = enable_chip_id;
+  state.backup.flash.enable_erase = enable_erase;
+  state.backup.flash.enable_write = enable_write;
+  state.backup.flash.enable_select = enable_select;
+}
+
+void EEPROM::LoadState(SaveState const& state) {
+  file->LoadState(state.backup);
+  this->state = state.backup.eeprom.state;
+  address = state.backup.eeprom.address;
+  serial_buffer = state.backup.eeprom.serial_buffer;
+  transmitted_bits = state.backup.eeprom.transmitted_bits;
+}
+
+void EEPROM::CopyState(SaveState& state) {
+  file->CopyState(state.backup);
+  state.backup.eeprom.state = this->state;
+  state.backup.eeprom.address = address;
+  state.backup.eeprom.serial_buffer = serial_buffer;
+  state.backup.eeprom.transmitted_bits = transmitted_bits;
+}
+
+void GPIO::LoadState(SaveState const& state) {
+  allow_reads = state.gpio.allow_reads;
+  for (int i = 0; i < 4; i++) {
+    direction[i] = (PortDirection)state.gpio.direction[i];
+  }
+  port_data = state.gpio.port_data;
+  UpdateReadWriteMasks();
+}
+
+void GPIO::CopyState(SaveState& state) {
+  state.gpio.allow_reads = allow_reads;
+  for (int i = 0; i < 4; i++) {
+    state.gpio.direction[i] = (int)direction[i];
+  }
+  state.gpio.port_data = port_data;
+}
+
+void RTC::LoadState(SaveState const& state) {
+  auto& rtc = state.gpio.rtc;
+
+  GPIO::LoadState(state);
+
+  current_bit = rtc.current_bit;
+  current_byte = rtc.current_byte;
+  reg = (Register)rtc.reg;
+  data = rtc.data;
+  for (int i = 0; i < 7; i++) {
+    buffer[i] = rtc.buffer[i];
+  }
+  port.sck = rtc.sck;
+  port.sio = rtc.sio;
+  port.cs = rtc.cs;
+  this->state = (State)rtc.state;
+  control.unknown = rtc.unknown;
+  control.per_minute_irq = rtc.per_minute_irq;
+  control.mode_24h = rtc.mode_24h;
+  control.poweroff = rtc.poweroff;
+}
+
+void RTC::CopyState(SaveState& state) {
+  auto& rtc = state.gpio.rtc;
+
+  GPIO::CopyState(state);
+
+  rtc.current_bit = current_bit;
+  rtc.current_byte = current_byte;
+  rtc.reg = (int)reg;
+  rtc.data = data;
+  for (int i = 0; i < 7; i++) {
+    rtc.buffer[i] = buffer[i];
+  }
+  rtc.sck = port.sck;
+  rtc.sio = port.sio;
+  rtc.cs = port.cs;
+  rtc.state = (int)this->state;
+  rtc.unknown = control.unknown;
+  rtc.per_minute_irq = control.per_minute_irq;
+  rtc.mode_24h = control.mode_24h;
+  rtc.poweroff = control.poweroff;
+}
+
+} // namespace nba
@@ -22,6 +22,16 @@ struct Config {
   
   bool skip_bios = false;
   bool sync_to_audio = false;
+
+  /* Number of frames that are emulated ahead of the displayed frame,
+   * to hide input lag that games add internally. Zero disables run-ahead.
+   */
+  int run_ahead = 0;
+
+  /* Save the machine state next to the save file when the emulator exits
+   * and continue from it, instead of booting, when the game is loaded again.
+   */
+  bool suspend_resume = false;
   
   enum class BackupType {
     Detect,
@@ -35,6 +45,45 @@ struct Config {
   
   bool force_rtc = false;
 
+  /* Seconds since the Unix epoch (UTC) that the cartridge clock shows at reset.
+   * From there on it advances with the emulated cycles, so that runs can be reproduced.
+   * A negative value makes the clock show the host's local time instead.
+   */
+  s64 rtc_base_time = -1;
+
+  /* Write save files atomically (temporary file + rename) on an I/O thread,
+   * instead of updating the save file in-place on every write.
+   */
+  bool atomic_save = false;
+
+  /* Keep the save in memory only: the save file is neither read nor written
+   * and every run starts with an erased backup. Takes precedence over atomic_save.
+   */
+  bool memory_save = false;
+
+  /* Path of the file that caches ROM analysis results between runs.
+   * An empty path disables the cache.
+   */
+  std::string analysis_cache_path = "";
+
+  /* Folder that save files (and suspended sessions) are kept in.
+   * An empty path keeps them next to the ROM.
+   */
+  std::string save_folder = "";
+
+  /* Run the reference implementation wherever the core has a fast path
+   * (currently the ROM page table). Used to check the fast paths, see Lockstep.
+   */
+  bool reference_paths = false;
+
+  struct Rewind {
+    bool enable = false;
+    /// Number of frames between two snapshots.
+    int interval = 4;
+    /// Memory budget for the snapshot history in MiB.
+    int max_memory = 64;
+  } rewind;
+
   struct Video {
     bool fullscreen = false;
     int scale = 2;
@@ -57,6 +106,9 @@ struct Config {
     bool m4a_xq_enable = false;
   } audio;
   
+  /* Devices hold callbacks into the emulator that they were given to,
+   * so every emulator instance needs its own set of devices.
+   */
   std::shared_ptr<AudioDevice> audio_dev = std::make_shared<NullAudioDevice>();
   std::shared_ptr<InputDevice> input_dev = std::make_shared<NullInputDevice>();
   std::shared_ptr<VideoDevice> video_dev = std::make_shared<NullVideoDevice>();
@@ -40,6 +40,8 @@ void config_toml_read(Config& config, std::string const& path) {
       config.bios_path = toml::find_or<std::string>(general, "bios_path", "bios.bin");
       config.skip_bios = toml::find_or<toml::boolean>(general, "bios_skip", false);
       config.sync_to_audio = toml::find_or<toml::boolean>(general, "sync_to_audio", true);
+      config.run_ahead = toml::find_or<int>(general, "run_ahead", 0);
+      config.suspend_resume = toml::find_or<toml::boolean>(general, "suspend_resume", false);
     }
   }
 
@@ -70,6 +72,30 @@ void config_toml_read(Config& config, std::string const& path) {
       }
 
       config.force_rtc = toml::find_or<toml::boolean>(cartridge, "force_rtc", false);
+      config.atomic_save = toml::find_or<toml::boolean>(cartridge, "atomic_save", false);
+      config.analysis_cache_path = toml::find_or<std::string>(cartridge, "analysis_cache", "");
+      config.save_folder = toml::find_or<std::string>(cartridge, "save_folder", "");
+    }
+  }
+
+  if (data.contains("rewind")) {
+    auto rewind_result = toml::expect<toml::value>(data.at("rewind"));
+
+    if (rewind_result.is_ok()) {
+      auto rewind = rewind_result.unwrap();
+      config.rewind.enable = toml::find_or<toml::boolean>(rewind, "enable", false);
+      config.rewind.interval = toml::find_or<int>(rewind, "interval", 4);
+      config.rewind.max_memory = toml::find_or<int>(rewind, "max_memory", 64);
+
+      if (config.rewind.interval <= 0) {
+        LOG_WARN("Rewind interval {0} is not valid, defaulting to 4 frames.", config.rewind.interval);
+        config.rewind.interval = 4;
+      }
+
+      if (config.rewind.max_memory <= 0) {
+        LOG_WARN("Rewind memory budget {0} is not valid, defaulting to 64 MiB.", config.rewind.max_memory);
+        config.rewind.max_memory = 64;
+      }
     }
   }
 
@@ -131,6 +157,8 @@ void config_toml_write(Config& config, std::string const& path) {
   data["general"]["bios_path"] = config.bios_path;
   data["general"]["bios_skip"] = config.skip_bios;
   data["general"]["sync_to_audio"] = config.sync_to_audio;
+  data["general"]["run_ahead"] = config.run_ahead;
+  data["general"]["suspend_resume"] = config.suspend_resume;
 
   // Cartridge
   std::string save_type;
@@ -145,6 +173,14 @@ void config_toml_write(Config& config, std::string const& path) {
   }
   data["cartridge"]["save_type"] = save_type;
   data["cartridge"]["force_rtc"] = config.force_rtc;
+  data["cartridge"]["atomic_save"] = config.atomic_save;
+  data["cartridge"]["analysis_cache"] = config.analysis_cache_path;
+  data["cartridge"]["save_folder"] = config.save_folder;
+
+  // Rewind
+  data["rewind"]["enable"] = config.rewind.enable;
+  data["rewind"]["interval"] = config.rewind.interval;
+  data["rewind"]["max_memory"] = config.rewind.max_memory;
 
   // Video
   data["video"]["fullscreen"] = config.video.fullscreen;
@@ -10,7 +10,9 @@
 #include <array>
 #include <common/compiler.hpp>
 #include <common/log.hpp>
+#include <common/trace.hpp>
 #include <emulator/core/scheduler.hpp>
+#include <emulator/save_state.hpp>
 
 #include "memory.hpp"
 #include "state.hpp"
@@ -40,6 +42,59 @@ struct ARM7TDMI {
     cpu_mode_is_invalid = false;
   }
 
+  void LoadState(SaveState const& save_state) {
+    auto& arm = save_state.arm;
+
+    for (int i = 0; i < 16; i++) {
+      state.reg[i] = arm.reg[i];
+    }
+
+    for (int i = 0; i < BANK_COUNT; i++) {
+      for (int j = 0; j < 7; j++) {
+        state.bank[i][j] = arm.bank[i][j];
+      }
+      state.spsr[i].v = arm.spsr[i];
+    }
+
+    state.cpsr.v = arm.cpsr;
+
+    if (auto bank = GetRegisterBankByMode(state.cpsr.f.mode); bank != BANK_NONE) {
+      p_spsr = &state.spsr[bank];
+    } else {
+      p_spsr = &state.cpsr;
+    }
+
+    pipe.opcode[0] = arm.pipe.opcode[0];
+    pipe.opcode[1] = arm.pipe.opcode[1];
+    pipe.fetch_type = (Access)arm.pipe.fetch_type;
+    irq_line = arm.irq_line;
+    ldm_usermode_conflict = arm.ldm_usermode_conflict;
+    cpu_mode_is_invalid = arm.cpu_mode_is_invalid;
+  }
+
+  void CopyState(SaveState& save_state) {
+    auto& arm = save_state.arm;
+
+    for (int i = 0; i < 16; i++) {
+      arm.reg[i] = state.reg[i];
+    }
+
+    for (int i = 0; i < BANK_COUNT; i++) {
+      for (int j = 0; j < 7; j++) {
+        arm.bank[i][j] = state.bank[i][j];
+      }
+      arm.spsr[i] = state.spsr[i].v;
+    }
+
+    arm.cpsr = state.cpsr.v;
+    arm.pipe.opcode[0] = pipe.opcode[0];
+    arm.pipe.opcode[1] = pipe.opcode[1];
+    arm.pipe.fetch_type = (int)pipe.fetch_type;
+    arm.irq_line = irq_line;
+    arm.ldm_usermode_conflict = ldm_usermode_conflict;
+    arm.cpu_mode_is_invalid = cpu_mode_is_invalid;
+  }
+
   auto GetPrefetchedOpcode(int slot) -> u32 {
     return pipe.opcode[slot];
   }
@@ -53,6 +108,7 @@ struct ARM7TDMI {
 
     if (state.cpsr.f.thumb) {
       state.r15 &= ~1;
+      scheduler.stats.thumb_instructions++;
 
       pipe.opcode[0] = pipe.opcode[1];
       code = true;
@@ -61,6 +117,7 @@ struct ARM7TDMI {
       (this->*s_opcode_lut_16[instruction >> 6])(instruction);
     } else {
       state.r15 &= ~3;
+      scheduler.stats.arm_instructions++;
 
       pipe.opcode[0] = pipe.opcode[1];
       code = true;
@@ -121,6 +178,14 @@ struct ARM7TDMI {
   typedef void (ARM7TDMI::*Handler16)(u16);
   typedef void (ARM7TDMI::*Handler32)(u32);
 
+protected:
+  /* The scheduler is constructed after the ARM core,
+   * so the event handler is registered by the derived class.
+   */
+  void OnLDMUsermodeConflictEnd() {
+    ldm_usermode_conflict = false;
+  }
+
 private:
   friend struct TableGen;
 
@@ -177,6 +242,8 @@ private:
       return;
     }
 
+    common::trace::async_begin("arm", "irq", u64(uintptr_t(this)), scheduler.GetTimestampNow());
+
     // Prefetch the next instruction
     // The result will be discarded because we flush the pipeline.
     // But this is important for timing nonetheless.
@@ -264,9 +331,9 @@ private:
 
   bool irq_line;
 
-  static std::array<bool, 256> s_condition_lut;
-  static std::array<Handler16, 1024> s_opcode_lut_16;
-  static std::array<Handler32, 4096> s_opcode_lut_32;
+  static const std::array<bool, 256> s_condition_lut;
+  static const std::array<Handler16, 1024> s_opcode_lut_16;
+  static const std::array<Handler32, 4096> s_opcode_lut_32;
 };
 
 } // namespace nba::core::arm
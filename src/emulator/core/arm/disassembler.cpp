@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <fmt/format.h>
+
+#include "disassembler.hpp"
+
+namespace nba::core::arm {
+
+static const char* g_condition_names[16] {
+  "eq", "ne", "cs", "cc", "mi", "pl", "vs", "vc",
+  "hi", "ls", "ge", "lt", "gt", "le", "", "nv"
+};
+
+static const char* g_register_names[16] {
+  "r0", "r1", "r2",  "r3",  "r4",  "r5", "r6", "r7",
+  "r8", "r9", "r10", "r11", "r12", "sp", "lr", "pc"
+};
+
+static const char* g_shift_names[4] {
+  "lsl", "lsr", "asr", "ror"
+};
+
+static const char* g_data_processing_names[16] {
+  "and", "eor", "sub", "rsb", "add", "adc", "sbc", "rsc",
+  "tst", "teq", "cmp", "cmn", "orr", "mov", "bic", "mvn"
+};
+
+static auto reg(u32 opcode, int shift) -> const char* {
+  return g_register_names[(opcode >> shift) & 15];
+}
+
+static auto register_list(u32 list) -> std::string {
+  auto result = std::string{"{"};
+
+  for (int i = 0; i < 16; i++) {
+    if (~list & (1 << i)) {
+      continue;
+    }
+
+    // Ranges of three or more registers are shortened to "r0-r3".
+    int last = i;
+    while (last < 15 && (list & (1 << (last + 1)))) {
+      last++;
+    }
+
+    if (result.size() > 1) {
+      result += ", ";
+    }
+    result += g_register_names[i];
+    if (last - i >= 2) {
+      result += fmt::format("-{0}", g_register_names[last]);
+      i = last;
+    }
+  }
+
+  return result + "}";
+}
+
+static auto shifted_register(u32 opcode) -> std::string {
+  auto rm = reg(opcode, 0);
+  auto type = (opcode >> 5) & 3;
+
+  if (opcode & (1 << 4)) {
+    return fmt::format("{0}, {1} {2}", rm, g_shift_names[type], reg(opcode, 8));
+  }
+
+  auto amount = (opcode >> 7) & 31;
+
+  if (amount == 0) {
+    switch (type) {
+      case 0: return rm;
+      case 3: return fmt::format("{0}, rrx", rm);
+      default: amount = 32; break;
+    }
+  }
+
+  return fmt::format("{0}, {1} #{2}", rm, g_shift_names[type], amount);
+}
+
+static auto disassemble_data_processing(u32 opcode, const char* cond) -> std::string {
+  auto op = (opcode >> 21) & 15;
+  auto set_flags = (opcode & (1 << 20)) && (op < 8 || op > 11) ? "s" : "";
+  auto operand = std::string{};
+
+  if (opcode & (1 << 25)) {
+    auto imm = opcode & 0xFF;
+    auto rotate = ((opcode >> 8) & 15) * 2;
+    operand = fmt::format("#0x{0:X}", rotate == 0 ? imm : (imm >> rotate) | (imm << (32 - rotate)));
+  } else {
+    operand = shifted_register(opcode);
+  }
+
+  auto name = g_data_processing_names[op];
+
+  switch (op) {
+    case 0b1000:
+    case 0b1001:
+    case 0b1010:
+    case 0b1011:
+      return fmt::format("{0}{1} {2}, {3}", name, cond, reg(opcode, 16), operand);
+    case 0b1101:
+    case 0b1111:
+      return fmt::format("{0}{1}{2} {3}, {4}", name, cond, set_flags, reg(opcode, 12), operand);
+    default:
+      return fmt::format("{0}{1}{2} {3}, {4}, {5}", name, cond, set_flags, reg(opcode, 12), reg(opcode, 16), operand);
+  }
+}
+
+static auto address_operand(u32 opcode, std::string const& offset, bool is_zero) -> std::string {
+  auto rn = reg(opcode, 16);
+  auto pre = opcode & (1 << 24);
+  auto writeback = opcode & (1 << 21);
+
+  if (!pre) {
+    return fmt::format("[{0}], {1}", rn, offset);
+  }
+  if (is_zero) {
+    return fmt::format("[{0}]{1}", rn, writeback ? "!" : "");
+  }
+  return fmt::format("[{0}, {1}]{2}", rn, offset, writeback ? "!" : "");
+}
+
+auto DisassembleARM(u32 address, u32 opcode) -> std::string {
+  auto cond = g_condition_names[opcode >> 28];
+
+  // Branch and exchange
+  if ((opcode & 0x0FFFFFF0) == 0x012FFF10) {
+    return fmt::format("bx{0} {1}", cond, reg(opcode, 0));
+  }
+
+  // Multiply (accumulate)
+  if ((opcode & 0x0FC000F0) == 0x00000090) {
+    auto set_flags = (opcode & (1 << 20)) ? "s" : "";
+    if (opcode & (1 << 21)) {
+      return fmt::format("mla{0}{1} {2}, {3}, {4}, {5}", cond, set_flags, reg(opcode, 16), reg(opcode, 0), reg(opcode, 8), reg(opcode, 12));
+    }
+    return fmt::format("mul{0}{1} {2}, {3}, {4}", cond, set_flags, reg(opcode, 16), reg(opcode, 0), reg(opcode, 8));
+  }
+
+  // Multiply (accumulate) long
+  if ((opcode & 0x0F8000F0) == 0x00800090) {
+    auto sign = (opcode & (1 << 22)) ? "s" : "u";
+    auto name = (opcode & (1 << 21)) ? "mlal" : "mull";
+    auto set_flags = (opcode & (1 << 20)) ? "s" : "";
+    return fmt::format("{0}{1}{2}{3} {4}, {5}, {6}, {7}", sign, name, cond, set_flags, reg(opcode, 12), reg(opcode, 16), reg(opcode, 0), reg(opcode, 8));
+  }
+
+  // Single data swap
+  if ((opcode & 0x0FB00FF0) == 0x01000090) {
+    auto byte = (opcode & (1 << 22)) ? "b" : "";
+    return fmt::format("swp{0}{1} {2}, {3}, [{4}]", cond, byte, reg(opcode, 12), reg(opcode, 0), reg(opcode, 16));
+  }
+
+  // Halfword and signed data transfer
+  if ((opcode & 0x0E000090) == 0x00000090 && (opcode & 0x60) != 0) {
+    static const char* names[2][4] {
+      { "", "strh", "ldrd", "strd" },
+      { "", "ldrh", "ldrsb", "ldrsh" }
+    };
+
+    auto sign = (opcode & (1 << 23)) ? "" : "-";
+    auto offset = std::string{};
+    auto is_zero = false;
+
+    if (opcode & (1 << 22)) {
+      auto imm = ((opcode >> 4) & 0xF0) | (opcode & 15);
+      offset = fmt::format("#{0}0x{1:X}", sign, imm);
+      is_zero = imm == 0;
+    } else {
+      offset = fmt::format("{0}{1}", sign, reg(opcode, 0));
+    }
+
+    auto name = names[(opcode >> 20) & 1][(opcode >> 5) & 3];
+    return fmt::format("{0}{1} {2}, {3}", name, cond, reg(opcode, 12), address_operand(opcode, offset, is_zero));
+  }
+
+  // Status register transfer
+  if ((opcode & 0x0FBF0FFF) == 0x010F0000) {
+    return fmt::format("mrs{0} {1}, {2}", cond, reg(opcode, 12), (opcode & (1 << 22)) ? "spsr" : "cpsr");
+  }
+
+  if ((opcode & 0x0DB0F000) == 0x0120F000) {
+    auto fields = std::string{"_"};
+    if (opcode & (1 << 19)) fields += 'f';
+    if (opcode & (1 << 18)) fields += 's';
+    if (opcode & (1 << 17)) fields += 'x';
+    if (opcode & (1 << 16)) fields += 'c';
+
+    auto psr = (opcode & (1 << 22)) ? "spsr" : "cpsr";
+
+    if (opcode & (1 << 25)) {
+      auto imm = opcode & 0xFF;
+      auto rotate = ((opcode >> 8) & 15) * 2;
+      auto value = rotate == 0 ? imm : (imm >> rotate) | (imm << (32 - rotate));
+      return fmt::format("msr{0} {1}{2}, #0x{3:X}", cond, psr, fields, value);
+    }
+    return fmt::format("msr{0} {1}{2}, {3}", cond, psr, fields, reg(opcode, 0));
+  }
+
+  // Data processing
+  if ((opcode & 0x0C000000) == 0x00000000) {
+    return disassemble_data_processing(opcode, cond);
+  }
+
+  // Undefined
+  if ((opcode & 0x0E000010) == 0x06000010) {
+    return fmt::format("undefined{0}", cond);
+  }
+
+  // Single data transfer
+  if ((opcode & 0x0C000000) == 0x04000000) {
+    auto name = (opcode & (1 << 20)) ? "ldr" : "str";
+    auto byte = (opcode & (1 << 22)) ? "b" : "";
+    auto user = !(opcode & (1 << 24)) && (opcode & (1 << 21)) ? "t" : "";
+    auto sign = (opcode & (1 << 23)) ? "" : "-";
+    auto offset = std::string{};
+    auto is_zero = false;
+
+    if (opcode & (1 << 25)) {
+      offset = fmt::format("{0}{1}", sign, shifted_register(opcode));
+    } else {
+      offset = fmt::format("#{0}0x{1:X}", sign, opcode & 0xFFF);
+      is_zero = (opcode & 0xFFF) == 0;
+    }
+
+    return fmt::format("{0}{1}{2}{3} {4}, {5}", name, cond, byte, user, reg(opcode, 12), address_operand(opcode, offset, is_zero));
+  }
+
+  // Block data transfer
+  if ((opcode & 0x0E000000) == 0x08000000) {
+    static const char* modes[4] { "da", "ia", "db", "ib" };
+
+    auto name = (opcode & (1 << 20)) ? "ldm" : "stm";
+    auto mode = modes[(opcode >> 23) & 3];
+    auto writeback = (opcode & (1 << 21)) ? "!" : "";
+    auto user = (opcode & (1 << 22)) ? "^" : "";
+
+    return fmt::format("{0}{1}{2} {3}{4}, {5}{6}", name, cond, mode, reg(opcode, 16), writeback, register_list(opcode & 0xFFFF), user);
+  }
+
+  // Branch (with link)
+  if ((opcode & 0x0E000000) == 0x0A000000) {
+    auto offset = s32(opcode << 8) >> 6;
+    auto link = (opcode & (1 << 24)) ? "l" : "";
+    return fmt::format("b{0}{1} 0x{2:08X}", link, cond, address + 8 + offset);
+  }
+
+  // Software interrupt
+  if ((opcode & 0x0F000000) == 0x0F000000) {
+    return fmt::format("swi{0} 0x{1:06X}", cond, opcode & 0xFFFFFF);
+  }
+
+  return fmt::format("coprocessor{0} 0x{1:08X}", cond, opcode);
+}
+
+auto DisassembleThumb(u32 address, u16 opcode, u16 next_opcode) -> std::string {
+  auto rd = g_register_names[opcode & 7];
+  auto rs = g_register_names[(opcode >> 3) & 7];
+
+  // Move shifted register, add/subtract
+  if ((opcode & 0xE000) == 0x0000) {
+    auto op = (opcode >> 11) & 3;
+
+    if (op != 3) {
+      return fmt::format("{0}s {1}, {2}, #{3}", g_shift_names[op], rd, rs, (opcode >> 6) & 31);
+    }
+
+    auto name = (opcode & (1 << 9)) ? "sub" : "add";
+    if (opcode & (1 << 10)) {
+      return fmt::format("{0}s {1}, {2}, #{3}", name, rd, rs, (opcode >> 6) & 7);
+    }
+    return fmt::format("{0}s {1}, {2}, {3}", name, rd, rs, g_register_names[(opcode >> 6) & 7]);
+  }
+
+  // Move/compare/add/subtract immediate
+  if ((opcode & 0xE000) == 0x2000) {
+    static const char* names[4] { "movs", "cmp", "adds", "subs" };
+    return fmt::format("{0} {1}, #0x{2:X}", names[(opcode >> 11) & 3], g_register_names[(opcode >> 8) & 7], opcode & 0xFF);
+  }
+
+  // ALU operations
+  if ((opcode & 0xFC00) == 0x4000) {
+    static const char* names[16] {
+      "ands", "eors", "lsls", "lsrs", "asrs", "adcs", "sbcs", "rors",
+      "tst",  "negs", "cmp",  "cmn",  "orrs", "muls", "bics", "mvns"
+    };
+    return fmt::format("{0} {1}, {2}", names[(opcode >> 6) & 15], rd, rs);
+  }
+
+  // High register operations and branch exchange
+  if ((opcode & 0xFC00) == 0x4400) {
+    static const char* names[4] { "add", "cmp", "mov", "bx" };
+
+    auto op = (opcode >> 8) & 3;
+    auto hd = g_register_names[(opcode & 7) | ((opcode >> 4) & 8)];
+    auto hs = g_register_names[(opcode >> 3) & 15];
+
+    if (op == 3) {
+      return fmt::format("bx {0}", hs);
+    }
+    return fmt::format("{0} {1}, {2}", names[op], hd, hs);
+  }
+
+  // PC-relative load
+  if ((opcode & 0xF800) == 0x4800) {
+    auto target = ((address + 4) & ~3) + (opcode & 0xFF) * 4;
+    return fmt::format("ldr {0}, [pc, #0x{1:X}] ; 0x{2:08X}", g_register_names[(opcode >> 8) & 7], (opcode & 0xFF) * 4, target);
+  }
+
+  // Load/store with register offset, sign-extended byte/halfword
+  if ((opcode & 0xF000) == 0x5000) {
+    static const char* names[8] { "str", "strh", "strb", "ldrsb", "ldr", "ldrh", "ldrb", "ldrsh" };
+    return fmt::format("{0} {1}, [{2}, {3}]", names[(opcode >> 9) & 7], rd, rs, g_register_names[(opcode >> 6) & 7]);
+  }
+
+  // Load/store with immediate offset
+  if ((opcode & 0xE000) == 0x6000) {
+    auto load = opcode & (1 << 11);
+    auto byte = opcode & (1 << 12);
+    auto offset = ((opcode >> 6) & 31) * (byte ? 1 : 4);
+    return fmt::format("{0}{1} {2}, [{3}, #0x{4:X}]", load ? "ldr" : "str", byte ? "b" : "", rd, rs, offset);
+  }
+
+  // Load/store halfword
+  if ((opcode & 0xF000) == 0x8000) {
+    auto load = opcode & (1 << 11);
+    return fmt::format("{0} {1}, [{2}, #0x{3:X}]", load ? "ldrh" : "strh", rd, rs, ((opcode >> 6) & 31) * 2);
+  }
+
+  // SP-relative load/store
+  if ((opcode & 0xF000) == 0x9000) {
+    auto load = opcode & (1 << 11);
+    return fmt::format("{0} {1}, [sp, #0x{2:X}]", load ? "ldr" : "str", g_register_names[(opcode >> 8) & 7], (opcode & 0xFF) * 4);
+  }
+
+  // Load address
+  if ((opcode & 0xF000) == 0xA000) {
+    auto base = (opcode & (1 << 11)) ? "sp" : "pc";
+    return fmt::format("add {0}, {1}, #0x{2:X}", g_register_names[(opcode >> 8) & 7], base, (opcode & 0xFF) * 4);
+  }
+
+  // Add offset to stack pointer
+  if ((opcode & 0xFF00) == 0xB000) {
+    auto sign = (opcode & (1 << 7)) ? "-" : "";
+    return fmt::format("add sp, #{0}0x{1:X}", sign, (opcode & 0x7F) * 4);
+  }
+
+  // Push/pop registers
+  if ((opcode & 0xF600) == 0xB400) {
+    auto pop = opcode & (1 << 11);
+    auto list = u32(opcode & 0xFF);
+
+    if (opcode & (1 << 8)) {
+      list |= pop ? (1 << 15) : (1 << 14);
+    }
+    return fmt::format("{0} {1}", pop ? "pop" : "push", register_list(list));
+  }
+
+  // Multiple load/store
+  if ((opcode & 0xF000) == 0xC000) {
+    auto load = opcode & (1 << 11);
+    return fmt::format("{0} {1}!, {2}", load ? "ldmia" : "stmia", g_register_names[(opcode >> 8) & 7], register_list(opcode & 0xFF));
+  }
+
+  // Conditional branch, software interrupt
+  if ((opcode & 0xF000) == 0xD000) {
+    auto cond = (opcode >> 8) & 15;
+
+    if (cond == 15) {
+      return fmt::format("swi 0x{0:02X}", opcode & 0xFF);
+    }
+    if (cond == 14) {
+      return "undefined";
+    }
+
+    auto offset = s32(s8(opcode & 0xFF)) * 2;
+    return fmt::format("b{0} 0x{1:08X}", g_condition_names[cond], address + 4 + offset);
+  }
+
+  // Unconditional branch
+  if ((opcode & 0xF800) == 0xE000) {
+    auto offset = s32(u32(opcode) << 21) >> 20;
+    return fmt::format("b 0x{0:08X}", address + 4 + offset);
+  }
+
+  // Long branch with link
+  if ((opcode & 0xF800) == 0xF000) {
+    if ((next_opcode & 0xF800) != 0xF800) {
+      return "bl (prefix)";
+    }
+
+    auto offset = (s32(u32(opcode) << 21) >> 9) | ((next_opcode & 0x7FF) << 1);
+    return fmt::format("bl 0x{0:08X}", address + 4 + offset);
+  }
+
+  if ((opcode & 0xF800) == 0xF800) {
+    return "bl (suffix)";
+  }
+
+  return "undefined";
+}
+
+} // namespace nba::core::arm
@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+#include <string>
+
+namespace nba::core::arm {
+
+/// Disassembles an ARM instruction at the given address, e.g. "addeq r0, r1, #0x10".
+auto DisassembleARM(u32 address, u32 opcode) -> std::string;
+
+/**
+ * Disassembles a Thumb instruction at the given address.
+ * The following halfword is needed to decode the target of a BL instruction pair.
+ */
+auto DisassembleThumb(u32 address, u16 opcode, u16 next_opcode) -> std::string;
+
+} // namespace nba::core::arm
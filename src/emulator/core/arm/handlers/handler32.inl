@@ -157,6 +157,9 @@ void ARM_DataProcessing(u32 instruction) {
     if constexpr (set_flags) {
       auto spsr = GetSPSR();
 
+      if (state.cpsr.f.mode == MODE_IRQ) {
+        common::trace::async_end("arm", "irq", u64(uintptr_t(this)), scheduler.GetTimestampNow());
+      }
       SwitchMode(spsr.f.mode);
       state.cpsr.v = spsr.v;
     }
@@ -625,14 +628,15 @@ void ARM_BlockDataTransfer(u32 instruction) {
        * register accesses will go to both the user bank and original bank.
        */
       ldm_usermode_conflict = true;
-      scheduler.Add(2, [this](int late) {
-        ldm_usermode_conflict = false;
-      });
+      scheduler.Add(2, Scheduler::EventClass::ARM_LDMUsermodeConflict);
     }
 
     if (transfer_pc) {
       if constexpr (user_mode) {
         auto spsr = GetSPSR();
+        if (state.cpsr.f.mode == MODE_IRQ) {
+          common::trace::async_end("arm", "irq", u64(uintptr_t(this)), scheduler.GetTimestampNow());
+        }
         SwitchMode(spsr.f.mode);
         state.cpsr.v = spsr.v;
       }
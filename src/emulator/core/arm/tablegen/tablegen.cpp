@@ -83,8 +83,8 @@ struct TableGen {
   }
 };
 
-std::array<Handler16, 1024> ARM7TDMI::s_opcode_lut_16 = TableGen::GenerateTableThumb();
-std::array<Handler32, 4096> ARM7TDMI::s_opcode_lut_32 = TableGen::GenerateTableARM();
-std::array<bool, 256> ARM7TDMI::s_condition_lut = TableGen::GenerateConditionTable();
+const std::array<Handler16, 1024> ARM7TDMI::s_opcode_lut_16 = TableGen::GenerateTableThumb();
+const std::array<Handler32, 4096> ARM7TDMI::s_opcode_lut_32 = TableGen::GenerateTableARM();
+const std::array<bool, 256> ARM7TDMI::s_condition_lut = TableGen::GenerateConditionTable();
 
 } // namespace nba::core::arm
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+
+namespace nba::core {
+
+/**
+ * Breaks the emulated time down at the bus level: accesses and cycles per memory region,
+ * access type and width, cycles spent internally or halted, the efficiency of the
+ * GamePak prefetch buffer and the cycles taken by each DMA channel.
+ *
+ * Every cycle is counted for whatever the bus was doing when it elapsed.
+ * Cycles of a DMA are counted for the accesses of the DMA and additionally for its channel.
+ *
+ * Counters are only collected if the core is built with NBA_BUS_STATS,
+ * otherwise all methods compile to nothing.
+ */
+struct BusStats {
+#ifdef NBA_BUS_STATS
+  static constexpr bool kEnabled = true;
+#else
+  static constexpr bool kEnabled = false;
+#endif
+
+  /// Regions are the address bits 24-27, everything at 0x10000000 and above is region 0x10.
+  static constexpr int kRegionCount = 17;
+
+  enum class Width {
+    Byte,
+    Half,
+    Word,
+    Count
+  };
+
+  enum class Occasion {
+    Immediate,
+    VBlank,
+    HBlank,
+    FIFO,
+    Video,
+    Count
+  };
+
+  struct Counter {
+    u64 accesses = 0;
+    u64 cycles = 0;
+  };
+
+  struct Prefetch {
+    /// Opcode fetches from the GamePak that were served by the buffer.
+    u64 hits = 0;
+
+    /// Opcode fetches that waited for the fetch in progress to complete.
+    u64 stalls = 0;
+
+    /// Opcode fetches from the GamePak that went to the bus.
+    u64 misses = 0;
+
+    /// Times that buffered opcodes or a fetch in progress were thrown away.
+    u64 flushes = 0;
+  };
+
+  struct Transfer {
+    /// Completed transfers, a transfer can be interrupted by a channel with higher priority.
+    u64 transfers = 0;
+    u64 units = 0;
+    u64 cycles = 0;
+  };
+
+  /**
+   * Saves what the bus is currently doing and restores it when leaving the scope,
+   * so that an access can be interrupted by a DMA.
+   */
+  struct Nested {
+    Nested(BusStats& stats) : stats(stats), sink(stats.sink) {}
+
+   ~Nested() {
+      stats.sink = sink;
+    }
+
+  private:
+    BusStats& stats;
+    u64* sink;
+  };
+
+  BusStats() {
+    Reset();
+  }
+
+  BusStats(BusStats const&) = delete;
+
+  void Reset() {
+    for (auto& region : regions) {
+      for (auto& access : region) {
+        for (auto& counter : access) {
+          counter = {};
+        }
+      }
+    }
+    for (auto& channel : dma) {
+      for (auto& transfer : channel) {
+        transfer = {};
+      }
+    }
+    prefetch = {};
+    internal_cycles = 0;
+    halt_cycles = 0;
+    sink = &internal_cycles;
+  }
+
+  auto GetCounter(int region, bool sequential, Width width) const -> Counter const& {
+    return regions[region][sequential ? 1 : 0][int(width)];
+  }
+
+  auto GetInternalCycles() const -> u64 { return internal_cycles; }
+  auto GetHaltCycles() const -> u64 { return halt_cycles; }
+  auto GetPrefetch() const -> Prefetch const& { return prefetch; }
+
+  auto GetTransfer(int channel, Occasion occasion) const -> Transfer const& {
+    return dma[channel][int(occasion)];
+  }
+
+  void RecordAccess([[maybe_unused]] int page, [[maybe_unused]] bool sequential, [[maybe_unused]] int size) {
+#ifdef NBA_BUS_STATS
+    auto& counter = regions[page < kRegionCount ? page : kRegionCount - 1][sequential ? 1 : 0][size >> 1];
+    counter.accesses++;
+    sink = &counter.cycles;
+#endif
+  }
+
+  void RecordIdle() {
+#ifdef NBA_BUS_STATS
+    sink = &internal_cycles;
+#endif
+  }
+
+  void RecordHalt() {
+#ifdef NBA_BUS_STATS
+    sink = &halt_cycles;
+#endif
+  }
+
+  void AddCycles([[maybe_unused]] int cycles) {
+#ifdef NBA_BUS_STATS
+    *sink += cycles;
+#endif
+  }
+
+  void RecordPrefetchHit() {
+#ifdef NBA_BUS_STATS
+    prefetch.hits++;
+#endif
+  }
+
+  void RecordPrefetchStall() {
+#ifdef NBA_BUS_STATS
+    prefetch.stalls++;
+#endif
+  }
+
+  void RecordPrefetchMiss() {
+#ifdef NBA_BUS_STATS
+    prefetch.misses++;
+#endif
+  }
+
+  void RecordPrefetchFlush() {
+#ifdef NBA_BUS_STATS
+    prefetch.flushes++;
+#endif
+  }
+
+  void RecordTransfer([[maybe_unused]] int channel, [[maybe_unused]] Occasion occasion, [[maybe_unused]] u32 units, [[maybe_unused]] int cycles, [[maybe_unused]] bool completed) {
+#ifdef NBA_BUS_STATS
+    auto& transfer = dma[channel][int(occasion)];
+    transfer.units += units;
+    transfer.cycles += cycles;
+    if (completed) {
+      transfer.transfers++;
+    }
+#endif
+  }
+
+private:
+  Counter regions[kRegionCount][2][int(Width::Count)];
+  Transfer dma[4][int(Occasion::Count)];
+  Prefetch prefetch;
+  u64 internal_cycles;
+  u64 halt_cycles;
+
+  /// Where the cycles of the current bus activity are counted.
+  u64* sink;
+};
+
+} // namespace nba::core
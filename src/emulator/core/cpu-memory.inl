@@ -91,6 +91,8 @@ auto CPU::Read(u32 address, Access access) -> T {
     cycles = cycles16[int(access)][page];
   }
 
+  scheduler.bus_stats.RecordAccess(page, access == Access::Sequential, sizeof(T));
+
   switch (page) {
     case 0x00: {
       PrefetchStepRAM(cycles);
@@ -164,6 +166,10 @@ void CPU::Write(u32 address, T value, Access access) {
   int cycles;
   int page = address >> 24;
 
+  if (unlikely(hash_writes)) {
+    write_hash = (write_hash ^ ((u64(address) << 32) | value)) * 0x100000001B3;
+  }
+
   if (page != 0x0E && page != 0x0F) {
     address &= ~(sizeof(T) - 1);
   }
@@ -178,6 +184,8 @@ void CPU::Write(u32 address, T value, Access access) {
     cycles = cycles16[int(access)][page];
   }
 
+  scheduler.bus_stats.RecordAccess(page, access == Access::Sequential, sizeof(T));
+
   switch (page) {
     case 0x02: {
       PrefetchStepRAM(cycles);
@@ -585,6 +585,13 @@ void CPU::WriteMMIO16(u32 address, u16 value) {
       CheckKeypadInterrupt();
       break;
     }
+    /* SIOCNT special-case:
+     * Take the mode from the same write that starts a transfer.
+     */
+    case SIOCNT: {
+      serial_bus.WriteControl(value);
+      break;
+    }
     default: {
       WriteMMIO(address + 0, (value >> 0) & 0xFF);
       WriteMMIO(address + 1, (value >> 8) & 0xFF);
@@ -27,11 +27,26 @@ CPU::CPU(std::shared_ptr<Config> config)
     , apu(scheduler, dma, config)
     , ppu(scheduler, irq, dma, config)
     , timer(scheduler, irq, apu)
-    , serial_bus(irq) {
+    , serial_bus(scheduler, irq) {
+  scheduler.Register(Scheduler::EventClass::ARM_LDMUsermodeConflict, [this](u64) {
+    OnLDMUsermodeConflictEnd();
+  });
+  scheduler.Register(Scheduler::EventClass::KEYPAD_Input, [this](u64 keyinput) {
+    input_waiting = false;
+    SetKeyInput(u16(keyinput));
+  });
   std::memset(memory.bios, 0, 0x04000);
   Reset();
 }
 
+CPU::~CPU() {
+  // Another emulator may have registered its own callback on the device since.
+  if (config->input_dev->callback_owner == this) {
+    config->input_dev->SetOnChangeCallback({});
+    config->input_dev->callback_owner = nullptr;
+  }
+}
+
 void CPU::Reset() {
   std::memset(memory.wram, 0, 0x40000);
   std::memset(memory.iram, 0, 0x08000);
@@ -40,6 +55,7 @@ void CPU::Reset() {
   prefetch = {};
   bus_is_controlled_by_dma = false;
   openbus_from_dma = false;
+  input_waiting = false;
   UpdateMemoryDelayTable();
 
   for (int i = 16; i < 256; i++) {
@@ -68,14 +84,19 @@ void CPU::Reset() {
 
   m4a_soundinfo = nullptr;
   m4a_original_freq = 0;
-  if (config->audio.m4a_xq_enable) {
-    M4ASearchForSampleFreqSet();
+  m4a_setfreq_address = game_pak.GetAnalysis().m4a_setfreq_address;
+
+  if (config->reference_paths) {
+    game_pak.DisablePageTable();
   }
 
   config->input_dev->SetOnChangeCallback(std::bind(&CPU::OnKeyPress,this));
+  config->input_dev->callback_owner = this;
 }
 
 void CPU::RunFor(int cycles) {
+  Profiler::Scope scope{scheduler.profiler, Profiler::Subsystem::ARM};
+
   bool m4a_xq_enable = config->audio.m4a_xq_enable && m4a_setfreq_address != 0;
   if (m4a_xq_enable && m4a_soundinfo != nullptr) {
     M4AFixupPercussiveChannels();
@@ -84,6 +105,12 @@ void CPU::RunFor(int cycles) {
   auto limit = scheduler.GetTimestampNow() + cycles;
 
   while (scheduler.GetTimestampNow() < limit) {
+    // Only call UpdateInput() when it has work to do, this check runs for every instruction.
+    if (unlikely(input_enabled && ((input_queue.HasPending() && !input_waiting && !playback) ||
+                                   scheduler.GetTimestampNow() >= playback_due))) {
+      UpdateInput();
+    }
+
     if (unlikely(mmio.haltcnt == HaltControl::HALT && irq.HasServableIRQ())) {
       mmio.haltcnt = HaltControl::RUN;
     }
@@ -92,8 +119,21 @@ void CPU::RunFor(int cycles) {
       if (unlikely(m4a_xq_enable && state.r15 == m4a_setfreq_address)) {
         M4ASampleFreqSetHook();
       }
+#ifdef NBA_GUEST_PROFILE
+      // r15 is two instructions ahead of the executed instruction.
+      auto thumb = state.cpsr.f.thumb;
+      auto address = state.r15 - (thumb ? 4 : 8);
+      auto timestamp = scheduler.GetTimestampNow();
+      Run();
+      guest_profiler.Record(address, thumb, int(scheduler.GetTimestampNow() - timestamp));
+#else
       Run();
+#endif
     } else {
+#ifdef NBA_GUEST_PROFILE
+      guest_profiler.RecordHalt(scheduler.GetRemainingCycleCount());
+#endif
+      scheduler.bus_stats.RecordHalt();
       Tick(scheduler.GetRemainingCycleCount());
     }
   }
@@ -135,32 +175,6 @@ void CPU::UpdateMemoryDelayTable() {
   }
 }
 
-void CPU::M4ASearchForSampleFreqSet() {
-  static const u8 pattern[] = {
-    0x53, 0x6D, 0x73, 0x68, 0x70, 0xB5, 0x02, 0x1C,
-    0x1E, 0x48, 0x04, 0x68, 0xF0, 0x20, 0x00, 0x03,
-    0x10, 0x40, 0x02, 0x0C
-  };
-
-  auto& rom = game_pak.GetRawROM();
-
-  for (u32 i = 0; i < rom.size(); i++) {
-    bool match = true;
-    for (int j = 0; j < sizeof(pattern); j++) {
-      if (rom[i + j] != pattern[j]) {
-        match = false;
-        i += j;
-        break;
-      }
-    }
-    if (match) {
-      m4a_setfreq_address = i + 0x08000008;
-      LOG_INFO("Found M4A SetSampleFreq() routine at 0x{0:08X}.", m4a_setfreq_address);
-      return;
-    }
-  }
-}
-
 void CPU::M4ASampleFreqSetHook() {
   static const int frequency_tab[16] = {
     0, 5734, 7884, 10512,
@@ -175,7 +189,7 @@ void CPU::M4ASampleFreqSetHook() {
   state.r0 = 0x00090000;
   m4a_soundinfo = nullptr;
 
-  u32 soundinfo_p1 = common::read<u32>(game_pak.GetRawROM().data(), (m4a_setfreq_address & 0x00FFFFFF) + 492);
+  u32 soundinfo_p1 = common::read<u32>(game_pak.GetRawROM().Data(), (m4a_setfreq_address & 0x00FFFFFF) + 492);
   u32 soundinfo_p2;
   LOG_INFO("M4A SoundInfo pointer at 0x{0:08X}", soundinfo_p1);
 
@@ -216,21 +230,91 @@ void CPU::M4AFixupPercussiveChannels() {
 }
 
 
+/* Runs on the thread that changed the input device,
+ * so the key state is only queued for the emulation thread.
+ */
 void CPU::OnKeyPress() {
-  mmio.keyinput = 0;
-
-  if (!config->input_dev->Poll(Key::A)) mmio.keyinput |= 1;
-  if (!config->input_dev->Poll(Key::B)) mmio.keyinput |= 2;
-  if (!config->input_dev->Poll(Key::Select)) mmio.keyinput |= 4;
-  if (!config->input_dev->Poll(Key::Start)) mmio.keyinput |= 8;
-  if (!config->input_dev->Poll(Key::Right)) mmio.keyinput |= 16;
-  if (!config->input_dev->Poll(Key::Left)) mmio.keyinput |= 32;
-  if (!config->input_dev->Poll(Key::Up)) mmio.keyinput |= 64;
-  if (!config->input_dev->Poll(Key::Down)) mmio.keyinput |= 128;
-  if (!config->input_dev->Poll(Key::R)) mmio.keyinput |= 256;
-  if (!config->input_dev->Poll(Key::L)) mmio.keyinput |= 512;
+  u16 keyinput = 0;
+
+  if (!config->input_dev->Poll(Key::A)) keyinput |= 1;
+  if (!config->input_dev->Poll(Key::B)) keyinput |= 2;
+  if (!config->input_dev->Poll(Key::Select)) keyinput |= 4;
+  if (!config->input_dev->Poll(Key::Start)) keyinput |= 8;
+  if (!config->input_dev->Poll(Key::Right)) keyinput |= 16;
+  if (!config->input_dev->Poll(Key::Left)) keyinput |= 32;
+  if (!config->input_dev->Poll(Key::Up)) keyinput |= 64;
+  if (!config->input_dev->Poll(Key::Down)) keyinput |= 128;
+  if (!config->input_dev->Poll(Key::R)) keyinput |= 256;
+  if (!config->input_dev->Poll(Key::L)) keyinput |= 512;
+
+  input_queue.Push({InputQueue::kNow, keyinput});
+}
+
+void CPU::SetMoviePlayback(std::vector<InputQueue::Entry> const* entries) {
+  playback = entries;
+  playback_index = 0;
+  playback_due = entries && !entries->empty() ? entries->front().timestamp : ~0ULL;
+}
+
+void CPU::SetMovieRecording(std::vector<InputQueue::Entry>* entries) {
+  recording = entries;
+}
 
+void CPU::UpdateInput() {
+  if (!input_enabled) {
+    return;
+  }
+
+  // The input queue keeps filling up during playback and is drained once it ends.
+  if (playback) {
+    auto now = scheduler.GetTimestampNow();
+    auto& entries = *playback;
+
+    while (playback_index < entries.size() && entries[playback_index].timestamp <= now) {
+      SetKeyInput(entries[playback_index++].keyinput);
+    }
+    playback_due = playback_index < entries.size() ? entries[playback_index].timestamp : ~0ULL;
+    return;
+  }
+
+  if (!input_waiting) {
+    DrainInputQueue();
+  }
+}
+
+void CPU::DrainInputQueue() {
+  auto entry = InputQueue::Entry{};
+  auto now = scheduler.GetTimestampNow();
+
+  while (input_queue.Peek(entry)) {
+    input_queue.Pop();
+
+    // Entries in the future wait in the scheduler, one at a time, to keep their order.
+    if (entry.timestamp > now) {
+      scheduler.Add(entry.timestamp - now, Scheduler::EventClass::KEYPAD_Input, entry.keyinput);
+      input_waiting = true;
+      return;
+    }
+
+    SetKeyInput(entry.keyinput);
+  }
+
+  u16 keyinput;
+
+  if (input_queue.TakeOverflow(keyinput)) {
+    LOG_WARN("Input queue overflowed, some key changes were lost.");
+    SetKeyInput(keyinput);
+  }
+}
+
+void CPU::SetKeyInput(u16 keyinput) {
+  mmio.keyinput = keyinput & 0x3FF;
   CheckKeypadInterrupt();
+
+  // Key states from speculative run-ahead frames happen again once the frame is emulated for real.
+  if (recording && input_enabled) {
+    recording->push_back({scheduler.GetTimestampNow(), mmio.keyinput});
+  }
 }
 
 void CPU::CheckKeypadInterrupt() {
@@ -14,16 +14,20 @@
 #include <emulator/cartridge/gpio/gpio.hpp>
 #include <emulator/cartridge/game_pak.hpp>
 #include <emulator/config/config.hpp>
+#include <emulator/save_state.hpp>
 #include <memory>
 #include <type_traits>
+#include <vector>
 
 #include "arm/arm7tdmi.hpp"
+#include "guest_profiler.hpp"
 #include "hw/apu/apu.hpp"
 #include "hw/ppu/ppu.hpp"
 #include "hw/dma.hpp"
 #include "hw/interrupt.hpp"
 #include "hw/serial.hpp"
 #include "hw/timer.hpp"
+#include "input_queue.hpp"
 #include "scheduler.hpp"
 
 namespace nba::core {
@@ -32,10 +36,18 @@ struct CPU final : private arm::ARM7TDMI, private arm::MemoryBase {
   using Access = arm::MemoryBase::Access;
 
   CPU(std::shared_ptr<Config> config);
+ ~CPU();
 
   void Reset();
   void RunFor(int cycles);
 
+  void LoadState(SaveState const& save_state);
+  void CopyState(SaveState& save_state);
+
+  auto GetRegisterFile() const -> arm::RegisterFile const& {
+    return state;
+  }
+
   enum class HaltControl {
     RUN,
     STOP,
@@ -87,6 +99,29 @@ struct CPU final : private arm::ARM7TDMI, private arm::MemoryBase {
   Timer timer;
   SerialBus serial_bus;
 
+  /* Key states from the frontend, which are applied at scheduler boundaries.
+   * Draining is disabled while run-ahead emulates frames that are thrown away,
+   * since the entries would be lost when the state is restored.
+   */
+  InputQueue input_queue;
+  bool input_enabled = true;
+
+  /**
+   * While a movie plays back, its entries replace the input queue.
+   * While one is recorded, every key state that takes effect is appended to the list.
+   * Either list must outlive its use, until it is replaced by nullptr.
+   */
+  void SetMoviePlayback(std::vector<InputQueue::Entry> const* entries);
+  void SetMovieRecording(std::vector<InputQueue::Entry>* entries);
+
+  /* If enabled, the address and value of every bus write (including DMA)
+   * are folded into a running hash, which is used to compare two instances.
+   */
+  bool hash_writes = false;
+  u64 write_hash = 0;
+
+  GuestProfiler guest_profiler;
+
 private:
   auto ReadMMIO(u32 address) -> u8;
   void WriteMMIO(u32 address, u8 value);
@@ -125,6 +160,7 @@ private:
   }
 
   void Idle() {
+    scheduler.bus_stats.RecordIdle();
     PrefetchStepRAM(1);
   }
 
@@ -133,11 +169,14 @@ private:
     
     if (unlikely(dma.IsRunning() && !bus_is_controlled_by_dma)) {
       bus_is_controlled_by_dma = true;
+      Profiler::Scope scope{scheduler.profiler, Profiler::Subsystem::DMA};
+      BusStats::Nested nested{scheduler.bus_stats};
       dma.Run();
       bus_is_controlled_by_dma = false;
       openbus_from_dma = true;
     }
 
+    scheduler.bus_stats.AddCycles(cycles);
     scheduler.AddCycles(cycles);
 
     if (prefetch.active && !bus_is_controlled_by_dma) {
@@ -194,6 +233,9 @@ private:
   void ALWAYS_INLINE PrefetchStepROM(u32 address, int cycles) noexcept {
     // TODO: bypass prefetch ROM step during DMA?
     if (unlikely(!mmio.waitcnt.prefetch)) {
+      if (code) {
+        scheduler.bus_stats.RecordPrefetchMiss();
+      }
       Tick(cycles);
       return;
     }
@@ -203,36 +245,53 @@ private:
     if (prefetch.active) {
       if (code && address == prefetch.last_address) {
         // Complete the load and consume the fetched (half)word right away.
+        scheduler.bus_stats.RecordPrefetchStall();
         Tick(prefetch.countdown);
         prefetch.count--;
         return;
       }
 
+      scheduler.bus_stats.RecordPrefetchFlush();
       prefetch.active = false;
     }
 
     if (code && prefetch.count != 0) {
       if (address == prefetch.head_address) {
+        scheduler.bus_stats.RecordPrefetchHit();
         prefetch.count--;
         prefetch.head_address += prefetch.opcode_width;
         PrefetchStepRAM(1);
         return;
       } else {
+        scheduler.bus_stats.RecordPrefetchFlush();
         prefetch.count = 0;
       }
     }
 
+    if (code) {
+      scheduler.bus_stats.RecordPrefetchMiss();
+    }
     Tick(cycles);
   }
 
   void UpdateMemoryDelayTable();
 
-  void M4ASearchForSampleFreqSet();
   void M4ASampleFreqSetHook();
   void M4AFixupPercussiveChannels();
 
   void CheckKeypadInterrupt();
   void OnKeyPress();
+  void UpdateInput();
+  void DrainInputQueue();
+  void SetKeyInput(u16 keyinput);
+
+  /// Whether an entry of the input queue waits for its KEYPAD_Input event.
+  bool input_waiting = false;
+
+  std::vector<InputQueue::Entry> const* playback = nullptr;
+  std::vector<InputQueue::Entry>* recording = nullptr;
+  size_t playback_index = 0;
+  u64 playback_due = ~0ULL;
 
   M4ASoundInfo* m4a_soundinfo;
   int m4a_original_freq = 0;
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <algorithm>
+#include <common/punning.hpp>
+#include <fmt/format.h>
+
+#include "arm/disassembler.hpp"
+#include "cpu.hpp"
+#include "guest_profiler.hpp"
+
+namespace nba::core {
+
+static auto region_name(u32 address) -> const char* {
+  switch (address >> 24) {
+    case 0x00: return "BIOS";
+    case 0x02: return "EWRAM";
+    case 0x03: return "IWRAM";
+    case 0x06: return "VRAM";
+    case 0x08:
+    case 0x09:
+    case 0x0A:
+    case 0x0B:
+    case 0x0C:
+    case 0x0D: return "ROM";
+    default:   return "?";
+  }
+}
+
+/// Reads guest code without side effects, returns false for memory that cannot hold code.
+static bool read_code(CPU const& cpu, u32 address, int size, u32& value) {
+  auto read = [&](u8 const* data, size_t length) {
+    if (address + size > length) {
+      return false;
+    }
+    value = size == 4 ? common::read<u32>(data, address) : common::read<u16>(data, address);
+    return true;
+  };
+
+  auto region = address >> 24;
+
+  address &= 0x00FF'FFFF;
+
+  switch (region) {
+    case 0x00: return read(cpu.memory.bios, sizeof(cpu.memory.bios));
+    case 0x02: address &= 0x3FFFF; return read(cpu.memory.wram, sizeof(cpu.memory.wram));
+    case 0x03: address &= 0x7FFF;  return read(cpu.memory.iram, sizeof(cpu.memory.iram));
+    case 0x08:
+    case 0x09:
+    case 0x0A:
+    case 0x0B:
+    case 0x0C:
+    case 0x0D: {
+      auto& rom = cpu.game_pak.GetRawROM();
+      address = ((region & 1) << 24) | address;
+      return read(rom.Data(), rom.Size());
+    }
+  }
+  return false;
+}
+
+auto GuestProfiler::Find(u32 address) const -> Counters const* {
+  if (pages.empty()) {
+    return nullptr;
+  }
+
+  auto& page = pages[(address >> kPageBits) & (kPageCount - 1)];
+
+  if (!page) {
+    return nullptr;
+  }
+
+  auto& counters = page->counters[(address & kPageMask) >> 1];
+  return counters.instructions != 0 ? &counters : nullptr;
+}
+
+void GuestProfiler::WriteReport(std::ostream& stream, CPU const& cpu, int count) const {
+  struct Range {
+    u32 first;
+    u32 last;
+    u64 cycles;
+    u64 instructions;
+  };
+
+  struct Instruction {
+    u32 address;
+    Counters counters;
+  };
+
+  auto ranges = std::vector<Range>{};
+  auto instructions = std::vector<Instruction>{};
+  auto total_cycles = halt_cycles;
+  auto total_instructions = u64(0);
+
+  for (size_t i = 0; i < pages.size(); i++) {
+    if (!pages[i]) {
+      continue;
+    }
+
+    for (int j = 0; j <= kPageMask >> 1; j++) {
+      auto& counters = pages[i]->counters[j];
+
+      if (counters.instructions == 0) {
+        continue;
+      }
+
+      auto address = u32((i << kPageBits) | (j << 1));
+
+      instructions.push_back({address, counters});
+      total_cycles += counters.cycles;
+      total_instructions += counters.instructions;
+
+      // Instructions that directly follow each other are merged into one range.
+      if (!ranges.empty() && ranges.back().last + (Find(ranges.back().last)->thumb ? 2 : 4) == address) {
+        ranges.back().last = address;
+        ranges.back().cycles += counters.cycles;
+        ranges.back().instructions += counters.instructions;
+      } else {
+        ranges.push_back({address, address, counters.cycles, counters.instructions});
+      }
+    }
+  }
+
+  auto percent = [&](u64 cycles) {
+    return total_cycles == 0 ? 0.0 : cycles * 100.0 / total_cycles;
+  };
+
+  stream << fmt::format("{0} instructions in {1} cycles, {2} cycles ({3:.1f}%) halted.\n",
+    total_instructions, total_cycles, halt_cycles, percent(halt_cycles));
+
+  std::sort(ranges.begin(), ranges.end(), [](auto const& a, auto const& b) {
+    return a.cycles > b.cycles;
+  });
+
+  stream << "\nHottest address ranges:\n";
+  stream << "      cycles       %  instructions  range                  region\n";
+
+  for (int i = 0; i < std::min(count, int(ranges.size())); i++) {
+    auto& range = ranges[i];
+    stream << fmt::format("{0:12} {1:6.2f}% {2:13}  {3:08X}-{4:08X}  {5}\n",
+      range.cycles, percent(range.cycles), range.instructions, range.first, range.last, region_name(range.first));
+  }
+
+  std::sort(instructions.begin(), instructions.end(), [](auto const& a, auto const& b) {
+    return a.counters.cycles > b.counters.cycles;
+  });
+
+  stream << "\nHottest instructions:\n";
+  stream << "      cycles       %         count  address   region  instruction\n";
+
+  for (int i = 0; i < std::min(count, int(instructions.size())); i++) {
+    auto& [address, counters] = instructions[i];
+    auto text = std::string{"?"};
+    u32 opcode;
+    u32 next_opcode;
+
+    if (counters.thumb) {
+      if (read_code(cpu, address, 2, opcode)) {
+        if (!read_code(cpu, address + 2, 2, next_opcode)) {
+          next_opcode = 0;
+        }
+        text = fmt::format("{0:04X}      {1}", opcode, arm::DisassembleThumb(address, u16(opcode), u16(next_opcode)));
+      }
+    } else if (read_code(cpu, address, 4, opcode)) {
+      text = fmt::format("{0:08X}  {1}", opcode, arm::DisassembleARM(address, opcode));
+    }
+
+    stream << fmt::format("{0:12} {1:6.2f}% {2:13}  {3:08X}  {4:<6}  {5}\n",
+      counters.cycles, percent(counters.cycles), counters.instructions, address, region_name(address), text);
+  }
+}
+
+void GuestProfiler::WriteCoverage(std::ostream& stream, CPU const& cpu) const {
+  auto size = cpu.game_pak.GetRawROM().Size();
+  auto bitmap = std::vector<u8>((size / 2 + 7) / 8);
+
+  // The ROM is visible in three mirrors (wait states 0-2).
+  for (u32 base : { 0x0800'0000, 0x0A00'0000, 0x0C00'0000 }) {
+    for (u32 offset = 0; offset < size; offset += 2) {
+      if (Find(base + offset) != nullptr) {
+        bitmap[offset >> 4] |= 1 << ((offset >> 1) & 7);
+      }
+    }
+  }
+
+  stream.write((char const*)bitmap.data(), bitmap.size());
+}
+
+} // namespace nba::core
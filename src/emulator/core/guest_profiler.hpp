@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/compiler.hpp>
+#include <common/integer.hpp>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace nba::core {
+
+struct CPU;
+
+/**
+ * Attributes the emulated time to the guest code: counts how often the instruction
+ * at each address was executed and how many cycles it took, including wait states
+ * and any DMA that ran in the meantime. Cycles spent halted are counted separately.
+ *
+ * The CPU only records into the profiler if the core is built with NBA_GUEST_PROFILE,
+ * otherwise the profiler stays empty and costs nothing.
+ */
+struct GuestProfiler {
+#ifdef NBA_GUEST_PROFILE
+  static constexpr bool kEnabled = true;
+#else
+  static constexpr bool kEnabled = false;
+#endif
+
+  struct Counters {
+    u64 cycles;
+    u64 instructions;
+    bool thumb;
+  };
+
+  GuestProfiler() {
+    Reset();
+  }
+
+  void Reset() {
+    pages.clear();
+    if constexpr (kEnabled) {
+      pages.resize(kPageCount);
+    }
+    halt_cycles = 0;
+  }
+
+  void ALWAYS_INLINE Record(u32 address, bool thumb, int cycles) {
+    auto& page = pages[(address >> kPageBits) & (kPageCount - 1)];
+
+    if (unlikely(!page)) {
+      page = std::make_unique<Page>();
+    }
+
+    auto& counters = page->counters[(address & kPageMask) >> 1];
+    counters.cycles += cycles;
+    counters.instructions++;
+    counters.thumb = thumb;
+  }
+
+  void RecordHalt(int cycles) {
+    halt_cycles += cycles;
+  }
+
+  /**
+   * Writes the hottest address ranges (runs of consecutively executed instructions)
+   * and the hottest instructions, with their disassembly.
+   */
+  void WriteReport(std::ostream& stream, CPU const& cpu, int count = 50) const;
+
+  /**
+   * Writes the ROM code coverage: one bit per halfword of the ROM (LSB first),
+   * which is set if an instruction was executed there.
+   */
+  void WriteCoverage(std::ostream& stream, CPU const& cpu) const;
+
+private:
+  static constexpr int kPageBits = 16;
+  static constexpr int kPageMask = (1 << kPageBits) - 1;
+  static constexpr int kPageCount = 0x1000'0000 >> kPageBits;
+
+  struct Page {
+    Counters counters[1 << (kPageBits - 1)] {};
+  };
+
+  auto Find(u32 address) const -> Counters const*;
+
+  std::vector<std::unique_ptr<Page>> pages;
+  u64 halt_cycles;
+};
+
+} // namespace nba::core
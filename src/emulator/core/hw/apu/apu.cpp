@@ -27,6 +27,13 @@ APU::APU(
     , scheduler(scheduler)
     , dma(dma)
     , config(config) {
+  scheduler.Register(Scheduler::EventClass::APU_Mixer, this, &APU::StepMixer);
+  scheduler.Register(Scheduler::EventClass::APU_Sequencer, this, &APU::StepSequencer);
+}
+
+APU::~APU() {
+  // The audio device must not call back into a destroyed APU.
+  config->audio_dev->Close();
 }
 
 void APU::Reset() {
@@ -42,8 +49,8 @@ void APU::Reset() {
   mmio.bias.Reset();
 
   resolution_old = 0;
-  scheduler.Add(mmio.bias.GetSampleInterval(), this, &APU::StepMixer);
-  scheduler.Add(BaseChannel::s_cycles_per_step, this, &APU::StepSequencer);
+  scheduler.Add(mmio.bias.GetSampleInterval(), Scheduler::EventClass::APU_Mixer);
+  scheduler.Add(BaseChannel::s_cycles_per_step, Scheduler::EventClass::APU_Sequencer);
 
   auto audio_dev = config->audio_dev;
   audio_dev->Close();
@@ -101,7 +108,7 @@ void APU::OnTimerOverflow(int timer_id, int times, int samplerate) {
       for (int time = 0; time < times - 1; time++) {
         fifo.Read();
       }
-      if (config->audio.interpolate_fifo) {
+      if (config->audio.interpolate_fifo && output_enabled) {
         if (samplerate != fifo_samplerate[fifo_id]) {
           fifo_resampler[fifo_id]->SetSampleRates(samplerate, mmio.bias.GetSampleRate());
           fifo_samplerate[fifo_id] = samplerate;
@@ -120,6 +127,11 @@ void APU::OnTimerOverflow(int timer_id, int times, int samplerate) {
 void APU::StepMixer(int cycles_late) {
   auto& bias = mmio.bias;
 
+  if (!output_enabled) {
+    scheduler.Add(bias.GetSampleInterval() - cycles_late, Scheduler::EventClass::APU_Mixer);
+    return;
+  }
+
   if (bias.resolution != resolution_old) {
     resampler->SetSampleRates(bias.GetSampleRate(),
       config->audio_dev->GetSampleRate());
@@ -169,10 +181,15 @@ void APU::StepMixer(int cycles_late) {
   }
 
   buffer_mutex.lock();
+  auto writes = buffer->GetWriteCount();
+  auto drops = buffer->GetDropCount();
   resampler->Write({ sample[0] / float(0x200), sample[1] / float(0x200) });
+  drops = buffer->GetDropCount() - drops;
+  scheduler.stats.audio_samples += buffer->GetWriteCount() - writes + drops;
+  scheduler.stats.audio_samples_dropped += drops;
   buffer_mutex.unlock();
 
-  scheduler.Add(mmio.bias.GetSampleInterval() - cycles_late, this, &APU::StepMixer);
+  scheduler.Add(mmio.bias.GetSampleInterval() - cycles_late, Scheduler::EventClass::APU_Mixer);
 }
 
 void APU::StepSequencer(int cycles_late) {
@@ -181,7 +198,7 @@ void APU::StepSequencer(int cycles_late) {
   mmio.psg3.Tick();
   mmio.psg4.Tick();
 
-  scheduler.Add(BaseChannel::s_cycles_per_step - cycles_late, this, &APU::StepSequencer);
+  scheduler.Add(BaseChannel::s_cycles_per_step - cycles_late, Scheduler::EventClass::APU_Sequencer);
 }
 
 } // namespace nba::core
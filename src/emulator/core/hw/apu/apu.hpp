@@ -12,6 +12,8 @@
 #include <emulator/config/config.hpp>
 #include <emulator/core/hw/dma.hpp>
 #include <emulator/core/scheduler.hpp>
+#include <atomic>
+#include <emulator/save_state.hpp>
 #include <mutex>
 
 #include "channel/quad_channel.hpp"
@@ -29,13 +31,23 @@ struct APU {
     std::shared_ptr<Config>
   );
 
+ ~APU();
+
   void Reset();
+  void LoadState(SaveState const& state);
+  void CopyState(SaveState& state);
   void OnTimerOverflow(int timer_id, int times, int samplerate);
 
+  /* Whether samples are passed on to the audio device.
+   * The emulated state does not depend on this setting,
+   * but the host-side FIFO resamplers are bypassed while it is disabled.
+   */
+  bool output_enabled = true;
+
   struct MMIO {
     MMIO(Scheduler& scheduler)
-        : psg1(scheduler)
-        , psg2(scheduler)
+        : psg1(scheduler, Scheduler::EventClass::APU_PSG1_Generate)
+        , psg2(scheduler, Scheduler::EventClass::APU_PSG2_Generate)
         , psg3(scheduler)
         , psg4(scheduler, bias) {
     }
@@ -56,6 +68,9 @@ struct APU {
   std::unique_ptr<common::dsp::Resampler<float>> fifo_resampler[2];
   int fifo_samplerate[2];
 
+  /// Counted by the audio thread, see Stats::audio_underruns.
+  std::atomic<u64> underruns = 0;
+
   std::mutex buffer_mutex;
   std::shared_ptr<common::dsp::StereoRingBuffer<float>> buffer;
   std::unique_ptr<common::dsp::StereoResampler<float>> resampler;
@@ -7,12 +7,14 @@
 
 #include <algorithm>
 #include <cmath>
+#include <common/trace.hpp>
 
 #include "apu.hpp"
 
 namespace nba::core {
 
 void AudioCallback(APU* apu, s16* stream, int byte_len) {
+  common::trace::Scope trace{"audio", "callback"};
   std::lock_guard<std::mutex> guard(apu->buffer_mutex);
 
   // Do not try to access the buffer if it wasn't setup yet.
@@ -38,6 +40,8 @@ void AudioCallback(APU* apu, s16* stream, int byte_len) {
   } else {
     int y = 0;
 
+    apu->underruns.fetch_add(1, std::memory_order_relaxed);
+
     for (int x = 0; x < samples; x++) {
       auto sample = apu->buffer->Peek(y);
       sample[0] = std::clamp(sample[0], -kMaxAmplitude, kMaxAmplitude);
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <emulator/save_state.hpp>
+
 #include "length_counter.hpp"
 #include "envelope.hpp"
 #include "sweep.hpp"
@@ -61,6 +63,58 @@ protected:
     enabled = false;
   }
 
+  void LoadState(SaveState::APU::PSG const& state) {
+    enabled = state.enabled;
+    step = state.step;
+
+    length.length = state.length.length;
+    length.enabled = state.length.enabled;
+
+    envelope.active = state.envelope.active;
+    envelope.enabled = state.envelope.enabled;
+    envelope.direction = (Envelope::Direction)state.envelope.direction;
+    envelope.initial_volume = state.envelope.initial_volume;
+    envelope.current_volume = state.envelope.current_volume;
+    envelope.divider = state.envelope.divider;
+    envelope.step = state.envelope.step;
+
+    sweep.active = state.sweep.active;
+    sweep.enabled = state.sweep.enabled;
+    sweep.direction = (Sweep::Direction)state.sweep.direction;
+    sweep.initial_freq = state.sweep.initial_freq;
+    sweep.current_freq = state.sweep.current_freq;
+    sweep.shadow_freq = state.sweep.shadow_freq;
+    sweep.divider = state.sweep.divider;
+    sweep.shift = state.sweep.shift;
+    sweep.step = state.sweep.step;
+  }
+
+  void CopyState(SaveState::APU::PSG& state) {
+    state.enabled = enabled;
+    state.step = step;
+
+    state.length.length = length.length;
+    state.length.enabled = length.enabled;
+
+    state.envelope.active = envelope.active;
+    state.envelope.enabled = envelope.enabled;
+    state.envelope.direction = envelope.direction;
+    state.envelope.initial_volume = envelope.initial_volume;
+    state.envelope.current_volume = envelope.current_volume;
+    state.envelope.divider = envelope.divider;
+    state.envelope.step = envelope.step;
+
+    state.sweep.active = sweep.active;
+    state.sweep.enabled = sweep.enabled;
+    state.sweep.direction = sweep.direction;
+    state.sweep.initial_freq = sweep.initial_freq;
+    state.sweep.current_freq = sweep.current_freq;
+    state.sweep.shadow_freq = sweep.shadow_freq;
+    state.sweep.divider = sweep.divider;
+    state.sweep.shift = sweep.shift;
+    state.sweep.step = sweep.step;
+  }
+
   LengthCounter length;
   Envelope envelope;
   Sweep sweep;
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <common/integer.hpp>
+#include <cstring>
+#include <emulator/save_state.hpp>
 
 namespace nba::core {
 
@@ -42,6 +44,20 @@ public:
     return value;
   }
 
+  void LoadState(SaveState::APU::FIFO const& state) {
+    std::memcpy(data, state.data, sizeof(data));
+    rd_ptr = state.rd_ptr;
+    wr_ptr = state.wr_ptr;
+    count = state.count;
+  }
+
+  void CopyState(SaveState::APU::FIFO& state) {
+    std::memcpy(state.data, data, sizeof(data));
+    state.rd_ptr = rd_ptr;
+    state.wr_ptr = wr_ptr;
+    state.count = count;
+  }
+
 private:
   static constexpr int s_fifo_len = 32;
   
@@ -13,6 +13,7 @@ NoiseChannel::NoiseChannel(Scheduler& scheduler, BIAS& bias)
     : BaseChannel(true, false)
     , scheduler(scheduler)
     , bias(bias) {
+  scheduler.Register(Scheduler::EventClass::APU_PSG4_Generate, this, &NoiseChannel::Generate);
   Reset();
 }
 
@@ -76,7 +77,7 @@ void NoiseChannel::Generate(int cycles_late) {
     skip_count = 0;
   }
 
-  scheduler.Add(noise_interval - cycles_late, event_cb);
+  scheduler.Add(noise_interval - cycles_late, Scheduler::EventClass::APU_PSG4_Generate);
 }
 
 auto NoiseChannel::Read(int offset) -> u8 {
@@ -154,7 +155,7 @@ void NoiseChannel::Write(int offset, u8 value) {
         if (!IsEnabled()) {
           // TODO: properly handle skip count and properly align event to system clock.
           skip_count = 0;
-          scheduler.Add(GetSynthesisInterval(frequency_ratio, frequency_shift), event_cb);
+          scheduler.Add(GetSynthesisInterval(frequency_ratio, frequency_shift), Scheduler::EventClass::APU_PSG4_Generate);
         }
 
         constexpr u16 lfsr_init[] = { 0x4000, 0x0040 };
@@ -20,6 +20,10 @@ public:
   NoiseChannel(Scheduler& scheduler, BIAS& bias);
 
   void Reset();
+
+  void LoadState(SaveState::APU::NoiseChannel const& state);
+  void CopyState(SaveState::APU::NoiseChannel& state);
+
   auto GetSample() -> s8 override { return sample; }
   void Generate(int cycles_late);
   auto Read (int offset) -> u8;
@@ -42,9 +46,6 @@ private:
   s8 sample = 0;
 
   Scheduler& scheduler;
-  std::function<void(int)> event_cb = [this](int cycles_late) {
-    this->Generate(cycles_late);
-  };
 
   int frequency_shift;
   int frequency_ratio;
@@ -16,9 +16,13 @@ namespace nba::core {
 
 class QuadChannel : public BaseChannel {
 public:
-  QuadChannel(Scheduler& scheduler);
+  QuadChannel(Scheduler& scheduler, Scheduler::EventClass event_class);
 
   void Reset();
+
+  void LoadState(SaveState::APU::QuadChannel const& state);
+  void CopyState(SaveState::APU::QuadChannel& state);
+
   auto GetSample() -> s8 override { return sample; }
   void Generate(int cycles_late);
   auto Read (int offset) -> u8;
@@ -33,9 +37,7 @@ private:
   }
 
   Scheduler& scheduler;
-  std::function<void(int)> event_cb = [this](int cycles_late) {
-    this->Generate(cycles_late);
-  };
+  Scheduler::EventClass event_class;
 
   s8 sample = 0;
   int phase;
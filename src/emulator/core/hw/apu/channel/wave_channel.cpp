@@ -12,6 +12,7 @@ namespace nba::core {
 WaveChannel::WaveChannel(Scheduler& scheduler)
     : BaseChannel(false, false, 256)
     , scheduler(scheduler) {
+  scheduler.Register(Scheduler::EventClass::APU_PSG3_Generate, this, &WaveChannel::Generate);
   Reset();
 }
 
@@ -39,7 +40,7 @@ void WaveChannel::Generate(int cycles_late) {
   if (!IsEnabled()) {
     sample = 0;
     if (BaseChannel::IsEnabled()) {
-      scheduler.Add(GetSynthesisIntervalFromFrequency(frequency) - cycles_late, event_cb);
+      scheduler.Add(GetSynthesisIntervalFromFrequency(frequency) - cycles_late, Scheduler::EventClass::APU_PSG3_Generate);
     }
     return;
   }
@@ -63,7 +64,7 @@ void WaveChannel::Generate(int cycles_late) {
     }
   }
 
-  scheduler.Add(GetSynthesisIntervalFromFrequency(frequency) - cycles_late, event_cb);
+  scheduler.Add(GetSynthesisIntervalFromFrequency(frequency) - cycles_late, Scheduler::EventClass::APU_PSG3_Generate);
 }
 
 auto WaveChannel::Read(int offset) -> u8 {
@@ -127,7 +128,7 @@ void WaveChannel::Write(int offset, u8 value) {
       if (playing && (value & 0x80)) {
         if (!BaseChannel::IsEnabled()) {
           // TODO: properly align event to system clock.
-          scheduler.Add(GetSynthesisIntervalFromFrequency(frequency), event_cb);
+          scheduler.Add(GetSynthesisIntervalFromFrequency(frequency), Scheduler::EventClass::APU_PSG3_Generate);
         }
         phase = 0;
         if (dimension) {
@@ -19,6 +19,10 @@ public:
   WaveChannel(Scheduler& scheduler);
 
   void Reset();
+
+  void LoadState(SaveState::APU::WaveChannel const& state);
+  void CopyState(SaveState::APU::WaveChannel& state);
+
   bool IsEnabled() override { return playing && BaseChannel::IsEnabled(); }
   auto GetSample() -> s8 override { return sample; }
   void Generate(int cycles_late);
@@ -40,9 +44,6 @@ private:
   }
 
   Scheduler& scheduler;
-  std::function<void(int)> event_cb = [this](int cycles_late) {
-    this->Generate(cycles_late);
-  };
 
   s8 sample = 0;
   bool playing;
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <cstring>
+
+#include "apu.hpp"
+
+namespace nba::core {
+
+void APU::LoadState(SaveState const& state) {
+  auto& soundcnt = mmio.soundcnt;
+
+  mmio.fifo[0].LoadState(state.apu.fifo[0]);
+  mmio.fifo[1].LoadState(state.apu.fifo[1]);
+  mmio.psg1.LoadState(state.apu.psg1);
+  mmio.psg2.LoadState(state.apu.psg2);
+  mmio.psg3.LoadState(state.apu.psg3);
+  mmio.psg4.LoadState(state.apu.psg4);
+
+  soundcnt.master_enable = state.apu.soundcnt.master_enable;
+  soundcnt.psg.volume = state.apu.soundcnt.psg.volume;
+  for (int side = 0; side < 2; side++) {
+    soundcnt.psg.master[side] = state.apu.soundcnt.psg.master[side];
+    for (int channel = 0; channel < 4; channel++) {
+      soundcnt.psg.enable[side][channel] = state.apu.soundcnt.psg.enable[side][channel];
+    }
+  }
+  for (int fifo = 0; fifo < 2; fifo++) {
+    soundcnt.dma[fifo].volume = state.apu.soundcnt.dma[fifo].volume;
+    soundcnt.dma[fifo].enable[0] = state.apu.soundcnt.dma[fifo].enable[0];
+    soundcnt.dma[fifo].enable[1] = state.apu.soundcnt.dma[fifo].enable[1];
+    soundcnt.dma[fifo].timer_id = state.apu.soundcnt.dma[fifo].timer_id;
+  }
+
+  // The mixer reconfigures the host resamplers if the resolution changed.
+  mmio.bias.level = state.apu.bias.level;
+  mmio.bias.resolution = state.apu.bias.resolution;
+
+  latch[0] = state.apu.latch[0];
+  latch[1] = state.apu.latch[1];
+}
+
+void APU::CopyState(SaveState& state) {
+  auto& soundcnt = mmio.soundcnt;
+
+  mmio.fifo[0].CopyState(state.apu.fifo[0]);
+  mmio.fifo[1].CopyState(state.apu.fifo[1]);
+  mmio.psg1.CopyState(state.apu.psg1);
+  mmio.psg2.CopyState(state.apu.psg2);
+  mmio.psg3.CopyState(state.apu.psg3);
+  mmio.psg4.CopyState(state.apu.psg4);
+
+  state.apu.soundcnt.master_enable = soundcnt.master_enable;
+  state.apu.soundcnt.psg.volume = soundcnt.psg.volume;
+  for (int side = 0; side < 2; side++) {
+    state.apu.soundcnt.psg.master[side] = soundcnt.psg.master[side];
+    for (int channel = 0; channel < 4; channel++) {
+      state.apu.soundcnt.psg.enable[side][channel] = soundcnt.psg.enable[side][channel];
+    }
+  }
+  for (int fifo = 0; fifo < 2; fifo++) {
+    state.apu.soundcnt.dma[fifo].volume = soundcnt.dma[fifo].volume;
+    state.apu.soundcnt.dma[fifo].enable[0] = soundcnt.dma[fifo].enable[0];
+    state.apu.soundcnt.dma[fifo].enable[1] = soundcnt.dma[fifo].enable[1];
+    state.apu.soundcnt.dma[fifo].timer_id = soundcnt.dma[fifo].timer_id;
+  }
+
+  state.apu.bias.level = mmio.bias.level;
+  state.apu.bias.resolution = mmio.bias.resolution;
+
+  state.apu.latch[0] = latch[0];
+  state.apu.latch[1] = latch[1];
+}
+
+void QuadChannel::LoadState(SaveState::APU::QuadChannel const& state) {
+  BaseChannel::LoadState(state);
+  sample = state.sample;
+  phase = state.phase;
+  wave_duty = state.wave_duty;
+  dac_enable = state.dac_enable;
+}
+
+void QuadChannel::CopyState(SaveState::APU::QuadChannel& state) {
+  BaseChannel::CopyState(state);
+  state.sample = sample;
+  state.phase = phase;
+  state.wave_duty = wave_duty;
+  state.dac_enable = dac_enable;
+}
+
+void WaveChannel::LoadState(SaveState::APU::WaveChannel const& state) {
+  BaseChannel::LoadState(state);
+  sample = state.sample;
+  playing = state.playing;
+  force_volume = state.force_volume;
+  volume = state.volume;
+  frequency = state.frequency;
+  dimension = state.dimension;
+  wave_bank = state.wave_bank;
+  std::memcpy(wave_ram, state.wave_ram, sizeof(wave_ram));
+  phase = state.phase;
+}
+
+void WaveChannel::CopyState(SaveState::APU::WaveChannel& state) {
+  BaseChannel::CopyState(state);
+  state.sample = sample;
+  state.playing = playing;
+  state.force_volume = force_volume;
+  state.volume = volume;
+  state.frequency = frequency;
+  state.dimension = dimension;
+  state.wave_bank = wave_bank;
+  std::memcpy(state.wave_ram, wave_ram, sizeof(wave_ram));
+  state.phase = phase;
+}
+
+void NoiseChannel::LoadState(SaveState::APU::NoiseChannel const& state) {
+  BaseChannel::LoadState(state);
+  sample = state.sample;
+  lfsr = state.lfsr;
+  frequency_shift = state.frequency_shift;
+  frequency_ratio = state.frequency_ratio;
+  width = state.width;
+  dac_enable = state.dac_enable;
+  skip_count = state.skip_count;
+}
+
+void NoiseChannel::CopyState(SaveState::APU::NoiseChannel& state) {
+  BaseChannel::CopyState(state);
+  state.sample = sample;
+  state.lfsr = lfsr;
+  state.frequency_shift = frequency_shift;
+  state.frequency_ratio = frequency_ratio;
+  state.width = width;
+  state.dac_enable = dac_enable;
+  state.skip_count = skip_count;
+}
+
+} // namespace nba::core
@@ -6,6 +6,7 @@
  */
 
 #include <common/compiler.hpp>
+#include <common/trace.hpp>
 #include <emulator/core/cpu-mmio.hpp>
 
 #include "dma.hpp"
@@ -24,6 +25,10 @@ static constexpr int g_dma_dst_modify[2][4] = {
 
 static constexpr int g_dma_none_id = -1;
 
+static constexpr const char* g_dma_trace_name[] = {
+  "dma0", "dma1", "dma2", "dma3"
+};
+
 // NOTE: Retrieves DMA with highest priority from a DMA bitset.
 static constexpr int g_dma_from_bitset[] = {
   /* 0b0000 */ g_dma_none_id,
@@ -74,19 +79,21 @@ void DMA::ScheduleDMAs(unsigned int bitset) {
   while (bitset > 0) {
     auto chan_id = g_dma_from_bitset[bitset];
     bitset &= ~(1 << chan_id);
-    channels[chan_id].startup_event = scheduler.Add(2, [this, chan_id](int cycles_late) {
-      channels[chan_id].startup_event = nullptr;
-      if (runnable_set.none()) {
-        active_dma_id = chan_id;
-      } else if (chan_id < active_dma_id) {
-        active_dma_id = chan_id;
-        early_exit_trigger = true;
-      }
-      runnable_set.set(chan_id, true);
-    });
+    channels[chan_id].startup_event = scheduler.Add(2, Scheduler::EventClass::DMA_Activated, chan_id);
   }
 }
 
+void DMA::OnActivated(int chan_id) {
+  channels[chan_id].startup_event = nullptr;
+  if (runnable_set.none()) {
+    active_dma_id = chan_id;
+  } else if (chan_id < active_dma_id) {
+    active_dma_id = chan_id;
+    early_exit_trigger = true;
+  }
+  runnable_set.set(chan_id, true);
+}
+
 void DMA::SelectNextDMA() {
   active_dma_id = g_dma_from_bitset[runnable_set.to_ulong()];
 }
@@ -141,10 +148,13 @@ void DMA::Run() {
 
 void DMA::RunChannel(bool first) {
   auto& channel = channels[active_dma_id];
+  common::trace::Scope trace{"dma", g_dma_trace_name[channel.id], scheduler};
   int dst_modify;
   int src_modify;
   auto size = channel.size;
   auto access = Access::Nonsequential;
+  auto timestamp = scheduler.GetTimestampNow();
+  auto length = channel.latch.length;
 
   // TODO: we are caching the size, source and destination address delta.
   // But is it possible for a DMA channel to change its own configuration?
@@ -169,6 +179,7 @@ void DMA::RunChannel(bool first) {
   while (channel.latch.length != 0) {
     if (early_exit_trigger) {
       early_exit_trigger = false;
+      RecordStats(channel, timestamp, length - channel.latch.length, false);
       return;
     }
 
@@ -206,6 +217,7 @@ void DMA::RunChannel(bool first) {
     access = Access::Sequential;
   }
 
+  RecordStats(channel, timestamp, length, true);
   runnable_set.set(channel.id, false);
 
   if (channel.interrupt) {
@@ -236,6 +248,24 @@ void DMA::RunChannel(bool first) {
   SelectNextDMA();
 }
 
+void DMA::RecordStats(Channel const& channel, u64 timestamp, u32 units, bool completed) {
+  scheduler.stats.dma_units += units;
+
+  if constexpr (BusStats::kEnabled) {
+    auto occasion = BusStats::Occasion::Immediate;
+
+    switch (channel.time) {
+      case Channel::Immediate: occasion = BusStats::Occasion::Immediate; break;
+      case Channel::VBlank:    occasion = BusStats::Occasion::VBlank; break;
+      case Channel::HBlank:    occasion = BusStats::Occasion::HBlank; break;
+      case Channel::Special:   occasion = channel.is_fifo_dma ? BusStats::Occasion::FIFO : BusStats::Occasion::Video; break;
+    }
+
+    scheduler.bus_stats.RecordTransfer(channel.id, occasion, units,
+      int(scheduler.GetTimestampNow() - timestamp), completed);
+  }
+}
+
 auto DMA::Read(int chan_id, int offset) -> u8 {
   auto const& channel = channels[chan_id];
 
@@ -12,6 +12,7 @@
 #include <emulator/core/arm/memory.hpp>
 #include <emulator/core/hw/interrupt.hpp>
 #include <emulator/core/scheduler.hpp>
+#include <emulator/save_state.hpp>
 
 namespace nba::core {
 
@@ -22,6 +23,9 @@ struct DMA {
       : memory(memory)
       , irq(irq)
       , scheduler(scheduler) {
+    scheduler.Register(Scheduler::EventClass::DMA_Activated, [this](u64 chan_id) {
+      OnActivated(int(chan_id));
+    });
     Reset();
   }
 
@@ -34,6 +38,8 @@ struct DMA {
   };
 
   void Reset();
+  void LoadState(SaveState const& state);
+  void CopyState(SaveState& state);
   void Request(Occasion occasion);
   void StopVideoXferDMA();
   void Run();
@@ -106,9 +112,11 @@ private:
   }
 
   void ScheduleDMAs(unsigned int bitset);
+  void OnActivated(int chan_id);
   void SelectNextDMA();
   void OnChannelWritten(Channel& channel, bool enable_old);
   void RunChannel(bool first);
+  void RecordStats(Channel const& channel, u64 timestamp, u32 units, bool completed);
 
   arm::MemoryBase& memory;
   IRQ& irq;
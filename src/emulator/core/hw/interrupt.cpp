@@ -83,10 +83,7 @@ void IRQ::UpdateIRQLine() {
     if (event != nullptr) {
       scheduler.Cancel(event);
     }
-    event = scheduler.Add(1, [=](int late) {
-      cpu.IRQLine() = irq_line;
-      event = nullptr;
-    });
+    event = scheduler.Add(1, Scheduler::EventClass::IRQ_UpdateLine, irq_line);
   }
 }
 
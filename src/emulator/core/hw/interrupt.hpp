@@ -10,6 +10,7 @@
 #include <common/integer.hpp>
 #include <emulator/core/arm/arm7tdmi.hpp>
 #include <emulator/core/scheduler.hpp>
+#include <emulator/save_state.hpp>
 
 namespace nba::core {
 
@@ -28,6 +29,10 @@ struct IRQ {
   IRQ(arm::ARM7TDMI& cpu, Scheduler& scheduler)
       : cpu(cpu)
       , scheduler(scheduler) {
+    scheduler.Register(Scheduler::EventClass::IRQ_UpdateLine, [this](u64 irq_line) {
+      this->cpu.IRQLine() = irq_line != 0;
+      event = nullptr;
+    });
     Reset();
   }
 
@@ -39,6 +44,19 @@ struct IRQ {
     cpu.IRQLine() = false;
   }
 
+  void LoadState(SaveState const& state) {
+    reg_ime = state.irq.reg_ime;
+    reg_ie = state.irq.reg_ie;
+    reg_if = state.irq.reg_if;
+    event = scheduler.Find(Scheduler::EventClass::IRQ_UpdateLine);
+  }
+
+  void CopyState(SaveState& state) {
+    state.irq.reg_ime = reg_ime;
+    state.irq.reg_ie = reg_ie;
+    state.irq.reg_if = reg_if;
+  }
+
   auto Read(int offset) const -> u8;
   void Write(int offset, u8 value);
   void Raise(IRQ::Source source, int channel = 0);
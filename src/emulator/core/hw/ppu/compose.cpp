@@ -6,6 +6,7 @@
  */
 
 #include <algorithm>
+#include <common/trace.hpp>
 
 #include "ppu.hpp"
 
@@ -25,6 +26,14 @@ auto PPU::ConvertColor(u16 color) -> u32 {
 }
 
 void PPU::RenderScanline() {
+  common::trace::Scope trace{"ppu", "scanline", scheduler};
+
+  if (output_enabled) {
+    scheduler.stats.scanlines_rendered++;
+  } else {
+    scheduler.stats.scanlines_skipped++;
+  }
+
   u16  vcount = mmio.vcount;
   u32* line = &output[vcount * 240];
 
@@ -5,6 +5,7 @@
  * Refer to the included LICENSE file.
  */
 
+#include <common/trace.hpp>
 #include <cstring>
 
 #include "ppu.hpp"
@@ -20,6 +21,10 @@ PPU::PPU(
     , irq(irq)
     , dma(dma)
     , config(config) {
+  scheduler.Register(Scheduler::EventClass::PPU_ScanlineComplete, this, &PPU::OnScanlineComplete);
+  scheduler.Register(Scheduler::EventClass::PPU_HblankComplete, this, &PPU::OnHblankComplete);
+  scheduler.Register(Scheduler::EventClass::PPU_VblankScanlineComplete, this, &PPU::OnVblankScanlineComplete);
+  scheduler.Register(Scheduler::EventClass::PPU_VblankHblankComplete, this, &PPU::OnVblankHblankComplete);
   Reset();
   mmio.dispstat.ppu = this;
 }
@@ -29,6 +34,9 @@ void PPU::Reset() {
   std::memset(oam,  0, 0x00400);
   std::memset(vram, 0, 0x18000);
 
+  // The first frame after reset does not draw every line, the rest must not be left over from earlier.
+  std::memset(output, 0, sizeof(output));
+
   mmio.dispcnt.Reset();
   mmio.dispstat.Reset();
   mmio.vcount = 0;
@@ -62,7 +70,7 @@ void PPU::Reset() {
   mmio.evy = 0;
   mmio.bldcnt.Reset();
 
-  scheduler.Add(1006, this, &PPU::OnScanlineComplete);
+  scheduler.Add(1006, Scheduler::EventClass::PPU_ScanlineComplete);
 }
 
 void PPU::CheckVerticalCounterIRQ() {
@@ -83,7 +91,7 @@ void PPU::OnScanlineComplete(int cycles_late) {
   auto& bgpd = mmio.bgpd;
   auto& mosaic = mmio.mosaic;
 
-  scheduler.Add(226 - cycles_late, this, &PPU::OnHblankComplete);
+  scheduler.Add(226 - cycles_late, Scheduler::EventClass::PPU_HblankComplete);
 
   mmio.dispstat.hblank_flag = 1;
 
@@ -148,9 +156,12 @@ void PPU::OnHblankComplete(int cycles_late) {
   }
 
   if (vcount == 160) {
-    config->video_dev->Draw(output);
+    if (output_enabled) {
+      common::trace::Scope trace{"ppu", "draw", scheduler};
+      config->video_dev->Draw(output);
+    }
 
-    scheduler.Add(1006 - cycles_late, this, &PPU::OnVblankScanlineComplete);
+    scheduler.Add(1006 - cycles_late, Scheduler::EventClass::PPU_VblankScanlineComplete);
     dma.Request(DMA::Occasion::VBlank);
     dispstat.vblank_flag = 1;
 
@@ -168,7 +179,7 @@ void PPU::OnHblankComplete(int cycles_late) {
     bgx[1]._current = bgx[1].initial;
     bgy[1]._current = bgy[1].initial;
   } else {
-    scheduler.Add(1006 - cycles_late, this, &PPU::OnScanlineComplete);
+    scheduler.Add(1006 - cycles_late, Scheduler::EventClass::PPU_ScanlineComplete);
     RenderScanline();
     // Render OBJs for the next scanline.
     if (mmio.dispcnt.enable[ENABLE_OBJ]) {
@@ -180,7 +191,7 @@ void PPU::OnHblankComplete(int cycles_late) {
 void PPU::OnVblankScanlineComplete(int cycles_late) {
   auto& dispstat = mmio.dispstat;
 
-  scheduler.Add(226 - cycles_late, this, &PPU::OnVblankHblankComplete);
+  scheduler.Add(226 - cycles_late, Scheduler::EventClass::PPU_VblankHblankComplete);
 
   dispstat.hblank_flag = 1;
 
@@ -202,10 +213,10 @@ void PPU::OnVblankHblankComplete(int cycles_late) {
   dispstat.hblank_flag = 0;
 
   if (vcount == 227) {
-    scheduler.Add(1006 - cycles_late, this, &PPU::OnScanlineComplete);
+    scheduler.Add(1006 - cycles_late, Scheduler::EventClass::PPU_ScanlineComplete);
     vcount = 0;
   } else {
-    scheduler.Add(1006 - cycles_late, this, &PPU::OnVblankScanlineComplete);
+    scheduler.Add(1006 - cycles_late, Scheduler::EventClass::PPU_VblankScanlineComplete);
     if (++vcount == 227) {
       dispstat.vblank_flag = 0;
       // Render OBJs for the next scanline
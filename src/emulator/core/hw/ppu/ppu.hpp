@@ -13,6 +13,7 @@
 #include <emulator/core/hw/dma.hpp>
 #include <emulator/core/hw/interrupt.hpp>
 #include <emulator/core/scheduler.hpp>
+#include <emulator/save_state.hpp>
 #include <common/integer.hpp>
 #include <functional>
 #include <type_traits>
@@ -31,6 +32,12 @@ struct PPU {
 
   void Reset();
 
+  void LoadState(SaveState const& state);
+  void CopyState(SaveState& state);
+
+  /// Whether completed frames are presented to the video device.
+  bool output_enabled = true;
+
   template<typename T>
   auto ALWAYS_INLINE ReadPRAM(u32 address) noexcept -> T {
     return common::read<T>(pram, address & 0x3FF);
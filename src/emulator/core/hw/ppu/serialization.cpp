@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <cstring>
+
+#include "ppu.hpp"
+
+namespace nba::core {
+
+void PPU::LoadState(SaveState const& state) {
+  auto& io = state.ppu.io;
+
+  std::memcpy(pram, state.ppu.pram, sizeof(pram));
+  std::memcpy(oam,  state.ppu.oam,  sizeof(oam));
+  std::memcpy(vram, state.ppu.vram, sizeof(vram));
+
+  mmio.dispcnt.mode = io.dispcnt.mode;
+  mmio.dispcnt.cgb_mode = io.dispcnt.cgb_mode;
+  mmio.dispcnt.frame = io.dispcnt.frame;
+  mmio.dispcnt.hblank_oam_access = io.dispcnt.hblank_oam_access;
+  mmio.dispcnt.oam_mapping_1d = io.dispcnt.oam_mapping_1d;
+  mmio.dispcnt.forced_blank = io.dispcnt.forced_blank;
+  for (int i = 0; i < 8; i++) {
+    mmio.dispcnt.enable[i] = io.dispcnt.enable[i];
+  }
+
+  mmio.dispstat.vblank_flag = io.dispstat.vblank_flag;
+  mmio.dispstat.hblank_flag = io.dispstat.hblank_flag;
+  mmio.dispstat.vcount_flag = io.dispstat.vcount_flag;
+  mmio.dispstat.vblank_irq_enable = io.dispstat.vblank_irq_enable;
+  mmio.dispstat.hblank_irq_enable = io.dispstat.hblank_irq_enable;
+  mmio.dispstat.vcount_irq_enable = io.dispstat.vcount_irq_enable;
+  mmio.dispstat.vcount_setting = io.dispstat.vcount_setting;
+
+  mmio.vcount = io.vcount;
+
+  for (int i = 0; i < 4; i++) {
+    auto& bgcnt = mmio.bgcnt[i];
+
+    bgcnt.priority = io.bgcnt[i].priority;
+    bgcnt.tile_block = io.bgcnt[i].tile_block;
+    bgcnt.unused = io.bgcnt[i].unused;
+    bgcnt.mosaic_enable = io.bgcnt[i].mosaic_enable;
+    bgcnt.full_palette = io.bgcnt[i].full_palette;
+    bgcnt.map_block = io.bgcnt[i].map_block;
+    bgcnt.wraparound = io.bgcnt[i].wraparound;
+    bgcnt.size = io.bgcnt[i].size;
+
+    mmio.bghofs[i] = io.bghofs[i];
+    mmio.bgvofs[i] = io.bgvofs[i];
+  }
+
+  for (int i = 0; i < 2; i++) {
+    mmio.bgx[i].initial = io.bgx[i].initial;
+    mmio.bgx[i]._current = io.bgx[i].current;
+    mmio.bgy[i].initial = io.bgy[i].initial;
+    mmio.bgy[i]._current = io.bgy[i].current;
+    mmio.bgpa[i] = io.bgpa[i];
+    mmio.bgpb[i] = io.bgpb[i];
+    mmio.bgpc[i] = io.bgpc[i];
+    mmio.bgpd[i] = io.bgpd[i];
+
+    mmio.winh[i].min = io.winh[i].min;
+    mmio.winh[i].max = io.winh[i].max;
+    mmio.winh[i]._changed = io.winh[i].changed;
+    mmio.winv[i].min = io.winv[i].min;
+    mmio.winv[i].max = io.winv[i].max;
+    mmio.winv[i]._changed = io.winv[i].changed;
+
+    for (int j = 0; j < 6; j++) {
+      mmio.winin.enable[i][j] = io.winin[i][j];
+      mmio.winout.enable[i][j] = io.winout[i][j];
+      mmio.bldcnt.targets[i][j] = io.bldcnt.targets[i][j];
+    }
+  }
+
+  mmio.mosaic.bg.size_x = io.mosaic_bg.size_x;
+  mmio.mosaic.bg.size_y = io.mosaic_bg.size_y;
+  mmio.mosaic.bg._counter_y = io.mosaic_bg.counter_y;
+  mmio.mosaic.obj.size_x = io.mosaic_obj.size_x;
+  mmio.mosaic.obj.size_y = io.mosaic_obj.size_y;
+  mmio.mosaic.obj._counter_y = io.mosaic_obj.counter_y;
+
+  mmio.bldcnt.sfx = (BlendControl::Effect)io.bldcnt.sfx;
+  mmio.eva = io.eva;
+  mmio.evb = io.evb;
+  mmio.evy = io.evy;
+
+  for (int x = 0; x < 240; x++) {
+    buffer_obj[x].color = state.ppu.buffer_obj[x].color;
+    buffer_obj[x].priority = state.ppu.buffer_obj[x].priority;
+    buffer_obj[x].alpha = state.ppu.buffer_obj[x].alpha;
+    buffer_obj[x].window = state.ppu.buffer_obj[x].window;
+  }
+
+  line_contains_alpha_obj = state.ppu.line_contains_alpha_obj;
+  std::memcpy(buffer_win, state.ppu.buffer_win, sizeof(buffer_win));
+  std::memcpy(window_scanline_enable, state.ppu.window_scanline_enable, sizeof(window_scanline_enable));
+}
+
+void PPU::CopyState(SaveState& state) {
+  auto& io = state.ppu.io;
+
+  std::memcpy(state.ppu.pram, pram, sizeof(pram));
+  std::memcpy(state.ppu.oam,  oam,  sizeof(oam));
+  std::memcpy(state.ppu.vram, vram, sizeof(vram));
+
+  io.dispcnt.mode = mmio.dispcnt.mode;
+  io.dispcnt.cgb_mode = mmio.dispcnt.cgb_mode;
+  io.dispcnt.frame = mmio.dispcnt.frame;
+  io.dispcnt.hblank_oam_access = mmio.dispcnt.hblank_oam_access;
+  io.dispcnt.oam_mapping_1d = mmio.dispcnt.oam_mapping_1d;
+  io.dispcnt.forced_blank = mmio.dispcnt.forced_blank;
+  for (int i = 0; i < 8; i++) {
+    io.dispcnt.enable[i] = mmio.dispcnt.enable[i];
+  }
+
+  io.dispstat.vblank_flag = mmio.dispstat.vblank_flag;
+  io.dispstat.hblank_flag = mmio.dispstat.hblank_flag;
+  io.dispstat.vcount_flag = mmio.dispstat.vcount_flag;
+  io.dispstat.vblank_irq_enable = mmio.dispstat.vblank_irq_enable;
+  io.dispstat.hblank_irq_enable = mmio.dispstat.hblank_irq_enable;
+  io.dispstat.vcount_irq_enable = mmio.dispstat.vcount_irq_enable;
+  io.dispstat.vcount_setting = mmio.dispstat.vcount_setting;
+
+  io.vcount = mmio.vcount;
+
+  for (int i = 0; i < 4; i++) {
+    auto& bgcnt = mmio.bgcnt[i];
+
+    io.bgcnt[i].priority = bgcnt.priority;
+    io.bgcnt[i].tile_block = bgcnt.tile_block;
+    io.bgcnt[i].unused = bgcnt.unused;
+    io.bgcnt[i].mosaic_enable = bgcnt.mosaic_enable;
+    io.bgcnt[i].full_palette = bgcnt.full_palette;
+    io.bgcnt[i].map_block = bgcnt.map_block;
+    io.bgcnt[i].wraparound = bgcnt.wraparound;
+    io.bgcnt[i].size = bgcnt.size;
+
+    io.bghofs[i] = mmio.bghofs[i];
+    io.bgvofs[i] = mmio.bgvofs[i];
+  }
+
+  for (int i = 0; i < 2; i++) {
+    io.bgx[i].initial = mmio.bgx[i].initial;
+    io.bgx[i].current = mmio.bgx[i]._current;
+    io.bgy[i].initial = mmio.bgy[i].initial;
+    io.bgy[i].current = mmio.bgy[i]._current;
+    io.bgpa[i] = mmio.bgpa[i];
+    io.bgpb[i] = mmio.bgpb[i];
+    io.bgpc[i] = mmio.bgpc[i];
+    io.bgpd[i] = mmio.bgpd[i];
+
+    io.winh[i].min = mmio.winh[i].min;
+    io.winh[i].max = mmio.winh[i].max;
+    io.winh[i].changed = mmio.winh[i]._changed;
+    io.winv[i].min = mmio.winv[i].min;
+    io.winv[i].max = mmio.winv[i].max;
+    io.winv[i].changed = mmio.winv[i]._changed;
+
+    for (int j = 0; j < 6; j++) {
+      io.winin[i][j] = mmio.winin.enable[i][j];
+      io.winout[i][j] = mmio.winout.enable[i][j];
+      io.bldcnt.targets[i][j] = mmio.bldcnt.targets[i][j];
+    }
+  }
+
+  io.mosaic_bg.size_x = mmio.mosaic.bg.size_x;
+  io.mosaic_bg.size_y = mmio.mosaic.bg.size_y;
+  io.mosaic_bg.counter_y = mmio.mosaic.bg._counter_y;
+  io.mosaic_obj.size_x = mmio.mosaic.obj.size_x;
+  io.mosaic_obj.size_y = mmio.mosaic.obj.size_y;
+  io.mosaic_obj.counter_y = mmio.mosaic.obj._counter_y;
+
+  io.bldcnt.sfx = mmio.bldcnt.sfx;
+  io.eva = mmio.eva;
+  io.evb = mmio.evb;
+  io.evy = mmio.evy;
+
+  for (int x = 0; x < 240; x++) {
+    state.ppu.buffer_obj[x].color = buffer_obj[x].color;
+    state.ppu.buffer_obj[x].priority = buffer_obj[x].priority;
+    state.ppu.buffer_obj[x].alpha = buffer_obj[x].alpha;
+    state.ppu.buffer_obj[x].window = buffer_obj[x].window;
+  }
+
+  state.ppu.line_contains_alpha_obj = line_contains_alpha_obj;
+  std::memcpy(state.ppu.buffer_win, buffer_win, sizeof(buffer_win));
+  std::memcpy(state.ppu.window_scanline_enable, window_scanline_enable, sizeof(window_scanline_enable));
+}
+
+} // namespace nba::core
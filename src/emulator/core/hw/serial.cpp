@@ -12,27 +12,81 @@
 
 namespace nba::core {
 
+static constexpr int kCyclesPerSecond = 16777216;
+static constexpr int kBaudRate[4] = { 9600, 38400, 57600, 115200 };
+
+// SIOCNT bits that mean the same in Normal and Multiplay mode (start/busy) or in all modes.
+static constexpr u16 kStart = 0x0080;
+static constexpr u16 kModeBits = 0x3000;
+static constexpr u16 kIRQEnable = 0x4000;
+
+static constexpr u16 kNormalInternalClock = 0x0001;
+static constexpr u16 kNormalFastClock = 0x0002;
+static constexpr u16 kNormalWord = 0x1000;
+
+static constexpr u16 kMultiplayChild = 0x0004;
+static constexpr u16 kMultiplayReady = 0x0008;
+static constexpr u16 kMultiplayID = 0x0030;
+static constexpr u16 kMultiplayError = 0x0040;
+
+static constexpr u16 kUARTSendFull = 0x0010;
+static constexpr u16 kUARTReceiveEmpty = 0x0020;
+static constexpr u16 kUARTError = 0x0040;
+static constexpr u16 kUARTEightBits = 0x0080;
+static constexpr u16 kUARTFIFOEnable = 0x0100;
+static constexpr u16 kUARTSendEnable = 0x0400;
+static constexpr u16 kUARTReceiveEnable = 0x0800;
+
+SerialBus::SerialBus(Scheduler& scheduler, IRQ& irq)
+    : scheduler(scheduler)
+    , irq(irq) {
+  scheduler.Register(Scheduler::EventClass::SIO_TransferComplete, [this](u64 data) {
+    OnTransferComplete(data);
+  });
+  scheduler.Register(Scheduler::EventClass::SIO_UARTReceive, [this](u64 data) {
+    OnReceive(data);
+  });
+}
+
 void SerialBus::Reset() {
-  data8 = 0;
-  data32 = 0;
+  siocnt = 0;
   rcnt = 0;
-  siocnt = {};
+  send = 0;
+  for (auto& value : data) {
+    value = 0;
+  }
+  uart_fifo_count = 0;
   mode = Mode::Normal;
 }
 
 auto SerialBus::Read(u32 address) -> u8 {
   switch (address) {
-    // TODO: in multiplayer mode SIODATA32 is aliased to SIOMULTI0-1.
-    case SIODATA32_L | 0:
-      return data32 & 0xFF;
-    case SIODATA32_L | 1:
-      return (data32 >> 8) & 0xFF;
-    case SIODATA32_H | 0:
-      return (data32 >> 16) & 0xFF;
-    case SIODATA32_H | 1:
-      return (data32 >> 24) & 0xFF;
-    case SIODATA8 | 0:
-      return data8;
+    case SIOMULTI0 | 0:
+    case SIOMULTI0 | 1:
+    case SIOMULTI1 | 0:
+    case SIOMULTI1 | 1:
+    case SIOMULTI2 | 0:
+    case SIOMULTI2 | 1:
+    case SIOMULTI3 | 0:
+    case SIOMULTI3 | 1:
+      return data[(address - SIOMULTI0) >> 1] >> ((address & 1) * 8);
+    case SIOCNT | 0:
+      return ReadControl() & 0xFF;
+    case SIOCNT | 1:
+      return ReadControl() >> 8;
+    case SIODATA8 | 0: {
+      if (mode == Mode::UART && uart_fifo_count > 0) {
+        auto value = uart_fifo[0];
+        for (int i = 1; i < uart_fifo_count; i++) {
+          uart_fifo[i - 1] = uart_fifo[i];
+        }
+        uart_fifo_count--;
+        send = (send & 0xFF00) | value;
+      }
+      return send & 0xFF;
+    }
+    case SIODATA8 | 1:
+      return send >> 8;
     case RCNT | 0:
       // TODO: bits 0-3 should return current state of SC, SD, SI, SO?
       return rcnt & 0xFF;
@@ -46,49 +100,41 @@ auto SerialBus::Read(u32 address) -> u8 {
 
 void SerialBus::Write(u32 address, u8 value) {
   switch (address) {
-    // TODO: in multiplayer mode SIODATA32 is aliased to SIOMULTI0-1.
-    case SIODATA32_L | 0:
-      data32 &= 0xFFFFFF00;
-      data32 |= value;
-      break;
-    case SIODATA32_L | 1:
-      data32 &= 0xFFFF00FF;
-      data32 |= value << 8;
-      break;
-    case SIODATA32_H | 0:
-      data32 &= 0xFF00FFFF;
-      data32 |= value << 16;
-      break;
-    case SIODATA32_H | 1:
-      data32 &= 0x00FFFFFF;
-      data32 |= value << 24;
-      // LOG_TRACE("SIO: SIODATA32 = 0x{0:08X}", data32);
+    case SIOMULTI0 | 0:
+    case SIOMULTI0 | 1:
+    case SIOMULTI1 | 0:
+    case SIOMULTI1 | 1:
+    case SIOMULTI2 | 0:
+    case SIOMULTI2 | 1:
+    case SIOMULTI3 | 0:
+    case SIOMULTI3 | 1: {
+      auto& half = data[(address - SIOMULTI0) >> 1];
+      auto shift = (address & 1) * 8;
+      half = (half & ~(0xFF << shift)) | (value << shift);
       break;
+    }
     case SIOCNT | 0:
-      // TODO: update SO during inactivity value.
-      siocnt.clock_source = static_cast<Control::ClockSource>(value & 1);
-      siocnt.clock_speed = static_cast<Control::ClockSpeed>((value >> 1) & 1);
-      if (value & 0x80) {
-        // LOG_WARN("SIO: triggered data transfer!");
-        // NOTE: this is a very rough hack.
-        if (siocnt.enable_irq)
-          irq.Raise(IRQ::Source::Serial);
-      }
+      WriteControl((siocnt & 0xFF00) | value);
       break;
     case SIOCNT | 1:
-      siocnt.unused = value & 0xF;
-      siocnt.width = static_cast<Control::Width>((value >> 4) & 1);
-      siocnt.enable_irq = value & 0x40;
+      WriteControl((siocnt & 0x00FF) | (value << 8));
+      break;
+    case SIODATA8 | 0:
+      if (mode == Mode::UART) {
+        Send(value);
+      } else {
+        send = (send & 0xFF00) | value;
+      }
       break;
-    case SIODATA8:
-      data8 = value;
-      // LOG_TRACE("SIO: SIODATA8 = 0x{0:02X}", data8);
+    case SIODATA8 | 1:
+      send = (send & 0x00FF) | (value << 8);
       break;
     case RCNT | 0:
       rcnt = (rcnt & 0xFF0F) | (value & 0xF0);
       break;
     case RCNT | 1:
       rcnt = (rcnt & 0x3EFF) | ((value << 8) & 0xC100);
+      UpdateMode();
       break;
     default:
       // LOG_ERROR("SIO: unhandled write to address 0x{0:08X} = 0x{1:02X}", address, value);
@@ -96,5 +142,196 @@ void SerialBus::Write(u32 address, u8 value) {
   }
 }
 
-} // namespace nba::core
+void SerialBus::WriteControl(u16 value) {
+  auto start = (value & kStart) && !(siocnt & kStart);
+
+  siocnt = (siocnt & ~(kModeBits | kIRQEnable)) | (value & (kModeBits | kIRQEnable));
+  UpdateMode();
+
+  // Status bits (and the start bit, which is only set by starting a transfer) are read-only.
+  u16 mask;
+
+  switch (mode) {
+    case Mode::Normal:    mask = kNormalInternalClock | kNormalFastClock | 0x0008; break;
+    case Mode::Multiplay: mask = 0x0003; break;
+    case Mode::UART:      mask = 0x0F8F; siocnt &= ~kUARTError; break;
+    default:              mask = 0x0FFF; break;
+  }
 
+  siocnt = (siocnt & ~mask) | (value & mask);
+
+  if (start && (mode == Mode::Normal || mode == Mode::Multiplay)) {
+    StartTransfer();
+  }
+}
+
+auto SerialBus::ReadControl() const -> u16 {
+  auto value = siocnt;
+
+  switch (mode) {
+    case Mode::Multiplay:
+      // SI is low for the parent, SD is high if the other players are connected.
+      value &= ~(kMultiplayChild | kMultiplayReady);
+      if (link && link->GetPlayerId() != 0) {
+        value |= kMultiplayChild;
+      }
+      if (link && link->GetPlayerCount() > 1) {
+        value |= kMultiplayReady;
+      }
+      break;
+    case Mode::UART:
+      value &= ~kUARTReceiveEmpty;
+      if (uart_fifo_count == 0) {
+        value |= kUARTReceiveEmpty;
+      }
+      break;
+    default:
+      break;
+  }
+
+  return value;
+}
+
+void SerialBus::UpdateMode() {
+  if (rcnt & 0x8000) {
+    mode = (rcnt & 0x4000) ? Mode::JOYBUS : Mode::GeneralPurpose;
+  } else if (siocnt & 0x2000) {
+    mode = (siocnt & 0x1000) ? Mode::UART : Mode::Multiplay;
+  } else {
+    mode = Mode::Normal;
+  }
+}
+
+auto SerialBus::GetTransferCycles() const -> int {
+  switch (mode) {
+    case Mode::Normal:
+      return ((siocnt & kNormalFastClock) ? 8 : 64) * ((siocnt & kNormalWord) ? 32 : 8);
+    case Mode::Multiplay: {
+      // Every player sends a start bit, 16 data bits and a stop bit.
+      auto players = link ? link->GetPlayerCount() : 1;
+      return kCyclesPerSecond / kBaudRate[siocnt & 3] * 18 * players;
+    }
+    case Mode::UART:
+      return kCyclesPerSecond / kBaudRate[siocnt & 3] * ((siocnt & kUARTEightBits) ? 10 : 9);
+    default:
+      return 0;
+  }
+}
+
+bool SerialBus::IsWaitingForClock() const {
+  return mode == Mode::Normal && (siocnt & kStart) && !(siocnt & kNormalInternalClock);
+}
+
+auto SerialBus::GetSendData() const -> u32 {
+  if (mode == Mode::Normal && (siocnt & kNormalWord)) {
+    return data[0] | (data[1] << 16);
+  }
+  if (mode == Mode::Multiplay) {
+    return send;
+  }
+  return send & 0xFF;
+}
+
+void SerialBus::StartTransfer() {
+  if (mode == Mode::Multiplay) {
+    // Only the parent starts a transfer, the children join in.
+    if (link && link->GetPlayerId() != 0) {
+      return;
+    }
+    siocnt = (siocnt | kStart) & ~kMultiplayError;
+  } else {
+    siocnt |= kStart;
+
+    // The transfer waits for the clock of the master.
+    if (!(siocnt & kNormalInternalClock)) {
+      return;
+    }
+  }
+
+  auto cycles = GetTransferCycles();
+
+  if (link) {
+    link->Send({mode, scheduler.GetTimestampNow(), cycles, GetSendData(), (siocnt & kNormalWord) ? 32 : 8});
+  } else if (mode == Mode::Multiplay) {
+    scheduler.Add(cycles, Scheduler::EventClass::SIO_TransferComplete, 0xFFFF'FFFF'FFFF'0000 | send);
+  } else {
+    scheduler.Add(cycles, Scheduler::EventClass::SIO_TransferComplete, 0xFFFF'FFFF);
+  }
+}
+
+void SerialBus::Send(u8 value) {
+  send = (send & 0xFF00) | value;
+
+  if (!(siocnt & kUARTSendEnable) || (siocnt & kUARTSendFull)) {
+    return;
+  }
+
+  auto cycles = GetTransferCycles();
+
+  siocnt |= kUARTSendFull;
+  if (link) {
+    link->Send({mode, scheduler.GetTimestampNow(), cycles, value, 8});
+  }
+  scheduler.Add(cycles, Scheduler::EventClass::SIO_TransferComplete);
+}
+
+void SerialBus::Transfer(int delay, u64 data) {
+  // The children of a Multiplay transfer are busy until it completes.
+  if (mode == Mode::Multiplay) {
+    siocnt |= kStart;
+  }
+  scheduler.Add(delay, Scheduler::EventClass::SIO_TransferComplete, data);
+}
+
+void SerialBus::Receive(int delay, u8 value) {
+  scheduler.Add(delay, Scheduler::EventClass::SIO_UARTReceive, value);
+}
+
+void SerialBus::OnTransferComplete(u64 data) {
+  switch (mode) {
+    case Mode::Normal:
+      if (siocnt & kNormalWord) {
+        this->data[0] = u16(data);
+        this->data[1] = u16(data >> 16);
+      } else {
+        send = (send & 0xFF00) | u8(data);
+      }
+      siocnt &= ~kStart;
+      break;
+    case Mode::Multiplay:
+      for (int i = 0; i < 4; i++) {
+        this->data[i] = u16(data >> (i * 16));
+      }
+      siocnt = (siocnt & ~(kStart | kMultiplayID)) | ((link ? link->GetPlayerId() : 0) << 4);
+      break;
+    case Mode::UART:
+      siocnt &= ~kUARTSendFull;
+      break;
+    default:
+      return;
+  }
+
+  if (siocnt & kIRQEnable) {
+    irq.Raise(IRQ::Source::Serial);
+  }
+}
+
+void SerialBus::OnReceive(u64 data) {
+  if (mode != Mode::UART || !(siocnt & kUARTReceiveEnable)) {
+    return;
+  }
+
+  auto capacity = (siocnt & kUARTFIFOEnable) ? kUARTFIFOSize : 1;
+
+  if (uart_fifo_count == capacity) {
+    siocnt |= kUARTError;
+  } else {
+    uart_fifo[uart_fifo_count++] = u8(data);
+  }
+
+  if (siocnt & kIRQEnable) {
+    irq.Raise(IRQ::Source::Serial);
+  }
+}
+
+} // namespace nba::core
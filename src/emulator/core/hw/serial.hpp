@@ -8,52 +8,116 @@
 #pragma once
 
 #include <common/integer.hpp>
+#include <emulator/core/scheduler.hpp>
+#include <emulator/save_state.hpp>
 
 #include "interrupt.hpp"
 
 namespace nba::core {
 
+/**
+ * The serial port (SIO) in Normal, Multiplay and UART mode.
+ * Without a link cable, transfers as the master complete with all bits set,
+ * as if nothing was connected, and transfers with an external clock never complete.
+ */
 struct SerialBus {
-  SerialBus(IRQ& irq) : irq(irq) {}
+  enum class Mode {
+    Normal,
+    Multiplay,
+    UART,
+    GeneralPurpose,
+    JOYBUS
+  };
+
+  /**
+   * The other end of a link cable (see LinkHub), which is told about the transfers
+   * that this serial port starts and later completes them through Transfer() and Receive().
+   */
+  struct Link {
+    struct Message {
+      Mode mode;
+
+      /// When the transfer started, on the scheduler of the sender.
+      u64 timestamp;
+
+      /// How long the transfer takes, in cycles.
+      int cycles;
+
+      /// Data that is sent, 8 or 32 bits in Normal mode.
+      u32 data;
+      int bits;
+    };
+
+    virtual ~Link() = default;
+
+    virtual void Send(Message const& message) = 0;
+    virtual auto GetPlayerId() const -> int = 0;
+    virtual auto GetPlayerCount() const -> int = 0;
+  };
+
+  SerialBus(Scheduler& scheduler, IRQ& irq);
 
   void Reset();
+  void LoadState(SaveState const& state);
+  void CopyState(SaveState& state);
   auto Read(u32 address) -> u8;
   void Write(u32 address, u8 value);
+  void WriteControl(u16 value);
+
+  /// Plugs in a link cable, or unplugs it if the link is nullptr.
+  void Connect(Link* link) {
+    this->link = link;
+  }
+
+  /* The following methods are used by the link,
+   * between the quanta in which the linked emulators run.
+   */
+
+  auto GetMode() const -> Mode { return mode; }
+
+  /// Whether a transfer in Normal mode waits for the clock of the master.
+  bool IsWaitingForClock() const;
+
+  /// The data that is sent by the next transfer: SIODATA8 or SIODATA32 in Normal mode, SIOMLT_SEND in Multiplay mode.
+  auto GetSendData() const -> u32;
+
+  /**
+   * Completes a transfer after a delay with the received data.
+   * In Multiplay mode, the data holds the 16 bits sent by each player, player 0 in the lowest bits.
+   */
+  void Transfer(int delay, u64 data);
+
+  /// Receives a byte in UART mode after a delay.
+  void Receive(int delay, u8 value);
 
 private:
-  u8 data8;
-  u32 data32;
+  static constexpr int kUARTFIFOSize = 4;
+
+  void UpdateMode();
+  void StartTransfer();
+  void OnTransferComplete(u64 data);
+  void OnReceive(u64 data);
+  void Send(u8 value);
+  auto ReadControl() const -> u16;
+  auto GetTransferCycles() const -> int;
+
+  u16 siocnt;
   u16 rcnt;
 
-  struct Control {
-    enum class ClockSource {
-      External = 0,
-      Internal = 1
-    } clock_source = ClockSource::External;
-    // NOTE: this only applies to the internal clock and is ignored when the clock is external.
-    enum ClockSpeed {
-      _256KHz = 0,
-      _2MHz = 1
-    } clock_speed = ClockSpeed::_256KHz;
-    // TODO: SI/SO state?
-    bool busy = false;
-    u8 unused = 0;
-    enum Width {
-      Byte = 0,
-      Word = 1
-    } width = Width::Byte;
-    bool enable_irq = false;
-  } siocnt;
+  /// SIODATA32 in Normal mode and SIOMULTI0-3 in Multiplay mode.
+  u16 data[4];
 
-  enum class Mode {
-    Normal,
-    Multiplay,
-    UART,
-    GeneralPurpose,
-    JOYBUS
-  } mode;
+  /// SIODATA8 in Normal and UART mode and SIOMLT_SEND in Multiplay mode.
+  u16 send;
+
+  u8 uart_fifo[kUARTFIFOSize];
+  int uart_fifo_count;
+
+  Mode mode;
 
+  Scheduler& scheduler;
   IRQ& irq;
+  Link* link = nullptr;
 };
 
 } // namespace nba::core
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include "dma.hpp"
+#include "serial.hpp"
+#include "timer.hpp"
+
+namespace nba::core {
+
+void DMA::LoadState(SaveState const& state) {
+  for (int id = 0; id < 4; id++) {
+    auto& channel = channels[id];
+    auto& channel_state = state.dma.channels[id];
+
+    channel.enable = channel_state.enable;
+    channel.repeat = channel_state.repeat;
+    channel.interrupt = channel_state.interrupt;
+    channel.gamepak = channel_state.gamepak;
+    channel.length = channel_state.length;
+    channel.dst_addr = channel_state.dst_addr;
+    channel.src_addr = channel_state.src_addr;
+    channel.dst_cntl = (Channel::Control)channel_state.dst_cntl;
+    channel.src_cntl = (Channel::Control)channel_state.src_cntl;
+    channel.time = (Channel::Timing)channel_state.time;
+    channel.size = (Channel::Size)channel_state.size;
+    channel.is_fifo_dma = channel_state.is_fifo_dma;
+    channel.latch.length = channel_state.latch.length;
+    channel.latch.dst_addr = channel_state.latch.dst_addr;
+    channel.latch.src_addr = channel_state.latch.src_addr;
+    channel.latch.bus = channel_state.latch.bus;
+    channel.startup_event = scheduler.Find(Scheduler::EventClass::DMA_Activated, id);
+  }
+
+  active_dma_id = state.dma.active_dma_id;
+  early_exit_trigger = state.dma.early_exit_trigger;
+  hblank_set = state.dma.hblank_set;
+  vblank_set = state.dma.vblank_set;
+  video_set = state.dma.video_set;
+  runnable_set = state.dma.runnable_set;
+  latch = state.dma.latch;
+}
+
+void DMA::CopyState(SaveState& state) {
+  for (int id = 0; id < 4; id++) {
+    auto& channel = channels[id];
+    auto& channel_state = state.dma.channels[id];
+
+    channel_state.enable = channel.enable;
+    channel_state.repeat = channel.repeat;
+    channel_state.interrupt = channel.interrupt;
+    channel_state.gamepak = channel.gamepak;
+    channel_state.length = channel.length;
+    channel_state.dst_addr = channel.dst_addr;
+    channel_state.src_addr = channel.src_addr;
+    channel_state.dst_cntl = channel.dst_cntl;
+    channel_state.src_cntl = channel.src_cntl;
+    channel_state.time = channel.time;
+    channel_state.size = channel.size;
+    channel_state.is_fifo_dma = channel.is_fifo_dma;
+    channel_state.latch.length = channel.latch.length;
+    channel_state.latch.dst_addr = channel.latch.dst_addr;
+    channel_state.latch.src_addr = channel.latch.src_addr;
+    channel_state.latch.bus = channel.latch.bus;
+  }
+
+  state.dma.active_dma_id = active_dma_id;
+  state.dma.early_exit_trigger = early_exit_trigger;
+  state.dma.hblank_set = hblank_set.to_ulong();
+  state.dma.vblank_set = vblank_set.to_ulong();
+  state.dma.video_set = video_set.to_ulong();
+  state.dma.runnable_set = runnable_set.to_ulong();
+  state.dma.latch = latch;
+}
+
+void Timer::LoadState(SaveState const& state) {
+  for (int id = 0; id < 4; id++) {
+    auto& channel = channels[id];
+    auto& channel_state = state.timer[id];
+
+    channel.reload = channel_state.reload;
+    channel.counter = channel_state.counter;
+    channel.control.frequency = channel_state.frequency;
+    channel.control.cascade = channel_state.cascade;
+    channel.control.interrupt = channel_state.interrupt;
+    channel.control.enable = channel_state.enable;
+    channel.running = channel_state.running;
+    channel.shift = channel_state.shift;
+    channel.mask = channel_state.mask;
+    channel.samplerate = channel_state.samplerate;
+    channel.timestamp_started = channel_state.timestamp_started;
+    channel.event = scheduler.Find(Scheduler::EventClass::TM_Overflow, id);
+  }
+}
+
+void Timer::CopyState(SaveState& state) {
+  for (int id = 0; id < 4; id++) {
+    auto& channel = channels[id];
+    auto& channel_state = state.timer[id];
+
+    channel_state.reload = channel.reload;
+    channel_state.counter = channel.counter;
+    channel_state.frequency = channel.control.frequency;
+    channel_state.cascade = channel.control.cascade;
+    channel_state.interrupt = channel.control.interrupt;
+    channel_state.enable = channel.control.enable;
+    channel_state.running = channel.running;
+    channel_state.shift = channel.shift;
+    channel_state.mask = channel.mask;
+    channel_state.samplerate = channel.samplerate;
+    channel_state.timestamp_started = channel.timestamp_started;
+  }
+}
+
+void SerialBus::LoadState(SaveState const& state) {
+  siocnt = state.serial_bus.siocnt;
+  rcnt = state.serial_bus.rcnt;
+  send = state.serial_bus.send;
+  for (int i = 0; i < 4; i++) {
+    data[i] = state.serial_bus.data[i];
+  }
+  for (int i = 0; i < kUARTFIFOSize; i++) {
+    uart_fifo[i] = state.serial_bus.uart_fifo[i];
+  }
+  uart_fifo_count = state.serial_bus.uart_fifo_count;
+  mode = (Mode)state.serial_bus.mode;
+}
+
+void SerialBus::CopyState(SaveState& state) {
+  state.serial_bus.siocnt = siocnt;
+  state.serial_bus.rcnt = rcnt;
+  state.serial_bus.send = send;
+  for (int i = 0; i < 4; i++) {
+    state.serial_bus.data[i] = data[i];
+  }
+  for (int i = 0; i < kUARTFIFOSize; i++) {
+    state.serial_bus.uart_fifo[i] = uart_fifo[i];
+  }
+  state.serial_bus.uart_fifo_count = uart_fifo_count;
+  state.serial_bus.mode = (int)mode;
+}
+
+} // namespace nba::core
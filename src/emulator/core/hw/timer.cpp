@@ -19,12 +19,6 @@ void Timer::Reset() {
     auto& channel = channels[id];
     channel = {};
     channel.id = id;
-    channel.event_cb = [this, id](int cycles_late) {
-      // FIXME: ideally we would just capture the existing channel reference... not sure if it is possible.
-      auto& channel = channels[id];
-      OnOverflow(channel);
-      StartChannel(channel, cycles_late);
-    };
   }
 }
 
@@ -119,7 +113,7 @@ void Timer::StartChannel(Channel& channel, int cycles_late) {
 
   channel.running = true;
   channel.timestamp_started = scheduler.GetTimestampNow() - cycles_late;
-  channel.event = scheduler.Add(cycles - cycles_late, channel.event_cb);
+  channel.event = scheduler.Add(cycles - cycles_late, Scheduler::EventClass::TM_Overflow, channel.id);
 }
 
 void Timer::StopChannel(Channel& channel) {
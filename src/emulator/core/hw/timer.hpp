@@ -10,6 +10,7 @@
 #include <common/integer.hpp>
 #include <emulator/core/hw/interrupt.hpp>
 #include <emulator/core/scheduler.hpp>
+#include <emulator/save_state.hpp>
 
 #include "apu/apu.hpp"
 
@@ -20,10 +21,17 @@ struct Timer {
       : scheduler(scheduler)
       , irq(irq)
       , apu(apu) {
+    scheduler.Register(Scheduler::EventClass::TM_Overflow, [this](u64 chan_id) {
+      auto& channel = channels[chan_id];
+      OnOverflow(channel);
+      StartChannel(channel, 0);
+    });
     Reset();
   }
 
   void Reset();
+  void LoadState(SaveState const& state);
+  void CopyState(SaveState& state);
   auto Read (int chan_id, int offset) -> u8;
   void Write(int chan_id, int offset, u8 value);
 
@@ -51,7 +59,6 @@ private:
     int samplerate;
     u64 timestamp_started;
     Scheduler::Event* event = nullptr;
-    std::function<void(int)> event_cb;
   } channels[4];
 
   Scheduler& scheduler;
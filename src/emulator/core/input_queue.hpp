@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <common/integer.hpp>
+
+namespace nba::core {
+
+/**
+ * Lock-free queue of KEYINPUT values, which one frontend thread pushes
+ * and the emulation thread drains, so that only the latter touches the keypad registers.
+ * Timestamps are in emulated cycles since reset and must not decrease from one entry to the next.
+ */
+struct InputQueue {
+  /// Timestamp of an entry that takes effect as soon as the emulation thread sees it.
+  static constexpr u64 kNow = 0;
+
+  static constexpr u64 kCapacity = 256;
+
+  struct Entry {
+    u64 timestamp;
+    u16 keyinput; ///< active low, like the KEYINPUT register
+  };
+
+  /**
+   * Called by the producer.
+   * A full queue keeps the value and sets the overflow flag instead,
+   * so that the latest key state is never lost, but its timestamp is.
+   */
+  void Push(Entry const& entry) {
+    auto head = this->head.load(std::memory_order_relaxed);
+
+    latest.store(entry.keyinput, std::memory_order_relaxed);
+
+    if (head - tail.load(std::memory_order_acquire) == kCapacity) {
+      overflow.store(true, std::memory_order_release);
+      return;
+    }
+
+    entries[head % kCapacity] = entry;
+    this->head.store(head + 1, std::memory_order_release);
+  }
+
+  /// Called by the consumer for every emulated instruction, so this must stay cheap.
+  bool HasPending() const {
+    return head.load(std::memory_order_relaxed) != tail.load(std::memory_order_relaxed);
+  }
+
+  /// Called by the consumer. Returns a copy of the oldest entry without removing it.
+  bool Peek(Entry& entry) const {
+    auto tail = this->tail.load(std::memory_order_relaxed);
+
+    if (tail == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    entry = entries[tail % kCapacity];
+    return true;
+  }
+
+  /// Called by the consumer after Peek().
+  void Pop() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  /**
+   * Called by the consumer once the queue has been drained.
+   * Returns true and the most recently pushed value if entries were lost to a full queue.
+   */
+  bool TakeOverflow(u16& keyinput) {
+    if (!overflow.load(std::memory_order_relaxed) || !overflow.exchange(false, std::memory_order_acquire)) {
+      return false;
+    }
+    keyinput = latest.load(std::memory_order_relaxed);
+    return true;
+  }
+
+private:
+  alignas(64) std::atomic<u64> head = 0;
+  alignas(64) std::atomic<u64> tail = 0;
+  std::atomic<u16> latest = 0x3FF;
+  std::atomic_bool overflow = false;
+  Entry entries[kCapacity];
+};
+
+} // namespace nba::core
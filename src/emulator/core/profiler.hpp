@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <common/integer.hpp>
+
+namespace nba::core {
+
+/**
+ * Attributes host time to the subsystem that the emulator is currently running.
+ * Subsystems nest (e.g. a DMA triggers events, which render a scanline),
+ * but each moment is only counted for the innermost subsystem.
+ *
+ * Timings are only collected if the core is built with NBA_PROFILE,
+ * otherwise all methods compile to nothing.
+ */
+struct Profiler {
+  enum class Subsystem {
+    None,
+    ARM,
+    Scheduler,
+    PPU,
+    APU,
+    DMA,
+    Timer,
+    IRQ,
+    Serial,
+    Count
+  };
+
+#ifdef NBA_PROFILE
+  static constexpr bool kEnabled = true;
+#else
+  static constexpr bool kEnabled = false;
+#endif
+
+  struct Scope {
+    Scope(Profiler& profiler, Subsystem subsystem)
+        : profiler(profiler)
+        , previous(profiler.Enter(subsystem)) {
+    }
+
+   ~Scope() {
+      profiler.Leave(previous);
+    }
+
+  private:
+    Profiler& profiler;
+    Subsystem previous;
+  };
+
+  void Reset() {
+    for (auto& value : nanoseconds) {
+      value = 0;
+    }
+  }
+
+  auto GetNanoseconds(Subsystem subsystem) const -> u64 {
+    return nanoseconds[int(subsystem)];
+  }
+
+  auto Enter(Subsystem subsystem) -> Subsystem {
+    auto previous = current;
+    Switch(subsystem);
+    return previous;
+  }
+
+  void Leave(Subsystem previous) {
+    Switch(previous);
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  void Switch([[maybe_unused]] Subsystem subsystem) {
+#ifdef NBA_PROFILE
+    auto now = Clock::now();
+    nanoseconds[int(current)] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - timestamp).count();
+    timestamp = now;
+    current = subsystem;
+#endif
+  }
+
+  Subsystem current = Subsystem::None;
+  Clock::time_point timestamp;
+  u64 nanoseconds[int(Subsystem::Count)] {};
+};
+
+} // namespace nba::core
@@ -10,21 +10,77 @@
 #include <common/log.hpp>
 #include <common/compiler.hpp>
 #include <common/integer.hpp>
+#include <common/trace.hpp>
+#include <emulator/save_state.hpp>
 #include <functional>
 #include <limits>
 
+#include "bus_stats.hpp"
+#include "profiler.hpp"
+#include "stats.hpp"
+
 namespace nba::core {
 
-struct Scheduler {  
+struct Scheduler {
+  /* Stable identifiers for each kind of event.
+   * Events are referred to by their class (rather than a callback) so that
+   * the event queue can be stored in and restored from a save state.
+   */
+  enum class EventClass : u16 {
+    EndOfQueue,
+
+    // ARM
+    ARM_LDMUsermodeConflict,
+
+    // IRQ
+    IRQ_UpdateLine,
+
+    // DMA
+    DMA_Activated,
+
+    // Timer
+    TM_Overflow,
+
+    // PPU
+    PPU_ScanlineComplete,
+    PPU_HblankComplete,
+    PPU_VblankScanlineComplete,
+    PPU_VblankHblankComplete,
+
+    // APU
+    APU_Mixer,
+    APU_Sequencer,
+    APU_PSG1_Generate,
+    APU_PSG2_Generate,
+    APU_PSG3_Generate,
+    APU_PSG4_Generate,
+
+    // SIO
+    SIO_TransferComplete,
+    SIO_UARTReceive,
+
+    // Keypad
+    KEYPAD_Input,
+
+    Count
+  };
+
+  static_assert(int(EventClass::Count) <= Stats::kMaxEventClasses);
+
   template<class T>
   using EventMethod = void (T::*)(int);
 
   struct Event {
-    std::function<void(int)> callback;
+    auto GetClass() const -> EventClass { return event_class; }
+    auto GetUserData() const -> u64 { return user_data; }
+    auto GetTimestamp() const -> u64 { return timestamp; }
+
   private:
-    friend class Scheduler;
+    friend struct Scheduler;
     int handle;
     u64 timestamp;
+    u64 user_data;
+    EventClass event_class;
   };
 
   Scheduler() {
@@ -32,6 +88,9 @@ struct Scheduler {
       heap[i] = new Event();
       heap[i]->handle = i;
     }
+    Register(EventClass::EndOfQueue, [](u64) {
+      ASSERT(false, "event queue was empty or reached the end of time.")
+    });
     Reset();
   }
 
@@ -44,8 +103,21 @@ struct Scheduler {
   void Reset() {
     heap_size = 0;
     timestamp_now = 0;
-    Add(std::numeric_limits<u64>::max(), [](int) {
-      ASSERT(false, "event queue was empty or reached the end of time.")
+    Add(std::numeric_limits<u64>::max(), EventClass::EndOfQueue);
+  }
+
+  /**
+   * Sets the function that is called when an event of the given class is due.
+   * The function receives the user data that the event was added with.
+   */
+  void Register(EventClass event_class, std::function<void(u64)> callback) {
+    callbacks[int(event_class)] = std::move(callback);
+  }
+
+  template<class T>
+  void Register(EventClass event_class, T* object, EventMethod<T> method) {
+    Register(event_class, [object, method]([[maybe_unused]] u64 user_data) {
+      (object->*method)(0);
     });
   }
 
@@ -67,15 +139,114 @@ struct Scheduler {
     timestamp_now = timestamp_next;
   }
 
-  auto Add(u64 delay, std::function<void(int)> callback) -> Event* {
+  auto Add(u64 delay, EventClass event_class, u64 user_data = 0) -> Event* {
+    return AddAt(GetTimestampNow() + delay, event_class, user_data);
+  }
+
+  void Cancel(Event* event) {
+    Remove(event->handle);
+  }
+
+  /// Returns the first pending event of a class, or nullptr if there is none.
+  auto Find(EventClass event_class) -> Event* {
+    for (int i = 0; i < heap_size; i++) {
+      if (heap[i]->event_class == event_class) {
+        return heap[i];
+      }
+    }
+    return nullptr;
+  }
+
+  /// Returns the first pending event of a class with the given user data, or nullptr if there is none.
+  auto Find(EventClass event_class, u64 user_data) -> Event* {
+    for (int i = 0; i < heap_size; i++) {
+      if (heap[i]->event_class == event_class && heap[i]->user_data == user_data) {
+        return heap[i];
+      }
+    }
+    return nullptr;
+  }
+
+  void LoadState(SaveState const& state);
+  void CopyState(SaveState& state);
+
+  Profiler profiler;
+  BusStats bus_stats;
+  Stats stats;
+
+private:
+  static constexpr int kMaxEvents = 64;
+
+  /**
+   * Subsystem that the host time spent in an event is attributed to.
+   * Spelled out as a switch, so that a new event class without an entry
+   * is reported by -Wswitch instead of shifting every entry after it.
+   */
+  static constexpr auto GetEventSubsystem(EventClass event_class) -> Profiler::Subsystem {
+    switch (event_class) {
+      case EventClass::EndOfQueue: return Profiler::Subsystem::Scheduler;
+      case EventClass::ARM_LDMUsermodeConflict: return Profiler::Subsystem::ARM;
+      case EventClass::IRQ_UpdateLine: return Profiler::Subsystem::IRQ;
+      case EventClass::DMA_Activated: return Profiler::Subsystem::DMA;
+      case EventClass::TM_Overflow: return Profiler::Subsystem::Timer;
+      case EventClass::PPU_ScanlineComplete:
+      case EventClass::PPU_HblankComplete:
+      case EventClass::PPU_VblankScanlineComplete:
+      case EventClass::PPU_VblankHblankComplete: return Profiler::Subsystem::PPU;
+      case EventClass::APU_Mixer:
+      case EventClass::APU_Sequencer:
+      case EventClass::APU_PSG1_Generate:
+      case EventClass::APU_PSG2_Generate:
+      case EventClass::APU_PSG3_Generate:
+      case EventClass::APU_PSG4_Generate: return Profiler::Subsystem::APU;
+      case EventClass::SIO_TransferComplete:
+      case EventClass::SIO_UARTReceive: return Profiler::Subsystem::Serial;
+      case EventClass::KEYPAD_Input: return Profiler::Subsystem::ARM;
+      case EventClass::Count: break;
+    }
+    return Profiler::Subsystem::Scheduler;
+  }
+
+  /// Name of each event class in a trace.
+  static constexpr auto GetEventName(EventClass event_class) -> const char* {
+    switch (event_class) {
+      case EventClass::EndOfQueue: return "end-of-queue";
+      case EventClass::ARM_LDMUsermodeConflict: return "arm-ldm-usermode-conflict";
+      case EventClass::IRQ_UpdateLine: return "irq-update-line";
+      case EventClass::DMA_Activated: return "dma-activated";
+      case EventClass::TM_Overflow: return "timer-overflow";
+      case EventClass::PPU_ScanlineComplete: return "ppu-scanline-complete";
+      case EventClass::PPU_HblankComplete: return "ppu-hblank-complete";
+      case EventClass::PPU_VblankScanlineComplete: return "ppu-vblank-scanline-complete";
+      case EventClass::PPU_VblankHblankComplete: return "ppu-vblank-hblank-complete";
+      case EventClass::APU_Mixer: return "apu-mixer";
+      case EventClass::APU_Sequencer: return "apu-sequencer";
+      case EventClass::APU_PSG1_Generate: return "apu-psg1-generate";
+      case EventClass::APU_PSG2_Generate: return "apu-psg2-generate";
+      case EventClass::APU_PSG3_Generate: return "apu-psg3-generate";
+      case EventClass::APU_PSG4_Generate: return "apu-psg4-generate";
+      case EventClass::SIO_TransferComplete: return "sio-transfer-complete";
+      case EventClass::SIO_UARTReceive: return "sio-uart-receive";
+      case EventClass::KEYPAD_Input: return "keypad-input";
+      case EventClass::Count: break;
+    }
+    return "unknown";
+  }
+
+  constexpr int Parent(int n) { return (n - 1) / 2; }
+  constexpr int LeftChild(int n) { return n * 2 + 1; }
+  constexpr int RightChild(int n) { return n * 2 + 2; }
+
+  auto AddAt(u64 timestamp, EventClass event_class, u64 user_data) -> Event* {
     int n = heap_size++;
     int p = Parent(n);
 
     ASSERT(heap_size <= kMaxEvents, "exceeded maximum number of scheduler events.");
 
     auto event = heap[n];
-    event->timestamp = GetTimestampNow() + delay;
-    event->callback = callback;
+    event->timestamp = timestamp;
+    event->event_class = event_class;
+    event->user_data = user_data;
 
     while (n != 0 && heap[p]->timestamp > heap[n]->timestamp) {
       Swap(n, p);
@@ -86,29 +257,22 @@ struct Scheduler {
     return event;
   }
 
-  template<class T>
-  void Add(u64 delay, T* object, EventMethod<T> method) {
-    Add(delay, [object, method](int cycles_late) {
-      (object->*method)(cycles_late);
-    });
-  }
-
-  void Cancel(Event* event) {
-    Remove(event->handle);
-  }
-
-private:
-  static constexpr int kMaxEvents = 64;
+  void Step(u64 timestamp_next) {
+    if (likely(heap[0]->timestamp > timestamp_next)) {
+      return;
+    }
 
-  constexpr int Parent(int n) { return (n - 1) / 2; }
-  constexpr int LeftChild(int n) { return n * 2 + 1; }
-  constexpr int RightChild(int n) { return n * 2 + 2; }
+    Profiler::Scope scope{profiler, Profiler::Subsystem::Scheduler};
 
-  void Step(u64 timestamp_next) {
     while (heap[0]->timestamp <= timestamp_next && heap_size > 0) {
       auto event = heap[0];
       timestamp_now = event->timestamp;
-      event->callback(0);
+      stats.events[int(event->event_class)]++;
+      profiler.Enter(GetEventSubsystem(event->event_class));
+      common::trace::begin("scheduler", GetEventName(event->event_class), timestamp_now);
+      callbacks[int(event->event_class)](event->user_data);
+      common::trace::end("scheduler", GetEventName(event->event_class), timestamp_now);
+      profiler.Leave(Profiler::Subsystem::Scheduler);
       Remove(event->handle);
     }
   }
@@ -152,6 +316,7 @@ private:
   }
 
   Event* heap[kMaxEvents];
+  std::function<void(u64)> callbacks[int(EventClass::Count)];
   int heap_size;
   u64 timestamp_now;
 };
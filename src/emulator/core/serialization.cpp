@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <cstring>
+
+#include "cpu.hpp"
+
+namespace nba::core {
+
+void Scheduler::LoadState(SaveState const& state) {
+  heap_size = 0;
+  timestamp_now = state.scheduler.timestamp_now;
+
+  /* The events were stored in heap order,
+   * so adding them in sequence reproduces the exact same heap.
+   */
+  for (int i = 0; i < state.scheduler.event_count; i++) {
+    auto& event = state.scheduler.events[i];
+    AddAt(event.timestamp, EventClass(event.event_class), event.user_data);
+  }
+}
+
+void Scheduler::CopyState(SaveState& state) {
+  static_assert(SaveState::Scheduler::kMaxEvents == kMaxEvents);
+
+  state.scheduler.timestamp_now = timestamp_now;
+  state.scheduler.event_count = heap_size;
+
+  for (int i = 0; i < heap_size; i++) {
+    auto& event = state.scheduler.events[i];
+    event.timestamp = heap[i]->timestamp;
+    event.user_data = heap[i]->user_data;
+    event.event_class = u16(heap[i]->event_class);
+  }
+}
+
+void CPU::LoadState(SaveState const& save_state) {
+  auto& bus = save_state.bus;
+
+  // Components look up their pending events, so the scheduler goes first.
+  scheduler.LoadState(save_state);
+  ARM7TDMI::LoadState(save_state);
+
+  std::memcpy(memory.wram, bus.memory.wram, sizeof(memory.wram));
+  std::memcpy(memory.iram, bus.memory.iram, sizeof(memory.iram));
+  memory.bios_latch = bus.memory.bios_latch;
+
+  mmio.keyinput = bus.io.keyinput;
+  input_waiting = scheduler.Find(Scheduler::EventClass::KEYPAD_Input) != nullptr;
+  mmio.rcnt_hack = bus.io.rcnt_hack;
+  mmio.postflg = bus.io.postflg;
+  mmio.haltcnt = (HaltControl)bus.io.haltcnt;
+  mmio.waitcnt.sram = bus.io.waitcnt.sram;
+  mmio.waitcnt.ws0_n = bus.io.waitcnt.ws0_n;
+  mmio.waitcnt.ws0_s = bus.io.waitcnt.ws0_s;
+  mmio.waitcnt.ws1_n = bus.io.waitcnt.ws1_n;
+  mmio.waitcnt.ws1_s = bus.io.waitcnt.ws1_s;
+  mmio.waitcnt.ws2_n = bus.io.waitcnt.ws2_n;
+  mmio.waitcnt.ws2_s = bus.io.waitcnt.ws2_s;
+  mmio.waitcnt.phi = bus.io.waitcnt.phi;
+  mmio.waitcnt.prefetch = bus.io.waitcnt.prefetch;
+  mmio.waitcnt.cgb = bus.io.waitcnt.cgb;
+  mmio.keycnt.input_mask = bus.io.keycnt.input_mask;
+  mmio.keycnt.interrupt = bus.io.keycnt.interrupt;
+  mmio.keycnt.and_mode = bus.io.keycnt.and_mode;
+  UpdateMemoryDelayTable();
+
+  prefetch.active = bus.prefetch.active;
+  prefetch.rom_code_access = bus.prefetch.rom_code_access;
+  prefetch.head_address = bus.prefetch.head_address;
+  prefetch.last_address = bus.prefetch.last_address;
+  prefetch.count = bus.prefetch.count;
+  prefetch.capacity = bus.prefetch.capacity;
+  prefetch.opcode_width = bus.prefetch.opcode_width;
+  prefetch.countdown = bus.prefetch.countdown;
+  prefetch.duty = bus.prefetch.duty;
+
+  bus_is_controlled_by_dma = false;
+  openbus_from_dma = bus.openbus_from_dma;
+
+  auto soundinfo_address = bus.m4a.soundinfo_address;
+  switch (soundinfo_address >> 24) {
+    case 0x02:
+      m4a_soundinfo = reinterpret_cast<M4ASoundInfo*>(memory.wram + (soundinfo_address & 0x00FFFFFF));
+      break;
+    case 0x03:
+      m4a_soundinfo = reinterpret_cast<M4ASoundInfo*>(memory.iram + (soundinfo_address & 0x00FFFFFF));
+      break;
+    default:
+      m4a_soundinfo = nullptr;
+      break;
+  }
+  m4a_original_freq = bus.m4a.original_freq;
+  m4a_setfreq_address = game_pak.GetAnalysis().m4a_setfreq_address;
+
+  if (config->reference_paths) {
+    game_pak.DisablePageTable();
+  }
+
+  irq.LoadState(save_state);
+  dma.LoadState(save_state);
+  timer.LoadState(save_state);
+  apu.LoadState(save_state);
+  ppu.LoadState(save_state);
+  serial_bus.LoadState(save_state);
+  game_pak.LoadState(save_state);
+}
+
+void CPU::CopyState(SaveState& save_state) {
+  auto& bus = save_state.bus;
+
+  scheduler.CopyState(save_state);
+  ARM7TDMI::CopyState(save_state);
+
+  std::memcpy(bus.memory.wram, memory.wram, sizeof(memory.wram));
+  std::memcpy(bus.memory.iram, memory.iram, sizeof(memory.iram));
+  bus.memory.bios_latch = memory.bios_latch;
+
+  bus.io.keyinput = mmio.keyinput;
+  bus.io.rcnt_hack = mmio.rcnt_hack;
+  bus.io.postflg = mmio.postflg;
+  bus.io.haltcnt = (int)mmio.haltcnt;
+  bus.io.waitcnt.sram = mmio.waitcnt.sram;
+  bus.io.waitcnt.ws0_n = mmio.waitcnt.ws0_n;
+  bus.io.waitcnt.ws0_s = mmio.waitcnt.ws0_s;
+  bus.io.waitcnt.ws1_n = mmio.waitcnt.ws1_n;
+  bus.io.waitcnt.ws1_s = mmio.waitcnt.ws1_s;
+  bus.io.waitcnt.ws2_n = mmio.waitcnt.ws2_n;
+  bus.io.waitcnt.ws2_s = mmio.waitcnt.ws2_s;
+  bus.io.waitcnt.phi = mmio.waitcnt.phi;
+  bus.io.waitcnt.prefetch = mmio.waitcnt.prefetch;
+  bus.io.waitcnt.cgb = mmio.waitcnt.cgb;
+  bus.io.keycnt.input_mask = mmio.keycnt.input_mask;
+  bus.io.keycnt.interrupt = mmio.keycnt.interrupt;
+  bus.io.keycnt.and_mode = mmio.keycnt.and_mode;
+
+  bus.prefetch.active = prefetch.active;
+  bus.prefetch.rom_code_access = prefetch.rom_code_access;
+  bus.prefetch.head_address = prefetch.head_address;
+  bus.prefetch.last_address = prefetch.last_address;
+  bus.prefetch.count = prefetch.count;
+  bus.prefetch.capacity = prefetch.capacity;
+  bus.prefetch.opcode_width = prefetch.opcode_width;
+  bus.prefetch.countdown = prefetch.countdown;
+  bus.prefetch.duty = prefetch.duty;
+
+  bus.openbus_from_dma = openbus_from_dma;
+
+  auto soundinfo = reinterpret_cast<u8*>(m4a_soundinfo);
+  if (soundinfo == nullptr) {
+    bus.m4a.soundinfo_address = 0;
+  } else if (soundinfo >= memory.iram) {
+    bus.m4a.soundinfo_address = 0x03000000 | u32(soundinfo - memory.iram);
+  } else {
+    bus.m4a.soundinfo_address = 0x02000000 | u32(soundinfo - memory.wram);
+  }
+  bus.m4a.original_freq = m4a_original_freq;
+
+  irq.CopyState(save_state);
+  dma.CopyState(save_state);
+  timer.CopyState(save_state);
+  apu.CopyState(save_state);
+  ppu.CopyState(save_state);
+  serial_bus.CopyState(save_state);
+  game_pak.CopyState(save_state);
+}
+
+} // namespace nba::core
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+
+namespace nba::core {
+
+/**
+ * Counts the work done by the emulator. Unlike the profilers, these counters
+ * are cheap enough to always be collected, e.g. to monitor many emulators at once.
+ *
+ * The counters are not part of the machine state, so they keep counting
+ * across loading save states, rewinding and run-ahead.
+ */
+struct Stats {
+  /// Upper bound of Scheduler::EventClass::Count.
+  static constexpr int kMaxEventClasses = 32;
+
+  /// Calls of Emulator::Frame().
+  u64 frames = 0;
+
+  /// Includes instructions that were skipped because their condition failed.
+  u64 arm_instructions = 0;
+  u64 thumb_instructions = 0;
+
+  /// Dispatched events, indexed by Scheduler::EventClass.
+  u64 events[kMaxEventClasses] {};
+
+  u64 scanlines_rendered = 0;
+
+  /// Scanlines of frames that were not presented, e.g. frames emulated for run-ahead.
+  u64 scanlines_skipped = 0;
+
+  /// Samples at the sample rate of the audio device, including dropped samples.
+  u64 audio_samples = 0;
+
+  /// Samples that did not fit into the audio buffer, because the audio device consumed too few.
+  u64 audio_samples_dropped = 0;
+
+  /// Audio device callbacks that found fewer samples in the audio buffer than requested.
+  u64 audio_underruns = 0;
+
+  /// Halfwords and words transferred by DMA.
+  u64 dma_units = 0;
+
+  /// Host time spent in Emulator::Frame(), in nanoseconds.
+  u64 frame_time_last = 0;
+  u64 frame_time_max = 0;
+  u64 frame_time_total = 0;
+};
+
+} // namespace nba::core
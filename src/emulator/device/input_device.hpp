@@ -31,6 +31,9 @@ struct InputDevice {
   
   virtual auto Poll(Key key) -> bool = 0;
   virtual void SetOnChangeCallback(std::function<void(void)> callback) = 0;
+
+  /// The emulator that registered the current callback, only it may clear the callback again.
+  void const* callback_owner = nullptr;
 };
 
 struct NullInputDevice : InputDevice {
@@ -44,7 +47,9 @@ struct NullInputDevice : InputDevice {
 struct BasicInputDevice : InputDevice {
   void SetKeyStatus(Key key, bool pressed) {
     key_status[static_cast<int>(key)] = pressed;
-    keypress_callback();
+    if (keypress_callback) {
+      keypress_callback();
+    }
   }
 
   auto Poll(Key key) -> bool final {
@@ -56,7 +61,7 @@ struct BasicInputDevice : InputDevice {
   }
 private:
   std::function<void(void)> keypress_callback;
-  bool key_status[kKeyCount];
+  bool key_status[kKeyCount] {};
 };
 
 } // namespace nba
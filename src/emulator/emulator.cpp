@@ -12,13 +12,17 @@
 #include <emulator/cartridge/backup/sram.hpp>
 #include <emulator/cartridge/gpio/rtc.hpp>
 #include <emulator/cartridge/game_pak.hpp>
+#include <emulator/cartridge/rom_analysis_cache.hpp>
 #include <common/log.hpp>
+#include <common/trace.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <ctime>
 #include <exception>
 #include <filesystem>
 #include <fstream>
 #include <utility>
-#include <string_view>
 
 #include "emulator.hpp"
 
@@ -31,8 +35,10 @@ using namespace nba::core;
 using BackupType = Config::BackupType;
 
 constexpr int g_cycles_per_frame = 280896;
+constexpr u64 g_cycles_per_second = 16777216;
 constexpr int g_bios_size = 0x4000;
 constexpr int g_max_rom_size = 33554432; // 32 MiB
+constexpr int g_backup_commit_interval = g_cycles_per_frame * 15;
 
 Emulator::Emulator(std::shared_ptr<Config> config)
   : cpu(config)
@@ -41,42 +47,81 @@ Emulator::Emulator(std::shared_ptr<Config> config)
   Reset();
 }
 
-void Emulator::Reset() { cpu.Reset(); }
-
-auto Emulator::DetectBackupType(u8* rom, size_t size) -> BackupType {
-  static constexpr std::pair<std::string_view, Config::BackupType> signatures[6] {
-    { "EEPROM_V",   BackupType::EEPROM_64 },
-    { "SRAM_V",     BackupType::SRAM      },
-    { "SRAM_F_V",   BackupType::SRAM      },
-    { "FLASH_V",    BackupType::FLASH_64  },
-    { "FLASH512_V", BackupType::FLASH_64  },
-    { "FLASH1M_V",  BackupType::FLASH_128 }
-  };
-
-  for (int i = 0; i < size; i += 4) {
-    for (auto const& [signature, type] : signatures) {
-      if ((i + signature.size()) <= size && std::memcmp(&rom[i], signature.data(), signature.size()) == 0) {
-        LOG_INFO("Found ROM string indicating {0} backup type.", std::to_string(type));
-        return type;
-      }
+void Emulator::Reset() {
+  StopMovie();
+  cpu.Reset();
+  backup_commit_countdown = g_backup_commit_interval;
+
+  // Continue the previous session when the game has just been loaded.
+  if (resume_pending) {
+    resume_pending = false;
+    Resume();
+  }
+
+  // The configuration may have changed since the emulator was created.
+  if (config->rewind.enable) {
+    rewind = std::make_unique<RewindBuffer>(size_t(config->rewind.max_memory) << 20);
+    rewind_state = std::make_unique<SaveState>();
+    rewind_countdown = g_cycles_per_frame * config->rewind.interval;
+  } else {
+    rewind.reset();
+    rewind_state.reset();
+  }
+}
+
+auto Emulator::DetectGameInfo(ROM const& rom, std::string const& game_code, RomAnalysis& analysis) -> GameInfo {
+  auto game_info = GameInfo{};
+  auto hash = rom.Hash();
+  auto cached = false;
+
+  LOG_INFO("ROM hash: {0:016X}", hash);
+
+  /* Reuse the analysis from a previous run of the same ROM, if possible. */
+  if (!config->analysis_cache_path.empty()) {
+    if (auto match = RomAnalysisCache{config->analysis_cache_path}.Find(hash)) {
+      LOG_INFO("Using cached ROM analysis results.");
+      analysis = std::move(match.value());
+      cached = true;
     }
   }
 
-  return Config::BackupType::Detect;
+  if (!cached) {
+    analysis = RomAnalysis::Analyze(rom.Data(), rom.Size());
+
+    if (!config->analysis_cache_path.empty()) {
+      RomAnalysisCache{config->analysis_cache_path}.Insert(hash, analysis);
+    }
+  }
+
+  /* Try to match gamecode with game database. */
+  if (auto match = g_game_db.find(game_code); match != g_game_db.end()) {
+    LOG_INFO("Successfully matched ROM to game database entry.");
+    game_info = match->second;
+  }
+
+  /* If not database entry was found or the entry has no backup type information,
+   * use the backup type indicated by strings found in the ROM.
+   */
+  if (game_info.backup_type == Config::BackupType::Detect) {
+    LOG_INFO("Unable to get backup type from game database.");
+    game_info.backup_type = analysis.backup_type;
+  }
+
+  return game_info;
 }
 
-auto Emulator::CreateBackupInstance(Config::BackupType backup_type, std::string save_path) -> Backup* {
+auto Emulator::CreateBackupInstance(Config::BackupType backup_type, std::string save_path, BackupFile::Mode mode) -> Backup* {
   switch (backup_type) {
     case BackupType::SRAM:
-      return new SRAM(save_path);
+      return new SRAM(save_path, mode);
     case BackupType::FLASH_64:
-      return new FLASH(save_path, FLASH::SIZE_64K);
+      return new FLASH(save_path, FLASH::SIZE_64K, mode);
     case BackupType::FLASH_128:
-      return new FLASH(save_path, FLASH::SIZE_128K);
+      return new FLASH(save_path, FLASH::SIZE_128K, mode);
     case BackupType::EEPROM_4:
-      return new EEPROM(save_path, EEPROM::SIZE_4K);
+      return new EEPROM(save_path, EEPROM::SIZE_4K, mode);
     case BackupType::EEPROM_64:
-      return new EEPROM(save_path, EEPROM::SIZE_64K);
+      return new EEPROM(save_path, EEPROM::SIZE_64K, mode);
     default:
       throw nullptr;
   }
@@ -128,7 +173,13 @@ auto Emulator::LoadGame(std::string const& path) -> StatusCode {
   std::string game_title;
   std::string game_code;
   std::string game_maker;
-  std::string save_path = path.substr(0, path.find_last_of(".")) + ".sav";
+  std::string base_path = path.substr(0, path.find_last_of("."));
+
+  if (!config->save_folder.empty()) {
+    base_path = (fs::path{config->save_folder} / fs::path{path}.stem()).string();
+  }
+
+  std::string save_path = base_path + ".sav";
 
   /* If the BIOS was not loaded yet, load it now. */
   if (!bios_loaded) {
@@ -152,48 +203,38 @@ auto Emulator::LoadGame(std::string const& path) -> StatusCode {
     return StatusCode::GameWrongSize;
   }
 
-  std::ifstream stream { path, std::ios::binary };
+  /* The ROM image is memory-mapped and shared with any
+   * other emulator instance that runs the same file.
+   */
+  auto rom = ROM::Open(path);
 
   /* TODO: most likely this error would only happen
    * if the file cannot be opened due to missing privileges.
    * The status code "Game not found" is not accurate, really.
    */
-  if (!stream.good()) {
+  if (!rom) {
     LOG_ERROR("Failed to open ROM with unknown error.");
     return StatusCode::GameNotFound;
   }
 
-  auto rom = std::vector<u8>{};
-  rom.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
-  stream.close();
-
-  auto header = reinterpret_cast<Header*>(rom.data());
+  auto header = reinterpret_cast<Header const*>(rom->Data());
   game_title.assign(header->game.title, 12);
   game_code.assign(header->game.code, 4);
   game_maker.assign(header->game.maker, 2);
 
-  /* If no save type was specified try to determine it from a list of
-   * game override. Alternatively if that doesn't work, look for some
-   * Nintendo SDK strings, that can reveal the save type.
+  auto analysis = RomAnalysis{};
+  auto detected = DetectGameInfo(*rom, game_code, analysis);
+
+  /* If no save type was specified use the detected save type,
+   * which comes either from the game database or from Nintendo SDK
+   * strings in the ROM, that can reveal the save type.
    */
   if (config->backup_type == Config::BackupType::Detect) {
-    /* Try to match gamecode with game database. */
-    if (auto match = g_game_db.find(game_code); match != g_game_db.end()) {
-      LOG_INFO("Successfully matched ROM to game database entry.");
-      game_info = match->second;
-    }
+    game_info = detected;
 
-    /* If not database entry was found or the entry has no backup type information,
-     * try to search the ROM for strings that can indicate the
-     * backup type used by this game.
-     */
     if (game_info.backup_type == Config::BackupType::Detect) {
-      LOG_INFO("Unable to get backup type from game database.");
-      game_info.backup_type = DetectBackupType(rom.data(), size);
-      if (game_info.backup_type == Config::BackupType::Detect) {
-        game_info.backup_type = Config::BackupType::SRAM;
-        LOG_WARN("Failed to determine backup type, fallback to SRAM.");
-      }
+      game_info.backup_type = Config::BackupType::SRAM;
+      LOG_WARN("Failed to determine backup type, fallback to SRAM.");
     }
   } else {
     game_info.backup_type = config->backup_type;
@@ -207,11 +248,17 @@ auto Emulator::LoadGame(std::string const& path) -> StatusCode {
   LOG_INFO("Mirror: {0}", game_info.mirror);
 
   // TODO: CreateBackupInstance should return a unique_ptr directly.
-  auto backup = std::unique_ptr<Backup>{CreateBackupInstance(game_info.backup_type, save_path)};
+  auto backup_mode = BackupFile::Mode::Direct;
+  if (config->memory_save) {
+    backup_mode = BackupFile::Mode::Memory;
+  } else if (config->atomic_save) {
+    backup_mode = BackupFile::Mode::Atomic;
+  }
+  auto backup = std::unique_ptr<Backup>{CreateBackupInstance(game_info.backup_type, save_path, backup_mode)};
   auto gpio = std::unique_ptr<GPIO>{};
 
   if (game_info.gpio == GPIODeviceType::RTC || config->force_rtc) {
-    gpio = std::make_unique<RTC>(&cpu.scheduler, &cpu.irq);
+    gpio = std::make_unique<RTC>(&cpu.scheduler, &cpu.irq, config->rtc_base_time);
   }
 
   u32 mask = 0x01FF'FFFF;
@@ -219,17 +266,326 @@ auto Emulator::LoadGame(std::string const& path) -> StatusCode {
     mask = CalculateMirrorMask(size);
   }
 
-  cpu.game_pak = GamePak{std::move(rom), std::move(backup), std::move(gpio), mask};
+  cpu.game_pak = GamePak{std::move(rom), std::move(analysis), std::move(backup), std::move(gpio), mask};
+
+  session_path = base_path + ".state";
+  resume_pending = config->suspend_resume;
 
   return StatusCode::Ok;
 }
 
 void Emulator::Run(int cycles) {
+  common::trace::Scope trace{"emulator", "run", cpu.scheduler};
   cpu.RunFor(cycles);
+  CommitBackup(cycles);
+  UpdateRewind(cycles);
+  UpdateMovie();
+  PublishStats();
 }
 
 void Emulator::Frame() {
+  common::trace::Scope trace{"emulator", "frame", cpu.scheduler};
+
+  auto t0 = std::chrono::steady_clock::now();
+
+  if (config->run_ahead > 0) {
+    RunAhead(config->run_ahead);
+  } else {
+    cpu.RunFor(g_cycles_per_frame);
+    CommitBackup(g_cycles_per_frame);
+    UpdateRewind(g_cycles_per_frame);
+  }
+
+  UpdateMovie();
+
+  auto& stats = cpu.scheduler.stats;
+  auto nanoseconds = u64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+
+  stats.frames++;
+  stats.frame_time_last = nanoseconds;
+  stats.frame_time_max = std::max(stats.frame_time_max, nanoseconds);
+  stats.frame_time_total += nanoseconds;
+
+  PublishStats();
+}
+
+void Emulator::RunAhead(int frames) {
+  if (!run_ahead_state) {
+    run_ahead_state = std::make_unique<SaveState>();
+  }
+
+  // Emulate the actual frame, but only keep its audio.
+  cpu.ppu.output_enabled = false;
   cpu.RunFor(g_cycles_per_frame);
+  CommitBackup(g_cycles_per_frame);
+  UpdateRewind(g_cycles_per_frame);
+
+  CopyState(*run_ahead_state);
+
+  /* Emulate the following frames with the current input,
+   * present the last one and then return to the actual frame.
+   */
+  cpu.apu.output_enabled = false;
+  cpu.input_enabled = false;
+  cpu.game_pak.SetBackupSpeculative(true);
+  for (int i = 0; i < frames; i++) {
+    cpu.ppu.output_enabled = i == frames - 1;
+    cpu.RunFor(g_cycles_per_frame);
+  }
+  cpu.apu.output_enabled = true;
+  cpu.input_enabled = true;
+
+  cpu.LoadState(*run_ahead_state);
+  cpu.game_pak.SetBackupSpeculative(false);
+}
+
+void Emulator::QueueInput(u16 keyinput, u64 timestamp) {
+  cpu.input_queue.Push({timestamp, keyinput});
+}
+
+void Emulator::RecordMovie(Movie& movie, Movie::Start start) {
+  if (start == Movie::Start::PowerOn) {
+    resume_pending = false;
+    Reset();
+  } else {
+    StopMovie();
+  }
+
+  auto now = cpu.scheduler.GetTimestampNow();
+
+  // Pin the clock to the time it shows now, unless the config already pins it.
+  auto rtc_base_time = config->rtc_base_time;
+  if (rtc_base_time < 0) {
+    rtc_base_time = s64(std::time(nullptr)) - s64(now / g_cycles_per_second);
+  }
+  cpu.game_pak.SetClockBaseTime(rtc_base_time);
+
+  movie.rom_hash = cpu.game_pak.GetRawROM().Hash();
+  movie.start = start;
+  movie.start_timestamp = now;
+  movie.end_timestamp = now;
+  movie.rtc_base_time = rtc_base_time;
+  movie.entries.clear();
+
+  // Also taken at power-on, since it holds the save data that the game boots with.
+  movie.snapshot = std::make_unique<SaveState>();
+  CopyState(*movie.snapshot);
+
+  recording_movie = &movie;
+  cpu.SetMovieRecording(&movie.entries);
+}
+
+auto Emulator::PlayMovie(Movie const& movie) -> StatusCode {
+  if (movie.rom_hash != cpu.game_pak.GetRawROM().Hash()) {
+    LOG_ERROR("Movie was recorded with a different game.");
+    return StatusCode::StateWrongGame;
+  }
+
+  StopMovie();
+
+  // The save data comes from the start state, the save file must not be touched.
+  cpu.game_pak.SetBackupInMemory(true);
+
+  if (movie.start == Movie::Start::PowerOn) {
+    resume_pending = false;
+    Reset();
+  }
+
+  auto status = LoadState(*movie.snapshot);
+  if (status != StatusCode::Ok) {
+    cpu.game_pak.SetBackupInMemory(false);
+    return status;
+  }
+
+  cpu.game_pak.SetClockBaseTime(movie.rtc_base_time);
+
+  playback_movie = &movie;
+  cpu.SetMoviePlayback(&movie.entries);
+  return StatusCode::Ok;
+}
+
+void Emulator::StopMovie() {
+  if (recording_movie) {
+    recording_movie->end_timestamp = cpu.scheduler.GetTimestampNow();
+    recording_movie = nullptr;
+    cpu.SetMovieRecording(nullptr);
+    cpu.game_pak.SetClockBaseTime(config->rtc_base_time);
+  }
+
+  if (playback_movie) {
+    playback_movie = nullptr;
+    cpu.SetMoviePlayback(nullptr);
+    cpu.game_pak.SetBackupInMemory(false);
+    cpu.game_pak.SetClockBaseTime(config->rtc_base_time);
+  }
+}
+
+void Emulator::UpdateMovie() {
+  if (playback_movie && cpu.scheduler.GetTimestampNow() >= playback_movie->end_timestamp) {
+    StopMovie();
+  }
+}
+
+void Emulator::CopyState(SaveState& state) {
+  state.magic = SaveState::kMagicNumber;
+  state.version = SaveState::kCurrentVersion;
+  state.rom_hash = cpu.game_pak.GetRawROM().Hash();
+  cpu.CopyState(state);
+}
+
+auto Emulator::LoadState(SaveState const& state) -> StatusCode {
+  if (state.magic != SaveState::kMagicNumber) {
+    LOG_ERROR("Save state has an unknown format.");
+    return StatusCode::StateWrongFormat;
+  }
+
+  if (state.version != SaveState::kCurrentVersion) {
+    LOG_ERROR("Save state has version {0}, but only version {1} is supported.", state.version, SaveState::kCurrentVersion);
+    return StatusCode::StateWrongVersion;
+  }
+
+  if (state.rom_hash != cpu.game_pak.GetRawROM().Hash()) {
+    LOG_ERROR("Save state was created with a different game.");
+    return StatusCode::StateWrongGame;
+  }
+
+  /* Reject corrupted event queues,
+   * since those would crash the scheduler much later.
+   */
+  auto& scheduler = state.scheduler;
+  if (scheduler.event_count <= 0 || scheduler.event_count > SaveState::Scheduler::kMaxEvents) {
+    LOG_ERROR("Save state has an invalid number of scheduled events.");
+    return StatusCode::StateWrongFormat;
+  }
+  for (int i = 0; i < scheduler.event_count; i++) {
+    if (scheduler.events[i].event_class >= u16(Scheduler::EventClass::Count)) {
+      LOG_ERROR("Save state has an event of unknown class {0}.", scheduler.events[i].event_class);
+      return StatusCode::StateWrongFormat;
+    }
+  }
+
+  // The state is unrelated to the movie, unless PlayMovie() is loading it.
+  StopMovie();
+  cpu.LoadState(state);
+  return StatusCode::Ok;
+}
+
+auto Emulator::Clone(std::shared_ptr<Config> config) -> std::unique_ptr<Emulator> {
+  if (!config) {
+    config = std::make_shared<Config>(*this->config);
+    config->audio_dev = std::make_shared<NullAudioDevice>();
+    config->input_dev = std::make_shared<NullInputDevice>();
+    config->video_dev = std::make_shared<NullVideoDevice>();
+    config->rewind.enable = false;
+    config->run_ahead = 0;
+  }
+
+  auto clone = std::make_unique<Emulator>(config);
+
+  // Per thread, so that several threads may clone the same emulator at once.
+  thread_local auto clone_state = std::make_unique<SaveState>();
+
+  std::memcpy(clone->cpu.memory.bios, cpu.memory.bios, g_bios_size);
+  clone->bios_loaded = bios_loaded;
+  clone->cpu.game_pak = cpu.game_pak.Clone(&clone->cpu.scheduler, &clone->cpu.irq);
+
+  /* The whole machine state is transferred as one flat block,
+   * which also rebinds all pointers to the clone's own memory.
+   */
+  CopyState(*clone_state);
+  clone->cpu.LoadState(*clone_state);
+  clone->backup_commit_countdown = backup_commit_countdown;
+  return clone;
+}
+
+bool Emulator::ReadRAM(u32 address, size_t length, u8* buffer) const {
+  u8 const* memory;
+  size_t size;
+  size_t offset = address & 0x00FF'FFFF;
+
+  switch (address >> 24) {
+    case 0x02:
+      memory = cpu.memory.wram;
+      size = sizeof(cpu.memory.wram);
+      break;
+    case 0x03:
+      memory = cpu.memory.iram;
+      size = sizeof(cpu.memory.iram);
+      break;
+    default:
+      return false;
+  }
+
+  if (offset + length > size) {
+    return false;
+  }
+
+  std::memcpy(buffer, memory + offset, length);
+  return true;
+}
+
+auto Emulator::GetStats() const -> core::Stats {
+  std::lock_guard guard{published_stats_lock};
+  auto stats = published_stats;
+  stats.audio_underruns = cpu.apu.underruns.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void Emulator::ResetStats() {
+  cpu.scheduler.stats = {};
+  cpu.apu.underruns = 0;
+  PublishStats();
+}
+
+void Emulator::PublishStats() {
+  // The counters are updated by the emulation thread without synchronization.
+  std::lock_guard guard{published_stats_lock};
+  published_stats = cpu.scheduler.stats;
+}
+
+void Emulator::WriteGuestProfile(std::ostream& report, std::ostream& coverage) const {
+  cpu.guest_profiler.WriteReport(report, cpu);
+  cpu.guest_profiler.WriteCoverage(coverage, cpu);
+}
+
+void Emulator::CommitBackup(int cycles) {
+  /* Only give the backup a chance to persist its data every few frames.
+   * Together with BackupFile postponing the commit while the game still writes,
+   * this batches a whole save sequence into a single file update.
+   */
+  backup_commit_countdown -= cycles;
+  if (backup_commit_countdown <= 0) {
+    backup_commit_countdown += g_backup_commit_interval;
+    cpu.game_pak.CommitBackup();
+  }
+}
+
+void Emulator::UpdateRewind(int cycles) {
+  if (!rewind) {
+    return;
+  }
+
+  rewind_countdown -= cycles;
+  if (rewind_countdown <= 0) {
+    rewind_countdown += g_cycles_per_frame * config->rewind.interval;
+    CopyState(rewind->Next());
+    rewind->Push();
+  }
+}
+
+bool Emulator::StepBack() {
+  if (!rewind || !rewind->Pop(*rewind_state)) {
+    return false;
+  }
+
+  LoadState(*rewind_state);
+
+  /* Frontends emulate a frame after each step back to present it.
+   * That frame must not push a snapshot, or rewinding with an interval of one
+   * would swap between two states instead of going further back.
+   */
+  rewind_countdown = g_cycles_per_frame * (config->rewind.interval + 1);
+  return true;
 }
 
 } // namespace nba
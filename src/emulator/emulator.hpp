@@ -7,8 +7,15 @@
 
 #pragma once
 
+#include <emulator/cartridge/game_db.hpp>
+#include <emulator/cartridge/rom_analysis_cache.hpp>
 #include <emulator/core/cpu.hpp>
+#include <emulator/movie.hpp>
+#include <emulator/rewind.hpp>
+#include <emulator/save_state.hpp>
 #include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
 
 namespace nba {
@@ -19,6 +26,9 @@ struct Emulator {
     GameNotFound,
     BiosWrongSize,
     GameWrongSize,
+    StateWrongFormat,
+    StateWrongVersion,
+    StateWrongGame,
     Ok
   };
   
@@ -28,16 +38,131 @@ struct Emulator {
   auto LoadGame(std::string const& path) -> StatusCode;
   void Run(int cycles);
   void Frame();
+
+  /**
+   * Queues a KEYINPUT value (active low) that takes effect at the given number of
+   * emulated cycles since reset, or as soon as possible with core::InputQueue::kNow.
+   * Safe to call while the emulator runs on another thread, but only from one thread,
+   * which must also be the one that changes the input device.
+   */
+  void QueueInput(u16 keyinput, u64 timestamp = core::InputQueue::kNow);
+
+  /// Emulated cycles since reset. Must be called from the emulation thread.
+  auto GetTimestamp() const -> u64 { return cpu.scheduler.GetTimestampNow(); }
+
+  /**
+   * Starts to record every key state that takes effect into the movie, which must outlive
+   * the recording. The movie starts from a reset or from a snapshot of the current state.
+   * The cartridge clock is pinned while recording, see Config::rtc_base_time.
+   */
+  void RecordMovie(Movie& movie, Movie::Start start);
+
+  /**
+   * Restores the start state of the movie and replaces the input with its key states,
+   * until the end of the movie is reached. The movie must outlive the playback.
+   * During playback the save data is kept in memory and the save file is left alone.
+   * Afterwards the game continues with the save file as it was before the movie.
+   */
+  auto PlayMovie(Movie const& movie) -> StatusCode;
+
+  /// Ends the recording or playback. Reset() and LoadState() do so too.
+  void StopMovie();
+
+  bool IsPlayingMovie() const { return playback_movie != nullptr; }
+
+  /**
+   * Copies the complete state of the emulated machine into a save state.
+   * The state can be restored by LoadState() for as long as the same game is loaded.
+   */
+  void CopyState(SaveState& state);
+  auto LoadState(SaveState const& state) -> StatusCode;
+
+  /**
+   * Returns to the most recent snapshot in the rewind history and removes it,
+   * so that repeated calls go further back in time.
+   * The frame that is emulated next to present the state does not add a snapshot.
+   * Returns false if rewinding is disabled or the history is empty.
+   */
+  bool StepBack();
+
+  /**
+   * Creates an independent emulator that continues from the current state of this one.
+   * The clone shares the ROM image, but its backup memory is never written to disk.
+   * Without a config, the clone is given a copy of this emulator's config,
+   * with null devices and without rewind or run-ahead.
+   * Several threads may clone the same emulator at once,
+   * but not while this emulator is running on another thread.
+   */
+  auto Clone(std::shared_ptr<Config> config = nullptr) -> std::unique_ptr<Emulator>;
+
+  /**
+   * Copies from EWRAM (0x02000000) or IWRAM (0x03000000) without going through the bus.
+   * Returns false if the range is not fully contained in one of the two.
+   */
+  bool ReadRAM(u32 address, size_t length, u8* buffer) const;
+
+  /// Host time spent in each subsystem, if the core is built with NBA_PROFILE.
+  auto GetProfiler() -> core::Profiler& { return cpu.scheduler.profiler; }
+
+  /// Bus accesses, wait states, prefetch and DMA cycles, if the core is built with NBA_BUS_STATS.
+  auto GetBusStats() -> core::BusStats& { return cpu.scheduler.bus_stats; }
+
+  /// Instructions and cycles per guest address, if the core is built with NBA_GUEST_PROFILE.
+  auto GetGuestProfiler() -> core::GuestProfiler& { return cpu.guest_profiler; }
+
+  /**
+   * Counters of the work done since the emulator was created or ResetStats() was called,
+   * which are always available, unlike the profilers above.
+   * Returns the snapshot taken at the end of the last Run() or Frame(),
+   * so it may be called from any thread, e.g. by an on-screen display.
+   */
+  auto GetStats() const -> core::Stats;
+
+  /// Must be called from the emulation thread.
+  void ResetStats();
+
+  /**
+   * Writes the hottest guest code with its disassembly to one stream
+   * and the ROM code coverage bitmap to the other.
+   */
+  void WriteGuestProfile(std::ostream& report, std::ostream& coverage) const;
+
+  /**
+   * Writes the machine state to a file next to the save file,
+   * from which the next Reset() after loading the game resumes,
+   * if suspend/resume is enabled in the config.
+   */
+  bool Suspend();
   
 private:
-  static auto DetectBackupType(u8* rom, size_t size) -> Config::BackupType;
-  static auto CreateBackupInstance(Config::BackupType backup_type, std::string save_path) -> Backup*;
+  friend struct LinkHub;
+  friend struct Lockstep;
+
+  static auto CreateBackupInstance(Config::BackupType backup_type, std::string save_path, BackupFile::Mode mode) -> Backup*;
   static auto CalculateMirrorMask(size_t size) -> u32;
   
   auto LoadBIOS() -> StatusCode; 
+  auto DetectGameInfo(ROM const& rom, std::string const& game_code, RomAnalysis& analysis) -> GameInfo;
+  void CommitBackup(int cycles);
+  void UpdateRewind(int cycles);
+  void RunAhead(int frames);
+  void UpdateMovie();
+  void PublishStats();
+  bool Resume();
   
   core::CPU cpu;
   bool bios_loaded = false;
+  std::string session_path;
+  bool resume_pending = false;
+  int backup_commit_countdown;
+  std::unique_ptr<RewindBuffer> rewind;
+  std::unique_ptr<SaveState> rewind_state;
+  int rewind_countdown;
+  std::unique_ptr<SaveState> run_ahead_state;
+  Movie* recording_movie = nullptr;
+  Movie const* playback_movie = nullptr;
+  mutable std::mutex published_stats_lock;
+  core::Stats published_stats;
   std::shared_ptr<Config> config;
 };
 
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include "link_hub.hpp"
+
+namespace nba {
+
+using Mode = core::SerialBus::Mode;
+
+static constexpr int kCyclesPerFrame = 280896;
+static constexpr int kSpinCount = 1000;
+
+LinkHub::LinkHub(int quantum) : quantum(std::max(quantum, 1)) {
+}
+
+LinkHub::~LinkHub() {
+  if (!workers.empty()) {
+    stopping = true;
+    WaitForQuantum();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  for (auto& port : ports) {
+    GetSerialBus(*port).Connect(nullptr);
+  }
+}
+
+bool LinkHub::Connect(Emulator& emulator) {
+  // The barrier counts on the number of ports, which must not change once the workers are running.
+  if (ports.size() == kMaxPlayers || !workers.empty()) {
+    return false;
+  }
+
+  auto port = std::make_unique<Port>();
+  port->hub = this;
+  port->emulator = &emulator;
+  port->id = int(ports.size());
+  GetSerialBus(*port).Connect(port.get());
+  ports.push_back(std::move(port));
+  return true;
+}
+
+void LinkHub::Port::Send(Message const& message) {
+  outbox.push_back(message);
+}
+
+void LinkHub::Run(int cycles) {
+  if (ports.empty() || cycles <= 0) {
+    return;
+  }
+
+  if (workers.empty()) {
+    StartWorkers();
+  }
+
+  /* The first emulator runs on the calling thread. The barrier at the end of the
+   * last quantum guarantees that the workers are done when RunPort() returns.
+   */
+  run_cycles = cycles;
+  WaitForQuantum();
+  RunPort(*ports[0], cycles);
+}
+
+void LinkHub::Frame() {
+  Run(kCyclesPerFrame);
+}
+
+void LinkHub::StartWorkers() {
+  for (size_t i = 1; i < ports.size(); i++) {
+    workers.emplace_back([this, i] {
+      RunWorker(*ports[i]);
+    });
+  }
+}
+
+void LinkHub::RunWorker(Port& port) {
+  while (true) {
+    WaitForQuantum();
+    if (stopping) {
+      return;
+    }
+    RunPort(port, run_cycles);
+  }
+}
+
+void LinkHub::RunPort(Port& port, int cycles) {
+  auto& scheduler = port.emulator->cpu.scheduler;
+  auto target = scheduler.GetTimestampNow();
+
+  // Every thread goes through the same quanta, so all of them arrive at each barrier.
+  while (cycles > 0) {
+    auto length = std::min(cycles, quantum);
+    target += length;
+    cycles -= length;
+
+    // An emulator may run past the end of a quantum (e.g. during a long DMA), which is made up for in the next one.
+    auto remaining = s64(target - scheduler.GetTimestampNow());
+    if (remaining > 0) {
+      port.emulator->Run(int(remaining));
+    }
+
+    WaitForQuantum();
+  }
+}
+
+/**
+ * Barrier at the end of each quantum: the last thread to arrive exchanges the messages,
+ * while the others wait until it is done.
+ * Waiting threads spin for a short while first, which is enough if every emulator has a core of its own.
+ */
+void LinkHub::WaitForQuantum() {
+  auto current = generation.load(std::memory_order_acquire);
+
+  if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == int(ports.size())) {
+    Exchange();
+    arrived.store(0, std::memory_order_relaxed);
+    {
+      std::lock_guard guard{sleep_lock};
+      generation.store(current + 1, std::memory_order_release);
+    }
+    wakeup.notify_all();
+    return;
+  }
+
+  for (int i = 0; i < kSpinCount; i++) {
+    if (generation.load(std::memory_order_acquire) != current) {
+      return;
+    }
+  }
+
+  std::unique_lock lock{sleep_lock};
+  wakeup.wait(lock, [&] {
+    return generation.load(std::memory_order_acquire) != current;
+  });
+}
+
+void LinkHub::Exchange() {
+  for (auto& port : ports) {
+    auto now = port->emulator->cpu.scheduler.GetTimestampNow();
+
+    for (auto& message : port->outbox) {
+      // The part of the transfer that has not elapsed yet on the clock of the sender.
+      auto delay = int(std::max<s64>(0, s64(message.timestamp + message.cycles) - s64(now)));
+
+      switch (message.mode) {
+        case Mode::Normal:    ExchangeNormal(*port, message, delay); break;
+        case Mode::Multiplay: ExchangeMultiplay(message, delay); break;
+        case Mode::UART:      ExchangeUART(*port, message, delay); break;
+        default: break;
+      }
+    }
+
+    port->outbox.clear();
+  }
+}
+
+void LinkHub::ExchangeNormal(Port& sender, Link::Message const& message, int delay) {
+  auto received = u32(0xFFFF'FFFF);
+
+  // The master exchanges data with the first other port in Normal mode, preferably one that waits for a transfer.
+  Port* partner = nullptr;
+
+  for (auto& port : ports) {
+    auto& serial_bus = GetSerialBus(*port);
+    if (port.get() == &sender || serial_bus.GetMode() != Mode::Normal) {
+      continue;
+    }
+    if (!partner || serial_bus.IsWaitingForClock()) {
+      partner = port.get();
+    }
+    if (serial_bus.IsWaitingForClock()) {
+      break;
+    }
+  }
+
+  if (partner) {
+    auto& serial_bus = GetSerialBus(*partner);
+    received = serial_bus.GetSendData();
+    if (message.bits == 8) {
+      received |= 0xFFFF'FF00;
+    }
+    if (serial_bus.IsWaitingForClock()) {
+      serial_bus.Transfer(delay, message.data);
+    }
+  }
+
+  GetSerialBus(sender).Transfer(delay, received);
+}
+
+void LinkHub::ExchangeMultiplay(Link::Message const& message, int delay) {
+  // Players that are not connected or not in Multiplay mode send 0xFFFF.
+  auto data = ~u64(0);
+
+  for (auto& port : ports) {
+    auto& serial_bus = GetSerialBus(*port);
+    if (serial_bus.GetMode() != Mode::Multiplay) {
+      continue;
+    }
+
+    auto value = port->id == 0 ? message.data : serial_bus.GetSendData();
+    auto shift = port->id * 16;
+    data = (data & ~(u64(0xFFFF) << shift)) | (u64(value & 0xFFFF) << shift);
+  }
+
+  for (auto& port : ports) {
+    auto& serial_bus = GetSerialBus(*port);
+    if (serial_bus.GetMode() == Mode::Multiplay) {
+      serial_bus.Transfer(delay, data);
+    }
+  }
+}
+
+void LinkHub::ExchangeUART(Port& sender, Link::Message const& message, int delay) {
+  // UART connects two emulators: 0 with 1 and 2 with 3.
+  auto id = sender.id ^ 1;
+
+  if (id < GetPlayerCount()) {
+    auto& serial_bus = GetSerialBus(*ports[id]);
+    if (serial_bus.GetMode() == Mode::UART) {
+      serial_bus.Receive(delay, u8(message.data));
+    }
+  }
+}
+
+} // namespace nba
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <common/integer.hpp>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "emulator.hpp"
+
+namespace nba {
+
+/**
+ * Connects the serial ports of two to four emulators with a link cable
+ * and runs each emulator on a thread of its own: the first one on the thread that calls Run(),
+ * the others on threads that are started by the first Run() and kept until the hub is destroyed.
+ *
+ * The emulators run in quanta of emulated cycles and wait for each other at the end of each quantum.
+ * Only then are the transfers that were started during the quantum delivered,
+ * so that a transfer may complete up to one quantum late.
+ * Smaller quanta are more accurate, larger quanta keep the threads waiting less often.
+ *
+ * The emulators must outlive the hub and must only be run through it while they are connected.
+ */
+struct LinkHub {
+  static constexpr int kMaxPlayers = 4;
+
+  /// One scanline.
+  static constexpr int kDefaultQuantum = 1232;
+
+  LinkHub(int quantum = kDefaultQuantum);
+ ~LinkHub();
+
+  /**
+   * Plugs an emulator into the next free port, which decides its player ID (the first one is the parent).
+   * Returns false if all ports are taken or the emulators already ran.
+   */
+  bool Connect(Emulator& emulator);
+
+  /// Runs all emulators for a number of cycles and returns when they have finished.
+  void Run(int cycles);
+
+  /// Runs all emulators for one frame each.
+  void Frame();
+
+  auto GetPlayerCount() const -> int { return int(ports.size()); }
+  auto GetQuantum() const -> int { return quantum; }
+
+private:
+  using Link = core::SerialBus::Link;
+
+  struct Port final : Link {
+    void Send(Message const& message) override;
+    auto GetPlayerId() const -> int override { return id; }
+    auto GetPlayerCount() const -> int override { return hub->GetPlayerCount(); }
+
+    LinkHub* hub;
+    Emulator* emulator;
+    int id;
+
+    /// Messages sent during the current quantum, only accessed by the thread of this port until the quantum ends.
+    std::vector<Message> outbox;
+  };
+
+  void StartWorkers();
+  void RunWorker(Port& port);
+  void RunPort(Port& port, int cycles);
+  void WaitForQuantum();
+
+  /// Delivers the messages of all ports, while all emulators wait at the end of a quantum.
+  void Exchange();
+  void ExchangeNormal(Port& sender, Link::Message const& message, int delay);
+  void ExchangeMultiplay(Link::Message const& message, int delay);
+  void ExchangeUART(Port& sender, Link::Message const& message, int delay);
+
+  static auto GetSerialBus(Port& port) -> core::SerialBus& {
+    return port.emulator->cpu.serial_bus;
+  }
+
+  int quantum;
+  std::vector<std::unique_ptr<Port>> ports;
+
+  /// Run the emulators of all ports but the first one. They start each Run() at a barrier, see WaitForQuantum().
+  std::vector<std::thread> workers;
+
+  /// Set before the barrier that starts a Run(), read by the workers after it.
+  int run_cycles = 0;
+  bool stopping = false;
+
+  std::atomic<int> arrived = 0;
+  std::atomic<u32> generation = 0;
+
+  /// Threads that do not get to continue soon stop spinning and sleep until the quantum ends.
+  std::mutex sleep_lock;
+  std::condition_variable wakeup;
+};
+
+} // namespace nba
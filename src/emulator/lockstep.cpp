@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <common/log.hpp>
+#include <cstring>
+
+#include "lockstep.hpp"
+
+namespace nba {
+
+Lockstep::Lockstep(std::shared_ptr<Config> config) {
+  this->config = std::make_shared<Config>(*config);
+  this->config->input_dev = std::make_shared<NullInputDevice>();
+  this->config->rewind.enable = false;
+  this->config->run_ahead = 0;
+  this->config->suspend_resume = false;
+  this->config->reference_paths = false;
+
+  fast.emulator = std::make_unique<Emulator>(this->config);
+}
+
+auto Lockstep::LoadGame(std::string const& path) -> Emulator::StatusCode {
+  return fast.emulator->LoadGame(path);
+}
+
+void Lockstep::Reset() {
+  auto reference_config = std::make_shared<Config>(*config);
+
+  reference_config->audio_dev = std::make_shared<NullAudioDevice>();
+  reference_config->input_dev = std::make_shared<NullInputDevice>();
+  reference_config->video_dev = std::make_shared<NullVideoDevice>();
+  reference_config->reference_paths = true;
+
+  // The reference emulator starts out as an exact copy of the freshly reset one.
+  fast.emulator->Reset();
+  reference.emulator = fast.emulator->Clone(reference_config);
+
+  for (auto instance : { &fast, &reference }) {
+    instance->emulator->cpu.hash_writes = true;
+    instance->emulator->cpu.write_hash = 0;
+    std::memset(instance->trace, 0, sizeof(instance->trace));
+  }
+
+  trace_head = 0;
+  block_count = 0;
+}
+
+bool Lockstep::Run(int cycles) {
+  auto& fast_cpu = fast.emulator->cpu;
+  auto& reference_cpu = reference.emulator->cpu;
+  auto& state = fast_cpu.GetRegisterFile();
+  auto limit = fast_cpu.scheduler.GetTimestampNow() + cycles;
+
+  while (fast_cpu.scheduler.GetTimestampNow() < limit) {
+    auto next_r15 = state.r15 + (state.cpsr.f.thumb ? 2 : 4);
+
+    // Every instruction takes at least one cycle, so this runs exactly one instruction.
+    fast_cpu.RunFor(1);
+    reference_cpu.RunFor(1);
+
+    Record(fast, trace_head);
+    Record(reference, trace_head);
+    trace_head = (trace_head + 1) % kTraceLength;
+
+    if (state.r15 != next_r15 || state.r15 != reference_cpu.GetRegisterFile().r15) {
+      block_count++;
+      if (!Compare()) {
+        Dump();
+        return false;
+      }
+    }
+  }
+
+  fast.emulator->CommitBackup(cycles);
+  return true;
+}
+
+void Lockstep::Record(Instance& instance, int index) {
+  auto& cpu = instance.emulator->cpu;
+  auto& state = cpu.GetRegisterFile();
+
+  instance.trace[index] = {
+    state.r15,
+    state.cpsr.v,
+    cpu.scheduler.GetTimestampNow(),
+    cpu.write_hash
+  };
+}
+
+bool Lockstep::Compare() {
+  auto& cpu_a = fast.emulator->cpu;
+  auto& cpu_b = reference.emulator->cpu;
+  auto& state_a = cpu_a.GetRegisterFile();
+  auto& state_b = cpu_b.GetRegisterFile();
+
+  if (std::memcmp(state_a.reg, state_b.reg, sizeof(state_a.reg)) != 0 ||
+      std::memcmp(state_a.bank, state_b.bank, sizeof(state_a.bank)) != 0 ||
+      state_a.cpsr.v != state_b.cpsr.v) {
+    LOG_ERROR("Lockstep: registers differ.");
+    return false;
+  }
+
+  if (cpu_a.scheduler.GetTimestampNow() != cpu_b.scheduler.GetTimestampNow()) {
+    LOG_ERROR("Lockstep: scheduler timestamps differ.");
+    return false;
+  }
+
+  if (cpu_a.write_hash != cpu_b.write_hash) {
+    LOG_ERROR("Lockstep: bus writes differ.");
+    return false;
+  }
+
+  return true;
+}
+
+void Lockstep::Dump() {
+  LOG_ERROR("Lockstep: mismatch after {0} blocks, most recent instructions last:", block_count);
+  LOG_ERROR("  fast:    r15      cpsr     timestamp        writes           | reference:");
+
+  for (int i = 0; i < kTraceLength; i++) {
+    auto index = (trace_head + i) % kTraceLength;
+    auto& a = fast.trace[index];
+    auto& b = reference.trace[index];
+
+    LOG_ERROR("  {0}        {1:08X} {2:08X} {3:016X} {4:016X} | {5:08X} {6:08X} {7:016X} {8:016X}",
+      a.r15 == b.r15 && a.cpsr == b.cpsr && a.timestamp == b.timestamp && a.write_hash == b.write_hash ? ' ' : '*',
+      a.r15, a.cpsr, a.timestamp, a.write_hash, b.r15, b.cpsr, b.timestamp, b.write_hash);
+  }
+
+  auto& state_a = fast.emulator->cpu.GetRegisterFile();
+  auto& state_b = reference.emulator->cpu.GetRegisterFile();
+
+  for (int i = 0; i < 16; i++) {
+    LOG_ERROR("  r{0:<2} {1:08X} | {2:08X}{3}", i, state_a.reg[i], state_b.reg[i],
+      state_a.reg[i] != state_b.reg[i] ? " *" : "");
+  }
+  LOG_ERROR("  cpsr {0:08X} | {1:08X}{2}", state_a.cpsr.v, state_b.cpsr.v,
+    state_a.cpsr.v != state_b.cpsr.v ? " *" : "");
+}
+
+} // namespace nba
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <emulator/emulator.hpp>
+#include <memory>
+#include <string>
+
+namespace nba {
+
+/**
+ * Runs a game on two emulators in lockstep: one takes the fast paths of the core,
+ * the other one the reference paths (see Config::reference_paths).
+ * The registers, the scheduler timestamp and a hash of all bus writes are compared
+ * at every block boundary, that is whenever the CPU does not continue with the next instruction.
+ *
+ * Meant for debugging, this is much slower than a single emulator.
+ * Neither emulator receives input and the config's input device is ignored.
+ */
+struct Lockstep {
+  Lockstep(std::shared_ptr<Config> config);
+
+  auto LoadGame(std::string const& path) -> Emulator::StatusCode;
+  void Reset();
+
+  /**
+   * Runs both emulators for the given number of cycles.
+   * At the first mismatch the recent trace and the registers of both emulators
+   * are logged and false is returned.
+   */
+  bool Run(int cycles);
+
+  auto GetBlockCount() const -> u64 { return block_count; }
+
+private:
+  static constexpr int kTraceLength = 32;
+
+  struct TraceEntry {
+    u32 r15;
+    u32 cpsr;
+    u64 timestamp;
+    u64 write_hash;
+  };
+
+  struct Instance {
+    std::unique_ptr<Emulator> emulator;
+    TraceEntry trace[kTraceLength] {};
+  };
+
+  static void Record(Instance& instance, int index);
+  bool Compare();
+  void Dump();
+
+  std::shared_ptr<Config> config;
+  Instance fast;
+  Instance reference;
+  int trace_head = 0;
+  u64 block_count = 0;
+};
+
+} // namespace nba
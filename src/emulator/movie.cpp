@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <common/log.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "movie.hpp"
+
+namespace nba {
+
+namespace {
+
+constexpr char g_magic[4] { 'N', 'B', 'A', 'M' };
+
+/* Bump this whenever the layout of the file changes.
+ * Changes to the save state are caught by its own size and version.
+ */
+constexpr u64 g_version = 2;
+
+constexpr int g_cycles_per_frame = 280896;
+
+/// Shorter runs of a repeated byte in a snapshot are cheaper to keep in a literal run.
+constexpr size_t g_min_run = 8;
+
+void PutVarint(std::vector<u8>& buffer, u64 value) {
+  while (value >= 0x80) {
+    buffer.push_back(u8(value | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back(u8(value));
+}
+
+struct Reader {
+  Reader(std::vector<u8> const& buffer) : data(buffer.data()), end(buffer.data() + buffer.size()) {}
+
+  bool GetVarint(u64& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (data == end) {
+        return false;
+      }
+      auto byte = *data++;
+      value |= u64(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool GetBytes(void* buffer, size_t length) {
+    if (size_t(end - data) < length) {
+      return false;
+    }
+    std::memcpy(buffer, data, length);
+    data += length;
+    return true;
+  }
+
+  u8 const* data;
+  u8 const* end;
+};
+
+void EncodeSnapshot(std::vector<u8>& buffer, SaveState const& state) {
+  auto bytes = (u8 const*)&state;
+  auto size = sizeof(SaveState);
+  size_t i = 0;
+
+  /* Alternating runs of a repeated byte and literal bytes,
+   * e.g. zeroed memory and erased (0xFF) save data.
+   */
+  while (i < size) {
+    auto value = bytes[i];
+    auto literal_begin = i;
+    while (literal_begin < size && bytes[literal_begin] == value) {
+      literal_begin++;
+    }
+
+    auto literal_end = literal_begin;
+    while (literal_end < size) {
+      size_t run = 1;
+      while (literal_end + run < size && bytes[literal_end + run] == bytes[literal_end] && run < g_min_run) {
+        run++;
+      }
+      if (run == g_min_run || literal_end + run == size) {
+        break;
+      }
+      literal_end += run;
+    }
+
+    PutVarint(buffer, literal_begin - i);
+    buffer.push_back(value);
+    PutVarint(buffer, literal_end - literal_begin);
+    buffer.insert(buffer.end(), bytes + literal_begin, bytes + literal_end);
+    i = literal_end;
+  }
+}
+
+bool DecodeSnapshot(Reader& reader, SaveState& state) {
+  auto bytes = (u8*)&state;
+  auto size = sizeof(SaveState);
+  size_t i = 0;
+
+  while (i < size) {
+    u64 run;
+    u8 value;
+    u64 literals;
+
+    if (!reader.GetVarint(run) || !reader.GetBytes(&value, 1) || !reader.GetVarint(literals) ||
+        run > size - i || literals > size - i - run) {
+      return false;
+    }
+    std::memset(bytes + i, value, run);
+    i += run;
+    if (!reader.GetBytes(bytes + i, literals)) {
+      return false;
+    }
+    i += literals;
+  }
+  return true;
+}
+
+} // namespace
+
+auto Movie::GetFrameCount() const -> int {
+  return int((end_timestamp - start_timestamp + g_cycles_per_frame - 1) / g_cycles_per_frame);
+}
+
+bool Movie::Save(std::string const& path) const {
+  auto buffer = std::vector<u8>{std::begin(g_magic), std::end(g_magic)};
+  auto timestamp = start_timestamp;
+
+  PutVarint(buffer, g_version);
+  PutVarint(buffer, rom_hash);
+  PutVarint(buffer, u64(start));
+  PutVarint(buffer, start_timestamp);
+  PutVarint(buffer, end_timestamp);
+  PutVarint(buffer, u64(rtc_base_time));
+  PutVarint(buffer, entries.size());
+
+  for (auto const& entry : entries) {
+    PutVarint(buffer, entry.timestamp - timestamp);
+    PutVarint(buffer, entry.keyinput);
+    timestamp = entry.timestamp;
+  }
+
+  PutVarint(buffer, sizeof(SaveState));
+  EncodeSnapshot(buffer, *snapshot);
+
+  auto stream = std::ofstream{path, std::ios::binary};
+  stream.write((char const*)buffer.data(), buffer.size());
+  if (!stream.good()) {
+    LOG_ERROR("Failed to write movie: {0}", path);
+    return false;
+  }
+  return true;
+}
+
+bool Movie::Load(std::string const& path) {
+  auto stream = std::ifstream{path, std::ios::binary};
+  if (!stream.good()) {
+    LOG_ERROR("Unable to open movie: {0}", path);
+    return false;
+  }
+
+  auto buffer = std::vector<u8>{std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}};
+  auto reader = Reader{buffer};
+  char magic[4];
+  u64 version = 0;
+  u64 start;
+  u64 rtc_base_time;
+  u64 entry_count;
+
+  if (!reader.GetBytes(magic, sizeof(magic)) || std::memcmp(magic, g_magic, sizeof(magic)) != 0) {
+    LOG_ERROR("{0} is not a movie.", path);
+    return false;
+  }
+
+  if (!reader.GetVarint(version) || version != g_version) {
+    LOG_ERROR("Movie {0} has version {1}, but only version {2} is supported.", path, version, g_version);
+    return false;
+  }
+
+  if (!reader.GetVarint(rom_hash) ||
+      !reader.GetVarint(start) || start > u64(Start::Snapshot) ||
+      !reader.GetVarint(start_timestamp) ||
+      !reader.GetVarint(end_timestamp) || end_timestamp < start_timestamp ||
+      !reader.GetVarint(rtc_base_time) || rtc_base_time > u64(INT64_MAX) ||
+      !reader.GetVarint(entry_count) || entry_count > buffer.size()) {
+    LOG_ERROR("Movie {0} is damaged.", path);
+    return false;
+  }
+
+  this->start = Start(start);
+  this->rtc_base_time = s64(rtc_base_time);
+  entries.resize(entry_count);
+
+  auto timestamp = start_timestamp;
+
+  for (auto& entry : entries) {
+    u64 delta;
+    u64 keyinput;
+
+    if (!reader.GetVarint(delta) || !reader.GetVarint(keyinput) || keyinput > 0x3FF) {
+      LOG_ERROR("Movie {0} is damaged.", path);
+      return false;
+    }
+    timestamp += delta;
+    entry = {timestamp, u16(keyinput)};
+  }
+
+  u64 size;
+
+  snapshot.reset();
+
+  if (!reader.GetVarint(size) || size != sizeof(SaveState)) {
+    LOG_ERROR("Movie {0} starts from a save state of a different emulator version.", path);
+    return false;
+  }
+
+  snapshot = std::make_unique<SaveState>();
+  if (!DecodeSnapshot(reader, *snapshot)) {
+    snapshot.reset();
+    LOG_ERROR("Movie {0} is damaged.", path);
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace nba
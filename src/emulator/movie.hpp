@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+#include <emulator/core/input_queue.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "save_state.hpp"
+
+namespace nba {
+
+/**
+ * Recording of every key state that took effect, together with the state
+ * the machine started in, so that the same run can be replayed cycle-exactly.
+ * The start state includes the save data and the cartridge clock is pinned
+ * during the movie, so neither the save file nor the host time affects playback.
+ *
+ * On disk the key states are run-length encoded: each entry only stores
+ * the number of cycles since the previous one and the new KEYINPUT value.
+ * The start state is stored with its runs of repeated bytes collapsed.
+ */
+struct Movie {
+  enum class Start : u8 {
+    PowerOn,
+    Snapshot
+  };
+
+  using Entry = core::InputQueue::Entry;
+
+  u64 rom_hash = 0;
+
+  /// Whether the recording began with a reset or in the middle of a game.
+  Start start = Start::PowerOn;
+
+  /// State of the machine at the start of the movie, for either kind of start.
+  std::unique_ptr<SaveState> snapshot;
+
+  /// Time of the cartridge clock at reset during the movie, see Config::rtc_base_time.
+  s64 rtc_base_time = 0;
+
+  /// Emulated cycles since reset at which the recording started and ended.
+  u64 start_timestamp = 0;
+  u64 end_timestamp = 0;
+
+  /// In the order they took effect, with non-decreasing timestamps.
+  std::vector<Entry> entries;
+
+  /// Number of frames that cover the movie, including a partial last frame.
+  auto GetFrameCount() const -> int;
+
+  bool Save(std::string const& path) const;
+  bool Load(std::string const& path);
+};
+
+} // namespace nba
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <cstring>
+
+#include "rewind.hpp"
+
+namespace nba {
+
+RewindBuffer::RewindBuffer(size_t max_memory)
+    : max_memory(max_memory)
+    , next(kWordCount)
+    , pending(kWordCount)
+    , head(kWordCount) {
+  thread = std::thread{&RewindBuffer::WorkerThreadMain, this};
+}
+
+RewindBuffer::~RewindBuffer() {
+  mutex.lock();
+  quit = true;
+  mutex.unlock();
+  cv.notify_all();
+  thread.join();
+}
+
+auto RewindBuffer::Next() -> SaveState& {
+  return *reinterpret_cast<SaveState*>(next.data());
+}
+
+void RewindBuffer::Push() {
+  std::unique_lock lock{mutex};
+
+  // Wait for the previous snapshot, if the worker is lagging behind.
+  cv.wait(lock, [this]() { return !has_pending; });
+
+  std::swap(next, pending);
+  has_pending = true;
+  lock.unlock();
+  cv.notify_all();
+}
+
+bool RewindBuffer::Pop(SaveState& state) {
+  std::unique_lock lock{mutex};
+
+  Flush(lock);
+
+  if (!has_head) {
+    return false;
+  }
+
+  std::memcpy(&state, head.data(), sizeof(SaveState));
+
+  if (deltas.empty()) {
+    has_head = false;
+  } else {
+    Decode(deltas.back(), head);
+    used_memory -= deltas.back().size() * sizeof(u64);
+    deltas.pop_back();
+  }
+
+  return true;
+}
+
+void RewindBuffer::Clear() {
+  std::unique_lock lock{mutex};
+
+  Flush(lock);
+  deltas.clear();
+  used_memory = 0;
+  has_head = false;
+}
+
+void RewindBuffer::Flush(std::unique_lock<std::mutex>& lock) {
+  cv.wait(lock, [this]() { return !has_pending && !busy; });
+}
+
+void RewindBuffer::WorkerThreadMain() {
+  auto snapshot = Snapshot(kWordCount);
+  auto delta = std::vector<u64>{};
+  std::unique_lock lock{mutex};
+
+  for (;;) {
+    cv.wait(lock, [this]() { return has_pending || quit; });
+
+    if (quit) {
+      break;
+    }
+
+    std::swap(snapshot, pending);
+    has_pending = false;
+
+    if (!has_head) {
+      std::swap(snapshot, head);
+      has_head = true;
+      cv.notify_all();
+      continue;
+    }
+
+    // The history must not change while the delta is encoded.
+    busy = true;
+    lock.unlock();
+    cv.notify_all();
+    Encode(snapshot, head, delta);
+    lock.lock();
+    busy = false;
+
+    used_memory += delta.size() * sizeof(u64);
+    deltas.emplace_back(delta.begin(), delta.end());
+    std::swap(snapshot, head);
+
+    while (used_memory > max_memory && !deltas.empty()) {
+      used_memory -= deltas.front().size() * sizeof(u64);
+      deltas.pop_front();
+    }
+
+    cv.notify_all();
+  }
+}
+
+/* The delta is a sequence of runs, each made of a header word
+ * with the number of unchanged words in the upper and the number of
+ * changed words in the lower 32 bits, followed by the changed words XOR'ed.
+ */
+void RewindBuffer::Encode(Snapshot const& a, Snapshot const& b, std::vector<u64>& delta) {
+  size_t i = 0;
+
+  delta.clear();
+
+  while (i < kWordCount) {
+    size_t zero_start = i;
+    while (i < kWordCount && a[i] == b[i]) i++;
+
+    size_t literal_start = i;
+    while (i < kWordCount && a[i] != b[i]) i++;
+
+    delta.push_back((u64(literal_start - zero_start) << 32) | u64(i - literal_start));
+    for (size_t j = literal_start; j < i; j++) {
+      delta.push_back(a[j] ^ b[j]);
+    }
+  }
+}
+
+void RewindBuffer::Decode(std::vector<u64> const& delta, Snapshot& snapshot) {
+  size_t i = 0;
+  size_t j = 0;
+
+  while (j < delta.size()) {
+    auto header = delta[j++];
+    i += header >> 32;
+
+    for (auto end = j + (header & 0xFFFFFFFF); j < end; j++) {
+      snapshot[i++] ^= delta[j];
+    }
+  }
+}
+
+} // namespace nba
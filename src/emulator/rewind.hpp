@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "save_state.hpp"
+
+namespace nba {
+
+/**
+ * History of save states for rewinding.
+ *
+ * Only the most recent snapshot is kept as a whole. Every older snapshot is
+ * stored as the run-length encoded XOR delta to its successor, which is
+ * mostly zero since little of the machine state changes between two snapshots.
+ * Deltas are encoded on a background thread and the oldest snapshots
+ * are dropped once the deltas exceed the memory budget.
+ */
+struct RewindBuffer {
+  RewindBuffer(size_t max_memory);
+ ~RewindBuffer();
+
+  /// Returns the buffer that the next snapshot must be written to before calling Push().
+  auto Next() -> SaveState&;
+
+  /// Adds the snapshot that was written to Next() to the history.
+  void Push();
+
+  /// Removes the most recent snapshot from the history and copies it to state.
+  /// Returns false if the history is empty.
+  bool Pop(SaveState& state);
+
+  void Clear();
+
+private:
+  static constexpr size_t kWordCount = (sizeof(SaveState) + 7) / 8;
+
+  using Snapshot = std::vector<u64>;
+
+  void WorkerThreadMain();
+  void Flush(std::unique_lock<std::mutex>& lock);
+
+  static void Encode(Snapshot const& a, Snapshot const& b, std::vector<u64>& delta);
+  static void Decode(std::vector<u64> const& delta, Snapshot& snapshot);
+
+  size_t max_memory;
+  size_t used_memory = 0;
+
+  Snapshot next;
+  Snapshot pending;
+  Snapshot head;
+  bool has_pending = false;
+  bool has_head = false;
+  std::deque<std::vector<u64>> deltas;
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool busy = false;
+  bool quit = false;
+};
+
+} // namespace nba
@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+#include <type_traits>
+
+namespace nba {
+
+/**
+ * Snapshot of the complete emulated machine state.
+ *
+ * The state is made up of fixed-size sections of plain data only,
+ * so that a snapshot can be copied, compared and written to disk with memcpy.
+ * The host-side state (audio resamplers, the framebuffer, ...) is not included.
+ * Increment kCurrentVersion whenever the layout or meaning of any field changes.
+ */
+struct SaveState {
+  static constexpr u32 kMagicNumber = 0x5353424E; // "NBSS"
+  static constexpr u32 kCurrentVersion = 2;
+
+  u32 magic;
+  u32 version;
+
+  /// XXH64 hash of the ROM that the state was created with.
+  u64 rom_hash;
+
+  struct Scheduler {
+    static constexpr int kMaxEvents = 64;
+
+    u64 timestamp_now;
+    int event_count;
+
+    /// Pending events in heap order.
+    struct Event {
+      u64 timestamp;
+      u64 user_data;
+      u16 event_class;
+    } events[kMaxEvents];
+  } scheduler;
+
+  struct ARM {
+    u32 reg[16];
+    u32 bank[6][7];
+    u32 cpsr;
+    u32 spsr[6];
+
+    struct Pipeline {
+      u32 opcode[2];
+      int fetch_type;
+    } pipe;
+
+    bool irq_line;
+    bool ldm_usermode_conflict;
+    bool cpu_mode_is_invalid;
+  } arm;
+
+  struct Bus {
+    struct Memory {
+      u8 wram[0x40000];
+      u8 iram[0x08000];
+      u32 bios_latch;
+    } memory;
+
+    struct IO {
+      u16 keyinput;
+      u16 rcnt_hack;
+      u8 postflg;
+      int haltcnt;
+
+      struct WaitstateControl {
+        int sram;
+        int ws0_n;
+        int ws0_s;
+        int ws1_n;
+        int ws1_s;
+        int ws2_n;
+        int ws2_s;
+        int phi;
+        int prefetch;
+        int cgb;
+      } waitcnt;
+
+      struct KeyControl {
+        u16 input_mask;
+        bool interrupt;
+        bool and_mode;
+      } keycnt;
+    } io;
+
+    struct Prefetch {
+      bool active;
+      bool rom_code_access;
+      u32 head_address;
+      u32 last_address;
+      int count;
+      int capacity;
+      int opcode_width;
+      int countdown;
+      int duty;
+    } prefetch;
+
+    bool openbus_from_dma;
+
+    struct M4A {
+      /// Address of the M4A SoundInfo structure, zero if not known yet.
+      u32 soundinfo_address;
+      int original_freq;
+    } m4a;
+  } bus;
+
+  struct IRQ {
+    int reg_ime;
+    u16 reg_ie;
+    u16 reg_if;
+  } irq;
+
+  struct DMA {
+    struct Channel {
+      bool enable;
+      bool repeat;
+      bool interrupt;
+      bool gamepak;
+      u16 length;
+      u32 dst_addr;
+      u32 src_addr;
+      int dst_cntl;
+      int src_cntl;
+      int time;
+      int size;
+      bool is_fifo_dma;
+
+      struct Latch {
+        u32 length;
+        u32 dst_addr;
+        u32 src_addr;
+        u32 bus;
+      } latch;
+    } channels[4];
+
+    int active_dma_id;
+    bool early_exit_trigger;
+    u8 hblank_set;
+    u8 vblank_set;
+    u8 video_set;
+    u8 runnable_set;
+    u32 latch;
+  } dma;
+
+  struct Timer {
+    u16 reload;
+    u32 counter;
+    int frequency;
+    bool cascade;
+    bool interrupt;
+    bool enable;
+    bool running;
+    int shift;
+    int mask;
+    int samplerate;
+    u64 timestamp_started;
+  } timer[4];
+
+  struct PPU {
+    u8 pram[0x00400];
+    u8 oam [0x00400];
+    u8 vram[0x18000];
+
+    struct IO {
+      struct DisplayControl {
+        int mode;
+        int cgb_mode;
+        int frame;
+        int hblank_oam_access;
+        int oam_mapping_1d;
+        int forced_blank;
+        int enable[8];
+      } dispcnt;
+
+      struct DisplayStatus {
+        int vblank_flag;
+        int hblank_flag;
+        int vcount_flag;
+        int vblank_irq_enable;
+        int hblank_irq_enable;
+        int vcount_irq_enable;
+        int vcount_setting;
+      } dispstat;
+
+      u8 vcount;
+
+      struct BackgroundControl {
+        int priority;
+        int tile_block;
+        int unused;
+        int mosaic_enable;
+        int full_palette;
+        int map_block;
+        int wraparound;
+        int size;
+      } bgcnt[4];
+
+      u16 bghofs[4];
+      u16 bgvofs[4];
+
+      struct ReferencePoint {
+        s32 initial;
+        s32 current;
+      } bgx[2], bgy[2];
+
+      s16 bgpa[2];
+      s16 bgpb[2];
+      s16 bgpc[2];
+      s16 bgpd[2];
+
+      struct WindowRange {
+        int min;
+        int max;
+        bool changed;
+      } winh[2], winv[2];
+
+      int winin[2][6];
+      int winout[2][6];
+
+      struct Mosaic {
+        int size_x;
+        int size_y;
+        int counter_y;
+      } mosaic_bg, mosaic_obj;
+
+      struct BlendControl {
+        int sfx;
+        int targets[2][6];
+      } bldcnt;
+
+      int eva;
+      int evb;
+      int evy;
+    } io;
+
+    /* OBJ and window buffers carry over from one scanline to the next. */
+    struct ObjectPixel {
+      u16 color;
+      u8 priority;
+      u8 alpha;
+      u8 window;
+    } buffer_obj[240];
+
+    bool line_contains_alpha_obj;
+    bool buffer_win[2][240];
+    bool window_scanline_enable[2];
+  } ppu;
+
+  struct APU {
+    struct FIFO {
+      s8 data[32];
+      int rd_ptr;
+      int wr_ptr;
+      int count;
+    } fifo[2];
+
+    struct PSG {
+      bool enabled;
+      int step;
+
+      struct LengthCounter {
+        int length;
+        bool enabled;
+      } length;
+
+      struct Envelope {
+        bool active;
+        bool enabled;
+        int direction;
+        int initial_volume;
+        int current_volume;
+        int divider;
+        int step;
+      } envelope;
+
+      struct Sweep {
+        bool active;
+        bool enabled;
+        int direction;
+        int initial_freq;
+        int current_freq;
+        int shadow_freq;
+        int divider;
+        int shift;
+        int step;
+      } sweep;
+
+      s8 sample;
+    };
+
+    struct QuadChannel : PSG {
+      int phase;
+      int wave_duty;
+      bool dac_enable;
+    } psg1, psg2;
+
+    struct WaveChannel : PSG {
+      bool playing;
+      bool force_volume;
+      int volume;
+      int frequency;
+      int dimension;
+      int wave_bank;
+      u8 wave_ram[2][16];
+      int phase;
+    } psg3;
+
+    struct NoiseChannel : PSG {
+      u16 lfsr;
+      int frequency_shift;
+      int frequency_ratio;
+      int width;
+      bool dac_enable;
+      int skip_count;
+    } psg4;
+
+    struct SoundControl {
+      bool master_enable;
+
+      struct PSG {
+        int volume;
+        int master[2];
+        bool enable[2][4];
+      } psg;
+
+      struct DMA {
+        int volume;
+        bool enable[2];
+        int timer_id;
+      } dma[2];
+    } soundcnt;
+
+    struct BIAS {
+      int level;
+      int resolution;
+    } bias;
+
+    s8 latch[2];
+  } apu;
+
+  struct SerialBus {
+    u16 siocnt;
+    u16 rcnt;
+    u16 data[4];
+    u16 send;
+    u8 uart_fifo[4];
+    int uart_fifo_count;
+    int mode;
+  } serial_bus;
+
+  struct Backup {
+    /// Number of valid bytes in data, zero if the cartridge has no backup memory.
+    u32 size;
+    u8 data[131072];
+
+    struct FLASH {
+      int current_bank;
+      int phase;
+      bool enable_chip_id;
+      bool enable_erase;
+      bool enable_write;
+      bool enable_select;
+    } flash;
+
+    struct EEPROM {
+      int state;
+      int address;
+      u64 serial_buffer;
+      int transmitted_bits;
+    } eeprom;
+  } backup;
+
+  struct GPIO {
+    bool allow_reads;
+    int direction[4];
+    u8 port_data;
+
+    struct RTC {
+      int current_bit;
+      int current_byte;
+      int reg;
+      u8 data;
+      u8 buffer[7];
+      int sck;
+      int sio;
+      int cs;
+      int state;
+      bool unknown;
+      bool per_minute_irq;
+      bool mode_24h;
+      bool poweroff;
+    } rtc;
+  } gpio;
+};
+
+static_assert(std::is_trivially_copyable_v<SaveState>, "SaveState must be copyable with memcpy.");
+
+} // namespace nba
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <common/log.hpp>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define NBA_SESSION_MMAP
+  #include <sys/mman.h>
+#endif
+
+#ifdef WIN32
+  #include <io.h>
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+#include "emulator.hpp"
+
+namespace nba {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/**
+ * Read-only view of a session file. The file is memory-mapped where possible,
+ * so that the state is copied into the machine straight from the page cache.
+ */
+struct SessionFile {
+  SessionFile(std::string const& path) {
+#ifdef NBA_SESSION_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd != -1) {
+      void* mapping = mmap(nullptr, sizeof(SaveState), PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (mapping != MAP_FAILED) {
+        this->mapping = mapping;
+        state = (SaveState const*)mapping;
+        return;
+      }
+    }
+#endif
+
+    std::ifstream stream{path, std::ios::binary};
+    if (stream.good()) {
+      buffer = std::make_unique<SaveState>();
+      stream.read((char*)buffer.get(), sizeof(SaveState));
+      if (stream.good()) {
+        state = buffer.get();
+      }
+    }
+  }
+
+ ~SessionFile() {
+#ifdef NBA_SESSION_MMAP
+    if (mapping != nullptr) {
+      munmap(mapping, sizeof(SaveState));
+    }
+#endif
+  }
+
+  SaveState const* state = nullptr;
+
+private:
+  void* mapping = nullptr;
+  std::unique_ptr<SaveState> buffer;
+};
+
+} // namespace
+
+bool Emulator::Suspend() {
+  if (session_path.empty()) {
+    return false;
+  }
+
+  auto state = std::make_unique<SaveState>();
+  auto tmp_path = session_path + ".tmp";
+
+  CopyState(*state);
+
+  auto file = std::fopen(tmp_path.c_str(), "wb");
+  if (file == nullptr) {
+    LOG_ERROR("Unable to create session file: {0}", tmp_path);
+    return false;
+  }
+
+  bool success = std::fwrite(state.get(), sizeof(SaveState), 1, file) == 1 &&
+                 std::fflush(file) == 0;
+
+  // Make sure the data reached the disk before the rename makes it visible.
+#ifdef WIN32
+  success = success && _commit(_fileno(file)) == 0;
+#else
+  success = success && fsync(fileno(file)) == 0;
+#endif
+
+  success = std::fclose(file) == 0 && success;
+
+  if (!success) {
+    LOG_ERROR("Failed to write session file: {0}", tmp_path);
+    return false;
+  }
+
+  // Never leave a partially written session behind.
+  std::error_code error;
+  fs::rename(tmp_path, session_path, error);
+  if (error) {
+    LOG_ERROR("Unable to replace session file: {0} ({1})", session_path, error.message());
+    return false;
+  }
+
+#ifndef WIN32
+  // Persist the rename itself, which lives in the directory.
+  auto directory_path = fs::path{session_path}.parent_path();
+  int directory = open(directory_path.empty() ? "." : directory_path.c_str(), O_RDONLY);
+  if (directory != -1) {
+    fsync(directory);
+    close(directory);
+  }
+#endif
+
+  LOG_INFO("Suspended session to {0}", session_path);
+  return true;
+}
+
+bool Emulator::Resume() {
+  std::error_code error;
+  auto size = fs::file_size(session_path, error);
+
+  if (error) {
+    return false;
+  }
+
+  if (size != sizeof(SaveState)) {
+    LOG_WARN("Session file {0} has an unexpected size, ignoring it.", session_path);
+    return false;
+  }
+
+  auto file = SessionFile{session_path};
+  if (file.state == nullptr) {
+    LOG_ERROR("Unable to read session file: {0}", session_path);
+    return false;
+  }
+
+  auto& state = *file.state;
+
+  /* The session contains a copy of the backup memory.
+   * If the save file has been changed since, e.g. because the emulator crashed
+   * after the session was suspended, resuming would revert the save file.
+   */
+  auto current = std::make_unique<SaveState>();
+  cpu.CopyState(*current);
+  if (current->backup.size != state.backup.size ||
+      std::memcmp(current->backup.data, state.backup.data, state.backup.size) != 0) {
+    LOG_WARN("Save file was modified after the session was suspended, ignoring the session.");
+    return false;
+  }
+
+  if (LoadState(state) != StatusCode::Ok) {
+    return false;
+  }
+
+  LOG_INFO("Resumed session from {0}", session_path);
+  return true;
+}
+
+} // namespace nba
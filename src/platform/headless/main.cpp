@@ -0,0 +1,526 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <common/hash.hpp>
+#include <common/log.hpp>
+#include <common/trace.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <emulator/config/config_toml.hpp>
+#include <emulator/device/audio_device.hpp>
+#include <emulator/device/input_device.hpp>
+#include <emulator/device/video_device.hpp>
+#include <emulator/emulator.hpp>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static constexpr auto kNativeWidth = 240;
+static constexpr auto kNativeHeight = 160;
+static constexpr auto kCyclesPerFrame = 280896;
+static constexpr auto kCyclesPerSecond = 16777216;
+
+/// 2001-01-01 00:00:00 UTC, which the cartridge clock shows at reset unless --rtc is given.
+static constexpr auto kDefaultRTCBaseTime = s64(978307200);
+
+static auto g_config = std::make_shared<nba::Config>();
+static auto g_frames = 3600;
+static auto g_jobs = 0;
+static auto g_output_path = std::string{"headless-output"};
+static auto g_input_path = std::string{};
+static auto g_movie_path = std::string{};
+static auto g_record_movie = false;
+static auto g_screenshot_frames = std::vector<int>{};
+static auto g_capture_audio = false;
+static auto g_golden_path = std::string{};
+static auto g_trace_path = std::string{};
+static auto g_rom_paths = std::vector<std::string>{};
+
+/**
+ * Scripted input: each line of the script holds a frame number and the keys
+ * that are pressed from that frame on, e.g. "120 A+START". "-" releases all keys.
+ */
+using InputScript = std::map<int, u16>;
+
+static auto g_input_script = InputScript{};
+
+struct CaptureVideoDevice : nba::VideoDevice {
+  void Draw(u32* buffer) final {
+    std::copy(buffer, buffer + kNativeWidth * kNativeHeight, framebuffer);
+  }
+
+  u32 framebuffer[kNativeWidth * kNativeHeight] {};
+};
+
+/**
+ * Pulls the samples of every emulated frame from the APU,
+ * the way the audio thread of a real audio device would.
+ */
+struct CaptureAudioDevice : nba::AudioDevice {
+  auto GetSampleRate() -> int final { return 48000; }
+  auto GetBlockSize() -> int final { return 1024; }
+
+  bool Open(void* userdata, Callback callback) final {
+    this->userdata = userdata;
+    this->callback = callback;
+    return true;
+  }
+
+  void Close() final {
+    callback = nullptr;
+  }
+
+  /// Appends the samples of the given number of cycles and returns how many values were appended.
+  auto Capture(int cycles) -> size_t {
+    if (callback == nullptr) {
+      return 0;
+    }
+
+    fraction += u64(cycles) * GetSampleRate();
+    auto count = int(fraction / kCyclesPerSecond);
+    fraction %= kCyclesPerSecond;
+
+    auto offset = samples.size();
+    samples.resize(offset + count * 2);
+    callback(userdata, samples.data() + offset, count * 2 * sizeof(s16));
+    return count * 2;
+  }
+
+  std::vector<s16> samples;
+
+private:
+  void* userdata = nullptr;
+  Callback callback = nullptr;
+  u64 fraction = 0;
+};
+
+struct ScriptedInputDevice : nba::InputDevice {
+  void SetKeys(u16 keys) {
+    if (keys != this->keys) {
+      this->keys = keys;
+      if (callback) {
+        callback();
+      }
+    }
+  }
+
+  auto Poll(Key key) -> bool final {
+    return keys & (1 << int(key));
+  }
+
+  void SetOnChangeCallback(std::function<void(void)> callback) final {
+    this->callback = callback;
+  }
+
+private:
+  u16 keys = 0;
+  std::function<void(void)> callback;
+};
+
+void usage(char* app_name) {
+  fmt::print("Usage: {0} [--config path] [--bios bios_path] [--skip-bios] [--frames count] [--jobs count] [--input script_path] [--movie movie_path] [--record] [--screenshot frame]... [--audio] [--output path] [--golden path] [--rtc seconds] [--trace path] rom_path...\n", app_name);
+  fmt::print("\nWithout --input, a script next to the ROM (e.g. game.input for game.gba) is used if it exists.\n"
+             "Without --movie, a movie next to the ROM (e.g. game.nbm) is played back if it exists,\n"
+             "which replaces the input script. With --record, every other run is recorded to movie.nbm.\n"
+             "With --golden, the video and audio hashes of every frame are compared to the frames.txt files\n"
+             "of an earlier run in that folder and the first frame that differs is reported.\n"
+             "Every run starts with an erased save and a cartridge clock that starts at 2001-01-01 00:00:00\n"
+             "(or --rtc seconds since the Unix epoch) and advances with the emulated time, so runs can be compared.\n"
+             "The save that a run leaves behind is written next to its other output, e.g. game.sav.\n"
+             "With --trace, a timeline of all workers is written as a Chrome trace (needs ENABLE_TRACE=ON).\n");
+  std::exit(-1);
+}
+
+/**
+ * Returns false and a description of the first problem instead of exiting,
+ * since scripts next to the ROMs are parsed on the worker threads.
+ */
+bool parse_input_script(std::string const& path, InputScript& script, std::string& error) {
+  using Key = nba::InputDevice::Key;
+
+  static const std::map<std::string, Key> keys{
+    { "UP",     Key::Up     },
+    { "DOWN",   Key::Down   },
+    { "LEFT",   Key::Left   },
+    { "RIGHT",  Key::Right  },
+    { "START",  Key::Start  },
+    { "SELECT", Key::Select },
+    { "A",      Key::A      },
+    { "B",      Key::B      },
+    { "L",      Key::L      },
+    { "R",      Key::R      }
+  };
+
+  auto stream = std::ifstream{path};
+
+  script.clear();
+
+  if (!stream.good()) {
+    error = fmt::format("cannot open input script {0}", path);
+    return false;
+  }
+
+  auto line = std::string{};
+  auto line_number = 0;
+
+  while (std::getline(stream, line)) {
+    auto frame = 0;
+    auto names = std::string{};
+    auto mask = u16(0);
+
+    line_number++;
+
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    if (!(std::istringstream{line} >> frame >> names)) {
+      error = fmt::format("{0}:{1}: expected frame number and keys", path, line_number);
+      return false;
+    }
+
+    if (names != "-") {
+      auto name = std::string{};
+      auto name_stream = std::istringstream{names};
+
+      while (std::getline(name_stream, name, '+')) {
+        auto match = keys.find(name);
+        if (match == keys.end()) {
+          error = fmt::format("{0}:{1}: unknown key '{2}'", path, line_number, name);
+          return false;
+        }
+        mask |= 1 << int(match->second);
+      }
+    }
+
+    script[frame] = mask;
+  }
+
+  return true;
+}
+
+void parse_arguments(int argc, char** argv) {
+  auto i = 1;
+
+  auto next = [&]() -> std::string {
+    if (i == argc) {
+      usage(argv[0]);
+    }
+    return argv[i++];
+  };
+
+  while (i < argc) {
+    auto key = std::string{argv[i++]};
+    if (key == "--config") {
+      nba::config_toml_read(*g_config, next());
+    } else if (key == "--bios") {
+      g_config->bios_path = next();
+    } else if (key == "--skip-bios") {
+      g_config->skip_bios = true;
+    } else if (key == "--frames") {
+      g_frames = std::atoi(next().c_str());
+    } else if (key == "--jobs") {
+      g_jobs = std::atoi(next().c_str());
+    } else if (key == "--input") {
+      g_input_path = next();
+    } else if (key == "--movie") {
+      g_movie_path = next();
+    } else if (key == "--record") {
+      g_record_movie = true;
+    } else if (key == "--screenshot") {
+      g_screenshot_frames.push_back(std::atoi(next().c_str()));
+    } else if (key == "--audio") {
+      g_capture_audio = true;
+    } else if (key == "--output") {
+      g_output_path = next();
+    } else if (key == "--golden") {
+      g_golden_path = next();
+    } else if (key == "--rtc") {
+      g_config->rtc_base_time = std::atoll(next().c_str());
+    } else if (key == "--trace") {
+      g_trace_path = next();
+    } else if (key.rfind("--", 0) == 0) {
+      usage(argv[0]);
+    } else {
+      g_rom_paths.push_back(key);
+    }
+  }
+
+  if (g_rom_paths.empty() || g_frames <= 0) {
+    usage(argv[0]);
+  }
+
+  auto error = std::string{};
+
+  if (!g_input_path.empty() && !parse_input_script(g_input_path, g_input_script, error)) {
+    fmt::print("Invalid input script: {0}.\n", error);
+    std::exit(-2);
+  }
+}
+
+void write_screenshot(fs::path const& path, u32 const* framebuffer) {
+  auto file = std::fopen(path.string().c_str(), "wb");
+  if (file == nullptr) {
+    LOG_ERROR("Unable to create screenshot: {0}", path.string());
+    return;
+  }
+
+  std::fprintf(file, "P6\n%d %d\n255\n", kNativeWidth, kNativeHeight);
+  for (int i = 0; i < kNativeWidth * kNativeHeight; i++) {
+    u8 rgb[3] { u8(framebuffer[i] >> 16), u8(framebuffer[i] >> 8), u8(framebuffer[i]) };
+    std::fwrite(rgb, 1, 3, file);
+  }
+  std::fclose(file);
+}
+
+void write_wave(fs::path const& path, std::vector<s16> const& samples, int sample_rate) {
+  auto file = std::fopen(path.string().c_str(), "wb");
+  if (file == nullptr) {
+    LOG_ERROR("Unable to create audio file: {0}", path.string());
+    return;
+  }
+
+  auto write32 = [&](u32 value) { std::fwrite(&value, 4, 1, file); };
+  auto write16 = [&](u16 value) { std::fwrite(&value, 2, 1, file); };
+  auto data_size = u32(samples.size() * sizeof(s16));
+
+  std::fwrite("RIFF", 1, 4, file);
+  write32(36 + data_size);
+  std::fwrite("WAVEfmt ", 1, 8, file);
+  write32(16);
+  write16(1); // PCM
+  write16(2); // Stereo
+  write32(sample_rate);
+  write32(sample_rate * 2 * sizeof(s16));
+  write16(2 * sizeof(s16));
+  write16(16);
+  std::fwrite("data", 1, 4, file);
+  write32(data_size);
+  std::fwrite(samples.data(), sizeof(s16), samples.size(), file);
+  std::fclose(file);
+}
+
+/// Writes the backup memory of the emulator, which the headless runner keeps in memory only.
+void write_save(fs::path const& path, nba::Emulator& emulator) {
+  auto state = std::make_unique<nba::SaveState>();
+
+  emulator.CopyState(*state);
+  if (state->backup.size == 0) {
+    return;
+  }
+
+  auto file = std::fopen(path.string().c_str(), "wb");
+  if (file == nullptr) {
+    LOG_ERROR("Unable to create save file: {0}", path.string());
+    return;
+  }
+
+  std::fwrite(state->backup.data, 1, state->backup.size, file);
+  std::fclose(file);
+}
+
+auto load_golden_hashes(fs::path const& path) -> std::vector<std::string> {
+  auto hashes = std::vector<std::string>{};
+  auto stream = std::ifstream{path};
+  auto line = std::string{};
+
+  while (std::getline(stream, line)) {
+    hashes.push_back(line);
+  }
+  return hashes;
+}
+
+void report(std::string const& message) {
+  static std::mutex mutex;
+  std::lock_guard guard{mutex};
+  fmt::print("{0}\n", message);
+}
+
+bool run_rom(std::string const& rom_path) {
+  // The path outlives the trace, since it is one of g_rom_paths.
+  common::trace::Scope trace{"headless", rom_path.c_str()};
+  auto output_path = fs::path{g_output_path} / fs::path{rom_path}.stem();
+  auto script_path = fs::path{rom_path}.replace_extension(".input");
+  auto movie_path = g_movie_path.empty() ? fs::path{rom_path}.replace_extension(".nbm") : fs::path{g_movie_path};
+  auto movie = nba::Movie{};
+  auto input_script = g_input_script;
+  auto golden_path = fs::path{g_golden_path} / fs::path{rom_path}.stem() / "frames.txt";
+  auto golden_hashes = std::vector<std::string>{};
+  auto config = std::make_shared<nba::Config>(*g_config);
+  auto audio_dev = std::make_shared<CaptureAudioDevice>();
+  auto input_dev = std::make_shared<ScriptedInputDevice>();
+  auto video_dev = std::make_shared<CaptureVideoDevice>();
+
+  fs::create_directories(output_path);
+
+  // Every ROM gets its own log, since the ROMs are run in parallel.
+  auto log = std::ofstream{output_path / "log.txt"};
+  common::logger::set_thread_sink([&](common::logger::Level, std::string const& line) {
+    log << line << '\n';
+  });
+
+  config->audio_dev = audio_dev;
+  config->input_dev = input_dev;
+  config->video_dev = video_dev;
+  config->memory_save = true;
+  config->rewind.enable = false;
+  config->run_ahead = 0;
+
+  auto emulator = std::make_unique<nba::Emulator>(config);
+
+  if (emulator->LoadGame(rom_path) != nba::Emulator::StatusCode::Ok) {
+    common::logger::set_thread_sink({});
+    LOG_ERROR("Cannot load ROM: {0}", rom_path);
+    return false;
+  }
+
+  if (g_input_path.empty() && fs::exists(script_path)) {
+    auto error = std::string{};
+    if (!parse_input_script(script_path.string(), input_script, error)) {
+      common::logger::set_thread_sink({});
+      report(fmt::format("FAIL {0}: {1}", rom_path, error));
+      return false;
+    }
+  }
+
+  if (!g_golden_path.empty()) {
+    golden_hashes = load_golden_hashes(golden_path);
+    if (golden_hashes.empty()) {
+      common::logger::set_thread_sink({});
+      report(fmt::format("FAIL {0}: no golden hashes in {1}", rom_path, golden_path.string()));
+      return false;
+    }
+  }
+
+  emulator->Reset();
+
+  auto play_movie = !g_movie_path.empty() || fs::exists(movie_path);
+
+  if (play_movie) {
+    if (!movie.Load(movie_path.string()) || emulator->PlayMovie(movie) != nba::Emulator::StatusCode::Ok) {
+      common::logger::set_thread_sink({});
+      report(fmt::format("FAIL {0}: cannot play movie {1}", rom_path, movie_path.string()));
+      return false;
+    }
+  } else if (g_record_movie) {
+    emulator->RecordMovie(movie, nba::Movie::Start::PowerOn);
+  }
+
+  auto hashes = std::ofstream{output_path / "frames.txt"};
+  auto input = input_script.begin();
+  auto passed = true;
+
+  for (int frame = 0; frame < g_frames; frame++) {
+    while (input != input_script.end() && input->first <= frame) {
+      input_dev->SetKeys(input->second);
+      ++input;
+    }
+
+    emulator->Frame();
+
+    auto sample_count = audio_dev->Capture(kCyclesPerFrame);
+    auto samples = audio_dev->samples.data() + audio_dev->samples.size() - sample_count;
+    auto video_hash = common::xxh64(video_dev->framebuffer, sizeof(video_dev->framebuffer));
+    auto audio_hash = common::xxh64(samples, sample_count * sizeof(s16));
+    auto line = fmt::format("{0} {1:016X} {2:016X}", frame, video_hash, audio_hash);
+
+    hashes << line << '\n';
+
+    if (!g_capture_audio) {
+      audio_dev->samples.clear();
+    }
+
+    if (std::find(g_screenshot_frames.begin(), g_screenshot_frames.end(), frame) != g_screenshot_frames.end()) {
+      write_screenshot(output_path / fmt::format("frame_{0}.ppm", frame), video_dev->framebuffer);
+    }
+
+    if (!g_golden_path.empty()) {
+      if (frame >= int(golden_hashes.size())) {
+        report(fmt::format("FAIL {0}: golden hashes end before frame {1}", rom_path, frame));
+        passed = false;
+        break;
+      }
+
+      if (line != golden_hashes[frame]) {
+        auto video_line = fmt::format("{0} {1:016X} ", frame, video_hash);
+        auto what = golden_hashes[frame].rfind(video_line, 0) == 0 ? "audio" : "video";
+        write_screenshot(output_path / fmt::format("frame_{0}.ppm", frame), video_dev->framebuffer);
+        report(fmt::format("FAIL {0}: {1} differs first at frame {2}", rom_path, what, frame));
+        passed = false;
+        break;
+      }
+    }
+  }
+
+  if (!g_golden_path.empty() && passed) {
+    report(fmt::format("PASS {0}", rom_path));
+  }
+
+  if (g_capture_audio) {
+    write_wave(output_path / "audio.wav", audio_dev->samples, audio_dev->GetSampleRate());
+  }
+
+  if (g_record_movie && !play_movie) {
+    emulator->StopMovie();
+    movie.Save((output_path / "movie.nbm").string());
+  }
+
+  // The save file is written from the in-memory backup, so that no run picks up the save of an earlier one.
+  write_save(output_path / (fs::path{rom_path}.stem().string() + ".sav"), *emulator);
+
+  emulator.reset();
+  common::logger::set_thread_sink({});
+  return passed;
+}
+
+int main(int argc, char** argv) {
+  common::logger::init();
+  g_config->rtc_base_time = kDefaultRTCBaseTime;
+  parse_arguments(argc, argv);
+
+  auto jobs = g_jobs > 0 ? g_jobs : std::max(1, int(std::thread::hardware_concurrency()));
+  auto next_rom = std::atomic<size_t>{0};
+  auto failures = std::atomic<int>{0};
+  auto threads = std::vector<std::thread>{};
+
+  if (!g_trace_path.empty() && !common::trace::start(g_trace_path)) {
+    fmt::print("Cannot write trace: {0}\n", g_trace_path);
+    return -2;
+  }
+
+  for (int i = 0; i < std::min(jobs, int(g_rom_paths.size())); i++) {
+    threads.emplace_back([&, i]() {
+      common::trace::set_thread_name(fmt::format("worker {0}", i));
+
+      size_t index;
+      while ((index = next_rom++) < g_rom_paths.size()) {
+        if (!run_rom(g_rom_paths[index])) {
+          failures++;
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  common::trace::stop();
+
+  fmt::print("Ran {0} ROM(s) for {1} frames, {2} failed.\n", g_rom_paths.size(), g_frames, failures.load());
+  return failures == 0 ? 0 : 1;
+}
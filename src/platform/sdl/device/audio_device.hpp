@@ -73,13 +73,16 @@ struct SDL2_AudioDevice : public nba::AudioDevice {
   }
 
   void Close() {
-    SDL_CloseAudioDevice(device);
+    if (device != 0) {
+      SDL_CloseAudioDevice(device);
+      device = 0;
+    }
   }
 
 private:
   Callback callback;
   void* callback_userdata;
   SDL_AudioCallback passthrough = nullptr;
-  SDL_AudioDeviceID device;
+  SDL_AudioDeviceID device = 0;
   SDL_AudioSpec have;
 };
@@ -7,6 +7,7 @@
 
 #include <atomic>
 #include <common/log.hpp>
+#include <common/trace.hpp>
 #include <cstdlib>
 #include <cstring>
 #include <emulator/config/config_toml.hpp>
@@ -39,12 +40,15 @@ static auto g_swap_interval = 1;
 
 static std::atomic_bool g_sync_to_audio = true;
 static int g_cycles_per_audio_frame = 0;
+static auto g_audio_thread_named = false;
+static auto g_trace_path = std::string{};
 
 static auto g_keyboard_input_device = nba::BasicInputDevice{};
 static auto g_controller_input_device = nba::BasicInputDevice{};
 static SDL_GameController* g_game_controller = nullptr;
 static auto g_game_controller_button_x_old = false;
 static auto g_fastforward = false;
+static auto g_rewind = false;
 
 static auto g_config = std::make_shared<nba::Config>();
 static auto g_emulator = std::make_unique<nba::Emulator>(g_config);
@@ -54,6 +58,7 @@ struct KeyMap {
   SDL_Keycode fastforward = SDLK_SPACE;
   SDL_Keycode reset = SDLK_F9;
   SDL_Keycode fullscreen = SDLK_F10;
+  SDL_Keycode rewind = SDLK_r;
   std::unordered_map<SDL_Keycode, nba::InputDevice::Key> gba;
 } keymap;
 
@@ -83,7 +88,7 @@ void update_controller();
 void audio_passthrough(SDL2_AudioDevice* audio_device, s16* stream, int byte_len);
 
 void usage(char* app_name) {
-  fmt::print("Usage: {0} [--bios bios_path] [--force-rtc] [--save-type type] [--fullscreen] [--scale factor] [--resampler type] [--sync-to-audio yes/no] rom_path\n", app_name);
+  fmt::print("Usage: {0} [--bios bios_path] [--force-rtc] [--save-type type] [--fullscreen] [--scale factor] [--resampler type] [--sync-to-audio yes/no] [--trace path] rom_path\n", app_name);
   std::exit(-1);
 }
 
@@ -119,6 +124,11 @@ void parse_arguments(int argc, char** argv) {
       } else {
         usage(argv[0]);
       }
+    } else if (key == "--trace") {
+      if (i == limit) {
+        usage(argv[0]);
+      }
+      g_trace_path = std::string{argv[i++]};
     } else if (key == "--force-rtc") {
       g_config->force_rtc = true;
     } else if (key == "--save-type") {
@@ -208,6 +218,7 @@ void load_keymap() {
       keymap.fastforward = SDL_GetKeyFromName(toml::find_or<std::string>(general, "fastforward", "Space").c_str());
       keymap.reset = SDL_GetKeyFromName(toml::find_or<std::string>(general, "reset", "F9").c_str());
       keymap.fullscreen = SDL_GetKeyFromName(toml::find_or<std::string>(general, "fullscreen", "F10").c_str());
+      keymap.rewind = SDL_GetKeyFromName(toml::find_or<std::string>(general, "rewind", "R").c_str());
     }
   }
 
@@ -271,6 +282,10 @@ void init(int argc, char** argv) {
   common::logger::init();
   config_toml_read(*g_config, "config.toml");
   parse_arguments(argc, argv);
+  if (!g_trace_path.empty()) {
+    common::trace::start(g_trace_path);
+    common::trace::set_thread_name("main");
+  }
   load_keymap();
   SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER);
   g_window = SDL_CreateWindow("NanoBoyAdvance",
@@ -349,9 +364,13 @@ void loop() {
     update_controller();
     if (!g_sync_to_audio) {
       g_emulator_lock.lock();
+      if (g_rewind) {
+        g_emulator->StepBack();
+      }
       g_emulator->Frame();
       g_emulator_lock.unlock();
     }
+    common::trace::begin("frontend", "present");
     update_viewport();
     glClear(GL_COLOR_BUFFER_BIT);
     glBindTexture(GL_TEXTURE_2D, g_gl_texture);
@@ -377,6 +396,7 @@ void loop() {
     glVertex2f(-1.0f, -1.0f);
     glEnd();
     SDL_GL_SwapWindow(g_window);
+    common::trace::end("frontend", "present");
     auto ticks_end = SDL_GetTicks();
     if ((ticks_end - ticks_start) >= 1000) {
       auto title = fmt::format("NanoBoyAdvance [{0} fps | {1}%]", g_frame_counter, int(g_frame_counter / 60.0 * 100.0));
@@ -396,15 +416,24 @@ void loop() {
 void destroy() {
   // Make sure that the audio thread no longer accesses the emulator.
   g_emulator_lock.lock();
+  if (g_config->suspend_resume) {
+    g_emulator->Suspend();
+  }
   if (g_game_controller != nullptr) {
     SDL_GameControllerClose(g_game_controller);
   }
   SDL_GL_DeleteContext(g_gl_context);
   SDL_DestroyWindow(g_window);
   SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER);
+  common::trace::stop();
 }
 
 void audio_passthrough(SDL2_AudioDevice* audio_device, s16* stream, int byte_len) {
+  if (!g_audio_thread_named) {
+    common::trace::set_thread_name("audio");
+    g_audio_thread_named = true;
+  }
+
   if (g_sync_to_audio) {
     g_emulator_lock.lock();
     g_emulator->Run(g_cycles_per_audio_frame);
@@ -428,7 +457,7 @@ void update_viewport() {
 
 void update_fastforward(bool fastforward) {
   g_fastforward = fastforward;
-  g_sync_to_audio = !fastforward && g_config->sync_to_audio;
+  g_sync_to_audio = !fastforward && !g_rewind && g_config->sync_to_audio;
   if (fastforward) {
     SDL_GL_SetSwapInterval(0);
   } else {
@@ -436,6 +465,12 @@ void update_fastforward(bool fastforward) {
   }
 }
 
+// While rewinding the emulator is driven by the main loop, one snapshot per frame.
+void update_rewind(bool rewind) {
+  g_rewind = rewind;
+  g_sync_to_audio = !rewind && !g_fastforward && g_config->sync_to_audio;
+}
+
 void update_key(SDL_KeyboardEvent* event) {
   bool pressed = event->type == SDL_KEYDOWN;
   auto key = event->keysym.sym;
@@ -444,6 +479,10 @@ void update_key(SDL_KeyboardEvent* event) {
     update_fastforward(pressed);
   }
 
+  if (key == keymap.rewind) {
+    update_rewind(pressed);
+  }
+
   if (key == keymap.reset && !pressed) {
     g_emulator_lock.lock();
     g_emulator->Reset();
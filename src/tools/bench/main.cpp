@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <common/trace.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <emulator/emulator.hpp>
+#include <fmt/format.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using BusStats = nba::core::BusStats;
+using Subsystem = nba::core::Profiler::Subsystem;
+
+static constexpr auto kFramesPerSecond = 16777216.0 / 280896.0;
+
+static const std::pair<Subsystem, const char*> g_subsystems[] {
+  { Subsystem::ARM,       "arm"       },
+  { Subsystem::Scheduler, "scheduler" },
+  { Subsystem::PPU,       "ppu"       },
+  { Subsystem::APU,       "apu"       },
+  { Subsystem::DMA,       "dma"       },
+  { Subsystem::Timer,     "timer"     },
+  { Subsystem::IRQ,       "irq"       },
+  { Subsystem::Serial,    "serial"    }
+};
+
+/// Memory regions as seen by the bus stats, a bit for each of address bits 24-27 (bit 16 for above).
+static const std::pair<u32, const char*> g_regions[] {
+  { 1 << 0x0,             "bios"    },
+  { 1 << 0x2,             "ewram"   },
+  { 1 << 0x3,             "iwram"   },
+  { 1 << 0x4,             "mmio"    },
+  { 1 << 0x5,             "pram"    },
+  { 1 << 0x6,             "vram"    },
+  { 1 << 0x7,             "oam"     },
+  { 3 << 0x8,             "rom-ws0" },
+  { 3 << 0xA,             "rom-ws1" },
+  { 3 << 0xC,             "rom-ws2" },
+  { 3 << 0xE,             "sram"    },
+  { 1 << 0x1 | 1 << 16,   "unused"  }
+};
+
+static const char* g_occasions[] {
+  "immediate", "vblank", "hblank", "fifo", "video"
+};
+
+static auto g_config = std::make_shared<nba::Config>();
+static auto g_rom_path = std::string{};
+static auto g_state_path = std::string{};
+static auto g_movie_path = std::string{};
+static auto g_json_path = std::string{};
+static auto g_guest_profile_path = std::string{};
+static auto g_trace_path = std::string{};
+static auto g_frames = 0;
+static auto g_warmup = 0;
+static auto g_runs = 3;
+
+struct Result {
+  double seconds;
+  u64 nanoseconds[int(Subsystem::Count)];
+};
+
+void usage(char* app_name) {
+  fmt::print("Usage: {0} [--bios bios_path] [--skip-bios] [--state state_path] [--movie movie_path] [--warmup frames] [--frames count] [--runs count] [--json path] [--guest-profile path] [--trace path] rom_path\n", app_name);
+  fmt::print("\nEach run starts from the save state (e.g. a suspended session) if given,\n"
+             "otherwise from power-on plus the warm-up frames.\n"
+             "With a movie, each run plays it back from its start state instead,\n"
+             "for as many frames as the movie lasts unless --frames is given.\n");
+  std::exit(-1);
+}
+
+void parse_arguments(int argc, char** argv) {
+  auto i = 1;
+
+  auto next = [&]() -> std::string {
+    if (i == argc) {
+      usage(argv[0]);
+    }
+    return argv[i++];
+  };
+
+  while (i < argc) {
+    auto key = std::string{argv[i++]};
+    if (key == "--bios") {
+      g_config->bios_path = next();
+    } else if (key == "--skip-bios") {
+      g_config->skip_bios = true;
+    } else if (key == "--state") {
+      g_state_path = next();
+    } else if (key == "--movie") {
+      g_movie_path = next();
+    } else if (key == "--warmup") {
+      g_warmup = std::atoi(next().c_str());
+    } else if (key == "--frames") {
+      g_frames = std::atoi(next().c_str());
+    } else if (key == "--runs") {
+      g_runs = std::atoi(next().c_str());
+    } else if (key == "--json") {
+      g_json_path = next();
+    } else if (key == "--guest-profile") {
+      g_guest_profile_path = next();
+    } else if (key == "--trace") {
+      g_trace_path = next();
+    } else if (key.rfind("--", 0) == 0 || !g_rom_path.empty()) {
+      usage(argv[0]);
+    } else {
+      g_rom_path = key;
+    }
+  }
+
+  if (g_rom_path.empty() || g_frames < 0 || g_runs <= 0 || (!g_movie_path.empty() && !g_state_path.empty())) {
+    usage(argv[0]);
+  }
+
+  // A movie lasts as long as it was recorded for by default.
+  if (g_frames == 0 && g_movie_path.empty()) {
+    g_frames = 3600;
+  }
+}
+
+auto load_state(std::string const& path) -> std::unique_ptr<nba::SaveState> {
+  auto state = std::make_unique<nba::SaveState>();
+  auto stream = std::ifstream{path, std::ios::binary};
+
+  stream.read((char*)state.get(), sizeof(nba::SaveState));
+  if (!stream.good()) {
+    fmt::print("Cannot read save state: {0}\n", path);
+    std::exit(-2);
+  }
+  return state;
+}
+
+/// Starts from the state if there is one, otherwise from the movie.
+auto run(nba::Emulator& emulator, nba::SaveState const* state, nba::Movie const& movie) -> Result {
+  auto result = Result{};
+  auto& profiler = emulator.GetProfiler();
+
+  if (state) {
+    emulator.LoadState(*state);
+  } else {
+    emulator.PlayMovie(movie);
+  }
+  profiler.Reset();
+  emulator.GetBusStats().Reset();
+  emulator.GetGuestProfiler().Reset();
+  emulator.ResetStats();
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < g_frames; i++) {
+    emulator.Frame();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  result.seconds = std::chrono::duration<double>(t1 - t0).count();
+  for (int i = 0; i < int(Subsystem::Count); i++) {
+    result.nanoseconds[i] = profiler.GetNanoseconds(Subsystem(i));
+  }
+  return result;
+}
+
+auto json_escape(std::string const& value) -> std::string {
+  auto escaped = std::string{};
+  for (auto c : value) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+struct RegionStats {
+  const char* name;
+  u64 cycles = 0;
+  u64 accesses[2] {};
+  u64 widths[int(BusStats::Width::Count)] {};
+};
+
+auto collect_regions(BusStats const& stats) -> std::vector<RegionStats> {
+  auto regions = std::vector<RegionStats>{};
+
+  for (auto& [mask, name] : g_regions) {
+    auto region = RegionStats{name};
+
+    for (int i = 0; i < BusStats::kRegionCount; i++) {
+      if (~mask & (1 << i)) {
+        continue;
+      }
+      for (int sequential = 0; sequential < 2; sequential++) {
+        for (int width = 0; width < int(BusStats::Width::Count); width++) {
+          auto& counter = stats.GetCounter(i, sequential, BusStats::Width(width));
+          region.cycles += counter.cycles;
+          region.accesses[sequential] += counter.accesses;
+          region.widths[width] += counter.accesses;
+        }
+      }
+    }
+
+    if (region.accesses[0] + region.accesses[1] != 0) {
+      regions.push_back(region);
+    }
+  }
+  return regions;
+}
+
+void report_bus_stats(BusStats const& stats) {
+  auto regions = collect_regions(stats);
+  auto& prefetch = stats.GetPrefetch();
+  auto fetches = prefetch.hits + prefetch.stalls + prefetch.misses;
+
+  // Frames do not end exactly on a cycle boundary, so this is not exactly frames * cycles per frame.
+  auto total = double(stats.GetInternalCycles() + stats.GetHaltCycles());
+  for (auto& region : regions) {
+    total += region.cycles;
+  }
+
+  fmt::print("  bus cycles in the last run ({0:.0f}):\n", total);
+  fmt::print("    {0:<9} {1:>12} {2:>6} {3:>11} {4:>11} {5:>11} {6:>11} {7:>11}\n",
+    "region", "cycles", "%", "N", "S", "8-bit", "16-bit", "32-bit");
+
+  for (auto& region : regions) {
+    fmt::print("    {0:<9} {1:12} {2:5.1f}% {3:11} {4:11} {5:11} {6:11} {7:11}\n",
+      region.name, region.cycles, region.cycles / total * 100.0, region.accesses[0], region.accesses[1],
+      region.widths[0], region.widths[1], region.widths[2]);
+  }
+
+  fmt::print("    {0:<9} {1:12} {2:5.1f}%\n", "internal", stats.GetInternalCycles(), stats.GetInternalCycles() / total * 100.0);
+  fmt::print("    {0:<9} {1:12} {2:5.1f}%\n", "halted", stats.GetHaltCycles(), stats.GetHaltCycles() / total * 100.0);
+
+  fmt::print("  prefetch: {0} hits, {1} stalls, {2} misses ({3:.1f}% hit rate), {4} flushes\n",
+    prefetch.hits, prefetch.stalls, prefetch.misses,
+    fetches == 0 ? 0.0 : (prefetch.hits + prefetch.stalls) * 100.0 / fetches, prefetch.flushes);
+
+  for (int channel = 0; channel < 4; channel++) {
+    for (int occasion = 0; occasion < int(BusStats::Occasion::Count); occasion++) {
+      auto& transfer = stats.GetTransfer(channel, BusStats::Occasion(occasion));
+      if (transfer.units != 0) {
+        fmt::print("  dma{0} {1:<9} {2:10} transfers {3:12} units {4:12} cycles {5:5.1f}%\n",
+          channel, g_occasions[occasion], transfer.transfers, transfer.units, transfer.cycles, transfer.cycles / total * 100.0);
+      }
+    }
+  }
+}
+
+auto bus_stats_json(BusStats const& stats) -> std::string {
+  auto& prefetch = stats.GetPrefetch();
+  auto json = std::string{",\n  \"bus\": {\n    \"regions\": {"};
+  auto first = true;
+
+  for (auto& region : collect_regions(stats)) {
+    json += fmt::format("{0}\n      \"{1}\": {{ \"cycles\": {2}, \"n\": {3}, \"s\": {4}, \"8\": {5}, \"16\": {6}, \"32\": {7} }}",
+      first ? "" : ",", region.name, region.cycles, region.accesses[0], region.accesses[1],
+      region.widths[0], region.widths[1], region.widths[2]);
+    first = false;
+  }
+
+  json += fmt::format("\n    }},\n    \"internal\": {0},\n    \"halted\": {1},", stats.GetInternalCycles(), stats.GetHaltCycles());
+  json += fmt::format("\n    \"prefetch\": {{ \"hits\": {0}, \"stalls\": {1}, \"misses\": {2}, \"flushes\": {3} }},",
+    prefetch.hits, prefetch.stalls, prefetch.misses, prefetch.flushes);
+  json += "\n    \"dma\": [";
+  first = true;
+
+  for (int channel = 0; channel < 4; channel++) {
+    for (int occasion = 0; occasion < int(BusStats::Occasion::Count); occasion++) {
+      auto& transfer = stats.GetTransfer(channel, BusStats::Occasion(occasion));
+      if (transfer.units != 0) {
+        json += fmt::format("{0}\n      {{ \"channel\": {1}, \"occasion\": \"{2}\", \"transfers\": {3}, \"units\": {4}, \"cycles\": {5} }}",
+          first ? "" : ",", channel, g_occasions[occasion], transfer.transfers, transfer.units, transfer.cycles);
+        first = false;
+      }
+    }
+  }
+  json += "\n    ]\n  }";
+  return json;
+}
+
+void report_stats(nba::core::Stats const& stats) {
+  auto events = u64(0);
+  for (auto count : stats.events) {
+    events += count;
+  }
+
+  fmt::print("  last run: {0} ARM + {1} Thumb instructions, {2} events, {3} scanlines ({4} skipped), {5} DMA units\n",
+    stats.arm_instructions, stats.thumb_instructions, events, stats.scanlines_rendered, stats.scanlines_skipped, stats.dma_units);
+  fmt::print("  audio: {0} samples, {1} dropped, {2} underruns; frame time: {3:.3f} ms average, {4:.3f} ms max\n",
+    stats.audio_samples, stats.audio_samples_dropped, stats.audio_underruns,
+    stats.frames == 0 ? 0.0 : stats.frame_time_total / 1e6 / stats.frames, stats.frame_time_max / 1e6);
+}
+
+auto stats_json(nba::core::Stats const& stats) -> std::string {
+  auto events = std::string{};
+  for (int i = 0; i < int(nba::core::Scheduler::EventClass::Count); i++) {
+    events += fmt::format("{0}{1}", i == 0 ? "" : ", ", stats.events[i]);
+  }
+
+  return fmt::format(",\n  \"stats\": {{\n    \"arm_instructions\": {0},\n    \"thumb_instructions\": {1},"
+    "\n    \"events\": [{2}],\n    \"scanlines_rendered\": {3},\n    \"scanlines_skipped\": {4},"
+    "\n    \"audio_samples\": {5},\n    \"audio_samples_dropped\": {6},\n    \"audio_underruns\": {7},"
+    "\n    \"dma_units\": {8},\n    \"frame_time_max\": {9}\n  }}",
+    stats.arm_instructions, stats.thumb_instructions, events, stats.scanlines_rendered, stats.scanlines_skipped,
+    stats.audio_samples, stats.audio_samples_dropped, stats.audio_underruns, stats.dma_units, stats.frame_time_max);
+}
+
+void report(std::vector<Result>& results, BusStats const& bus_stats, nba::core::Stats const& stats) {
+  // The median run is the least affected by noise on the host.
+  std::sort(results.begin(), results.end(), [](auto const& a, auto const& b) {
+    return a.seconds < b.seconds;
+  });
+
+  auto& median = results[results.size() / 2];
+  auto fps = g_frames / median.seconds;
+
+  fmt::print("{0}: {1} frames in {2:.3f} s, {3:.1f} fps ({4:.0f}% speed), median of {5} run(s)\n",
+    g_rom_path, g_frames, median.seconds, fps, fps / kFramesPerSecond * 100.0, results.size());
+
+  if (nba::core::Profiler::kEnabled) {
+    for (auto& [subsystem, name] : g_subsystems) {
+      auto seconds = median.nanoseconds[int(subsystem)] / 1e9;
+      fmt::print("  {0:<10} {1:8.3f} s {2:5.1f}%\n", name, seconds, seconds / median.seconds * 100.0);
+    }
+  } else {
+    fmt::print("  (configure with ENABLE_PROFILER=ON for a per-subsystem breakdown)\n");
+  }
+
+  report_stats(stats);
+
+  if (BusStats::kEnabled) {
+    report_bus_stats(bus_stats);
+  } else {
+    fmt::print("  (configure with ENABLE_BUS_STATS=ON for bus, prefetch and DMA counters)\n");
+  }
+
+  if (g_json_path.empty()) {
+    return;
+  }
+
+  auto json = fmt::format("{{\n  \"rom\": \"{0}\",\n  \"frames\": {1},\n  \"runs\": {2},\n  \"seconds\": {3:.6f},\n  \"fps\": {4:.3f}",
+    json_escape(g_rom_path), g_frames, results.size(), median.seconds, fps);
+
+  if (nba::core::Profiler::kEnabled) {
+    json += ",\n  \"subsystems\": {";
+    for (auto& [subsystem, name] : g_subsystems) {
+      json += fmt::format("{0}\n    \"{1}\": {2:.6f}", &subsystem == &g_subsystems[0].first ? "" : ",",
+        name, median.nanoseconds[int(subsystem)] / 1e9);
+    }
+    json += "\n  }";
+  }
+  json += stats_json(stats);
+  if (BusStats::kEnabled) {
+    json += bus_stats_json(bus_stats);
+  }
+  json += "\n}\n";
+
+  auto file = std::ofstream{g_json_path};
+  file << json;
+  if (!file.good()) {
+    fmt::print("Cannot write JSON report: {0}\n", g_json_path);
+    std::exit(-2);
+  }
+}
+
+/// Writes the profile of the last run, the ROM coverage bitmap goes next to it.
+void write_guest_profile(nba::Emulator& emulator) {
+  if (!nba::core::GuestProfiler::kEnabled) {
+    fmt::print("  (configure with ENABLE_GUEST_PROFILER=ON for a guest profile)\n");
+    return;
+  }
+
+  auto report = std::ofstream{g_guest_profile_path};
+  auto coverage = std::ofstream{g_guest_profile_path + ".cov", std::ios::binary};
+
+  emulator.WriteGuestProfile(report, coverage);
+  if (!report.good() || !coverage.good()) {
+    fmt::print("Cannot write guest profile: {0}\n", g_guest_profile_path);
+    std::exit(-2);
+  }
+}
+
+int main(int argc, char** argv) {
+  parse_arguments(argc, argv);
+
+  // Every run must start from the same erased backup, whatever earlier runs saved.
+  g_config->memory_save = true;
+  g_config->analysis_cache_path = "";
+
+  auto emulator = std::make_unique<nba::Emulator>(g_config);
+
+  if (emulator->LoadGame(g_rom_path) != nba::Emulator::StatusCode::Ok) {
+    fmt::print("Cannot load ROM: {0}\n", g_rom_path);
+    return -2;
+  }
+
+  emulator->Reset();
+
+  auto state = std::unique_ptr<nba::SaveState>{};
+  auto movie = nba::Movie{};
+
+  if (!g_movie_path.empty()) {
+    if (!movie.Load(g_movie_path) || emulator->PlayMovie(movie) != nba::Emulator::StatusCode::Ok) {
+      fmt::print("Movie does not belong to this ROM or is damaged: {0}\n", g_movie_path);
+      return -2;
+    }
+    if (g_frames == 0) {
+      g_frames = std::max(1, movie.GetFrameCount());
+    }
+  } else if (!g_state_path.empty()) {
+    state = load_state(g_state_path);
+    if (emulator->LoadState(*state) != nba::Emulator::StatusCode::Ok) {
+      fmt::print("Save state does not belong to this ROM or is damaged: {0}\n", g_state_path);
+      return -2;
+    }
+  } else {
+    for (int i = 0; i < g_warmup; i++) {
+      emulator->Frame();
+    }
+    state = std::make_unique<nba::SaveState>();
+    emulator->CopyState(*state);
+  }
+
+  // Only the timed runs are traced.
+  if (!g_trace_path.empty() && !common::trace::start(g_trace_path)) {
+    fmt::print("Cannot write trace: {0}\n", g_trace_path);
+    return -2;
+  }
+
+  auto results = std::vector<Result>{};
+  for (int i = 0; i < g_runs; i++) {
+    results.push_back(run(*emulator, state.get(), movie));
+  }
+
+  common::trace::stop();
+
+  report(results, emulator->GetBusStats(), emulator->GetStats());
+
+  if (!g_guest_profile_path.empty()) {
+    write_guest_profile(*emulator);
+  }
+  return 0;
+}
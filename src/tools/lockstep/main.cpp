@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <common/log.hpp>
+#include <cstdlib>
+#include <emulator/lockstep.hpp>
+#include <filesystem>
+#include <fmt/format.h>
+#include <string>
+
+namespace fs = std::filesystem;
+
+static constexpr auto kCyclesPerFrame = 280896;
+
+static auto g_config = std::make_shared<nba::Config>();
+static auto g_rom_path = std::string{};
+static auto g_frames = 3600;
+
+void usage(char* app_name) {
+  fmt::print("Usage: {0} [--bios bios_path] [--skip-bios] [--frames count] rom_path\n", app_name);
+  fmt::print("\nRuns the game on the fast and the reference paths of the core side by side\n"
+             "and stops at the first block where the two differ.\n");
+  std::exit(-1);
+}
+
+void parse_arguments(int argc, char** argv) {
+  auto i = 1;
+
+  auto next = [&]() -> std::string {
+    if (i == argc) {
+      usage(argv[0]);
+    }
+    return argv[i++];
+  };
+
+  while (i < argc) {
+    auto key = std::string{argv[i++]};
+    if (key == "--bios") {
+      g_config->bios_path = next();
+    } else if (key == "--skip-bios") {
+      g_config->skip_bios = true;
+    } else if (key == "--frames") {
+      g_frames = std::atoi(next().c_str());
+    } else if (key.rfind("--", 0) == 0 || !g_rom_path.empty()) {
+      usage(argv[0]);
+    } else {
+      g_rom_path = key;
+    }
+  }
+
+  if (g_rom_path.empty() || g_frames <= 0) {
+    usage(argv[0]);
+  }
+}
+
+int main(int argc, char** argv) {
+  common::logger::init();
+  parse_arguments(argc, argv);
+
+  // Keep the save file of the checked game out of the way.
+  g_config->save_folder = fs::temp_directory_path().string();
+
+  auto lockstep = std::make_unique<nba::Lockstep>(g_config);
+
+  if (lockstep->LoadGame(g_rom_path) != nba::Emulator::StatusCode::Ok) {
+    fmt::print("Cannot load ROM: {0}\n", g_rom_path);
+    return -2;
+  }
+
+  lockstep->Reset();
+
+  for (int frame = 0; frame < g_frames; frame++) {
+    if (!lockstep->Run(kCyclesPerFrame)) {
+      fmt::print("{0}: diverged in frame {1}.\n", g_rom_path, frame);
+      return 1;
+    }
+  }
+
+  fmt::print("{0}: {1} frames ({2} blocks) without divergence.\n", g_rom_path, g_frames, lockstep->GetBlockCount());
+  return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <common/punning.hpp>
+
+#include "kernel.hpp"
+
+using nba::core::CPU;
+
+auto make_cpu(std::vector<u32> const& program) -> std::unique_ptr<CPU> {
+  auto config = std::make_shared<nba::Config>();
+  auto rom = std::vector<u8>(0x1000);
+
+  for (size_t i = 0; i < program.size(); i++) {
+    common::write<u32>(rom.data(), i * sizeof(u32), program[i]);
+  }
+
+  config->skip_bios = true;
+
+  auto cpu = std::make_unique<CPU>(config);
+  cpu->game_pak = nba::GamePak{std::make_shared<nba::ROM const>(std::move(rom)), nba::RomAnalysis{}, nullptr, nullptr};
+  cpu->Reset();
+  return cpu;
+}
+
+namespace {
+
+static constexpr int kCyclesPerFrame = 280896;
+
+/**
+ * Runs a program from ROM, which increments a counter in IWRAM
+ * once for every pass over its main loop.
+ */
+struct Program : Kernel {
+  Program(std::vector<u32> const& program, u32 counter_address, u64 ops_per_pass)
+      : cpu(make_cpu(program))
+      , counter_address(counter_address)
+      , ops_per_pass(ops_per_pass) {
+  }
+
+  auto Run() -> u64 final {
+    cpu->RunFor(kCyclesPerFrame);
+
+    auto counter = common::read<u32>(cpu->memory.iram, counter_address & 0x7FFF);
+    auto passes = counter - last_counter;
+    last_counter = counter;
+    return passes * ops_per_pass;
+  }
+
+private:
+  std::unique_ptr<CPU> cpu;
+  u32 counter_address;
+  u32 last_counter = 0;
+  u64 ops_per_pass;
+};
+
+/// Five ARM data processing and store instructions per pass.
+static const std::vector<u32> g_arm_program {
+  0xE3A02403, //      mov r2, #0x03000000
+  0xE3A00000, //      mov r0, #0
+  0xE2800001, // 1:   add r0, r0, #1
+  0xE0211000, //      eor r1, r1, r0
+  0xE1A011E1, //      mov r1, r1, ror #3
+  0xE5820000, //      str r0, [r2]
+  0xEAFFFFFA  //      b 1b
+};
+
+/// Five Thumb ALU and store instructions per pass.
+static const std::vector<u32> g_thumb_program {
+  0xE3A02403, //      mov r2, #0x03000000
+  0xE3A00000, //      mov r0, #0
+  0xE28F1001, //      add r1, pc, #1
+  0xE12FFF11, //      bx r1
+  0x40413001, // 1:   adds r0, #1 / eors r1, r0
+  0x601041C9, //      rors r1, r1 / str r0, [r2]
+  0x0000E7FA  //      b 1b
+};
+
+/// Copies 16 KiB from EWRAM to IWRAM with DMA3 per pass.
+static const std::vector<u32> g_dma_program {
+  0xE59F0020, //      ldr r0, =0x040000D4
+  0xE59F1020, //      ldr r1, =0x02000000
+  0xE59F2020, //      ldr r2, =0x03000000
+  0xE59F3020, //      ldr r3, =0x84001000
+  0xE2825A07, //      add r5, r2, #0x7000
+  0xE3A04000, //      mov r4, #0
+  0xE880000E, // 1:   stmia r0, {r1-r3}
+  0xE2844001, //      add r4, r4, #1
+  0xE5854000, //      str r4, [r5]
+  0xEAFFFFFB, //      b 1b
+  0x040000D4,
+  0x02000000,
+  0x03000000,
+  0x84001000
+};
+
+} // anonymous namespace
+
+void register_cpu_kernels(std::vector<KernelInfo>& kernels) {
+  kernels.push_back({"cpu/arm", "instruction", []() {
+    return std::make_unique<Program>(g_arm_program, 0x03000000, 5);
+  }});
+
+  kernels.push_back({"cpu/thumb", "instruction", []() {
+    return std::make_unique<Program>(g_thumb_program, 0x03000000, 5);
+  }});
+
+  kernels.push_back({"dma/ewram-to-iwram", "word", []() {
+    return std::make_unique<Program>(g_dma_program, 0x03007000, 0x1000);
+  }});
+}
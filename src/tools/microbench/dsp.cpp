@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <cmath>
+#include <common/dsp/resampler/blep.hpp>
+#include <common/dsp/resampler/cubic.hpp>
+#include <common/dsp/resampler/windowed-sinc.hpp>
+#include <common/dsp/ring_buffer.hpp>
+
+#include "kernel.hpp"
+
+using namespace common::dsp;
+
+namespace {
+
+static constexpr int kSamplesPerRun = 4096;
+
+template<typename T>
+struct NullStream : WriteStream<T> {
+  void Write(T const&) final {
+    count++;
+  }
+
+  u64 count = 0;
+};
+
+/**
+ * Resamples the APU mixer output (32768 Hz) to a typical host rate,
+ * which is what the APU does for every mixed sample.
+ */
+template<typename ResamplerType>
+struct StereoResampling : Kernel {
+  StereoResampling() {
+    resampler = std::make_unique<ResamplerType>(std::make_shared<NullStream<StereoSample<float>>>());
+    resampler->SetSampleRates(32768, 48000);
+
+    for (int i = 0; i < kSamplesPerRun; i++) {
+      input[i] = { std::sin(i * 0.05f), std::cos(i * 0.03f) };
+    }
+  }
+
+  auto Run() -> u64 final {
+    for (auto& sample : input) {
+      resampler->Write(sample);
+    }
+    return kSamplesPerRun;
+  }
+
+private:
+  std::unique_ptr<StereoResampler<float>> resampler;
+  StereoSample<float> input[kSamplesPerRun];
+};
+
+/// Resamples a DMA sound FIFO (commonly 18157 Hz) to the mixer rate.
+struct FIFOResampling : Kernel {
+  FIFOResampling() : resampler(std::make_shared<NullStream<float>>()) {
+    resampler.SetSampleRates(18157, 32768);
+
+    for (int i = 0; i < kSamplesPerRun; i++) {
+      input[i] = s8(i * 37) / 128.0;
+    }
+  }
+
+  auto Run() -> u64 final {
+    for (auto sample : input) {
+      resampler.Write(sample);
+    }
+    return kSamplesPerRun;
+  }
+
+private:
+  BlepResampler<float> resampler;
+  float input[kSamplesPerRun];
+};
+
+/// Streams samples through the ring buffer that sits between the APU and the audio device.
+struct RingBufferStreaming : Kernel {
+  static constexpr int kBlockSize = 1024;
+
+  RingBufferStreaming() : buffer(kBlockSize * 4, true) {}
+
+  auto Run() -> u64 final {
+    auto sum = StereoSample<float>{};
+
+    for (int i = 0; i < kSamplesPerRun; i += kBlockSize) {
+      for (int j = 0; j < kBlockSize; j++) {
+        buffer.Write({ float(j), float(-j) });
+      }
+      for (int j = 0; j < kBlockSize; j++) {
+        sum += buffer.Read();
+      }
+    }
+
+    this->sum = sum.left + sum.right;
+    return kSamplesPerRun * 2;
+  }
+
+private:
+  StereoRingBuffer<float> buffer;
+  volatile float sum;
+};
+
+} // anonymous namespace
+
+void register_dsp_kernels(std::vector<KernelInfo>& kernels) {
+  kernels.push_back({"dsp/cubic",       "sample", []() { return std::make_unique<StereoResampling<CubicStereoResampler<float>>>(); }});
+  kernels.push_back({"dsp/sinc-32",     "sample", []() { return std::make_unique<StereoResampling<SincStereoResampler<float, 32>>>(); }});
+  kernels.push_back({"dsp/sinc-256",    "sample", []() { return std::make_unique<StereoResampling<SincStereoResampler<float, 256>>>(); }});
+  kernels.push_back({"dsp/blep",        "sample", []() { return std::make_unique<FIFOResampling>(); }});
+  kernels.push_back({"dsp/ring-buffer", "access", []() { return std::make_unique<RingBufferStreaming>(); }});
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#pragma once
+
+#include <common/integer.hpp>
+#include <emulator/core/cpu.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A self-contained harness around one hot kernel of the emulator.
+ * The harness is set up in its constructor, which is not timed.
+ */
+struct Kernel {
+  virtual ~Kernel() = default;
+
+  /// Runs one batch of work and returns the number of operations it performed.
+  virtual auto Run() -> u64 = 0;
+};
+
+struct KernelInfo {
+  std::string name;
+  std::string unit;
+  std::function<std::unique_ptr<Kernel>()> create;
+};
+
+/**
+ * Creates a CPU which runs the given ARM program from the start of an otherwise empty ROM.
+ * The BIOS is skipped and all interrupts are disabled.
+ */
+auto make_cpu(std::vector<u32> const& program) -> std::unique_ptr<nba::core::CPU>;
+
+void register_scheduler_kernels(std::vector<KernelInfo>& kernels);
+void register_dsp_kernels(std::vector<KernelInfo>& kernels);
+void register_ppu_kernels(std::vector<KernelInfo>& kernels);
+void register_cpu_kernels(std::vector<KernelInfo>& kernels);
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <string>
+#include <vector>
+
+#include "kernel.hpp"
+
+static auto g_filters = std::vector<std::string>{};
+static auto g_min_time = 0.25;
+static auto g_runs = 5;
+static auto g_list = false;
+
+void usage(char* app_name) {
+  fmt::print("Usage: {0} [--list] [--min-time seconds] [--runs count] [filter]...\n", app_name);
+  fmt::print("\nRuns every kernel whose name contains one of the filters (all kernels by default).\n"
+             "Each run repeats the kernel for at least the minimum time, the median run is reported.\n");
+  std::exit(-1);
+}
+
+void parse_arguments(int argc, char** argv) {
+  auto i = 1;
+
+  auto next = [&]() -> std::string {
+    if (i == argc) {
+      usage(argv[0]);
+    }
+    return argv[i++];
+  };
+
+  while (i < argc) {
+    auto key = std::string{argv[i++]};
+    if (key == "--list") {
+      g_list = true;
+    } else if (key == "--min-time") {
+      g_min_time = std::atof(next().c_str());
+    } else if (key == "--runs") {
+      g_runs = std::atoi(next().c_str());
+    } else if (key.rfind("--", 0) == 0) {
+      usage(argv[0]);
+    } else {
+      g_filters.push_back(key);
+    }
+  }
+
+  if (g_min_time <= 0 || g_runs <= 0) {
+    usage(argv[0]);
+  }
+}
+
+bool matches(KernelInfo const& info) {
+  if (g_filters.empty()) {
+    return true;
+  }
+  return std::any_of(g_filters.begin(), g_filters.end(), [&](auto const& filter) {
+    return info.name.find(filter) != std::string::npos;
+  });
+}
+
+/// Returns the host time per operation in nanoseconds.
+auto run(KernelInfo const& info) -> double {
+  using Clock = std::chrono::steady_clock;
+
+  auto kernel = info.create();
+  auto ops = u64(0);
+  auto seconds = 0.0;
+
+  // The first batch warms up caches and branch predictors and is not counted.
+  kernel->Run();
+
+  auto t0 = Clock::now();
+  do {
+    ops += kernel->Run();
+    seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+  } while (seconds < g_min_time);
+
+  return ops == 0 ? 0 : seconds * 1e9 / ops;
+}
+
+int main(int argc, char** argv) {
+  parse_arguments(argc, argv);
+
+  auto kernels = std::vector<KernelInfo>{};
+
+  register_scheduler_kernels(kernels);
+  register_dsp_kernels(kernels);
+  register_ppu_kernels(kernels);
+  register_cpu_kernels(kernels);
+
+  for (auto& info : kernels) {
+    if (!matches(info)) {
+      continue;
+    }
+
+    if (g_list) {
+      fmt::print("{0}\n", info.name);
+      continue;
+    }
+
+    auto results = std::vector<double>{};
+    for (int i = 0; i < g_runs; i++) {
+      results.push_back(run(info));
+    }
+
+    // The median run is the least affected by noise on the host.
+    std::sort(results.begin(), results.end());
+
+    auto median = results[results.size() / 2];
+    auto spread = results.back() - results.front();
+
+    fmt::print("{0:<22} {1:10.2f} ns/{2:<12} {3:9.2f} M{2}/s  (±{4:.1f}%)\n",
+      info.name, median, info.unit, median > 0 ? 1e3 / median : 0.0,
+      median > 0 ? spread / median * 50.0 : 0.0);
+  }
+
+  return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include "kernel.hpp"
+
+using nba::core::CPU;
+using nba::core::PPU;
+
+namespace {
+
+static constexpr int kCyclesPerFrame = 280896;
+static constexpr int kVisibleLines = 160;
+
+static u32 g_seed;
+
+auto next_random() -> u16 {
+  g_seed = g_seed * 1103515245 + 12345;
+  return u16(g_seed >> 16);
+}
+
+/**
+ * Renders frames of a synthetic scene. Only the scheduler is stepped,
+ * so the PPU (and the APU, whose events are part of every scene) run without the ARM core.
+ * "ppu/backdrop" has no layers enabled and gives the baseline for the other scenes.
+ */
+struct Scene : Kernel {
+  Scene(void (*setup)(PPU& ppu)) : cpu(make_cpu({ 0xEAFFFFFE /* b . */ })) {
+    auto& ppu = cpu->ppu;
+
+    // Every run of a scene renders the same frame.
+    g_seed = 0x12345678;
+
+    // Random tiles, maps and colors. About one in 16 pixels uses color zero and is transparent.
+    for (u32 address = 0; address < 0x18000; address += 2) {
+      ppu.WriteVRAM<u16>(address, next_random());
+    }
+    for (u32 address = 0; address < 0x400; address += 2) {
+      ppu.WritePRAM<u16>(address, next_random() & 0x7FFF);
+    }
+
+    setup(ppu);
+  }
+
+  auto Run() -> u64 final {
+    cpu->scheduler.AddCycles(kCyclesPerFrame);
+    return kVisibleLines;
+  }
+
+private:
+  std::unique_ptr<CPU> cpu;
+};
+
+void write_dispcnt(PPU& ppu, u16 value) {
+  ppu.mmio.dispcnt.Write(0, u8(value));
+  ppu.mmio.dispcnt.Write(1, u8(value >> 8));
+}
+
+void write_bgcnt(PPU& ppu, int id, u16 value) {
+  ppu.mmio.bgcnt[id].Write(0, u8(value));
+  ppu.mmio.bgcnt[id].Write(1, u8(value >> 8));
+}
+
+/// Mode 0 with four 256x256 text backgrounds (two 4bpp, two 8bpp) sharing tile data.
+void setup_text(PPU& ppu) {
+  static const u16 bgcnt[4] { 0x1C00, 0x1D81, 0x1E02, 0x1F83 };
+
+  for (int id = 0; id < 4; id++) {
+    write_bgcnt(ppu, id, bgcnt[id]);
+    ppu.mmio.bghofs[id] = id * 37;
+    ppu.mmio.bgvofs[id] = id * 11;
+  }
+  write_dispcnt(ppu, 0x0F00);
+}
+
+/// Mode 2 with two rotated and scaled 512x512 affine backgrounds.
+void setup_affine(PPU& ppu) {
+  static const s16 matrix[2][4] {
+    { 0x00F0, 0x0040, -0x0040, 0x00F0 },
+    { 0x0180, -0x0020, 0x0020, 0x0180 }
+  };
+
+  write_bgcnt(ppu, 2, 0xB080);
+  write_bgcnt(ppu, 3, 0xB481);
+
+  for (int id = 0; id < 2; id++) {
+    ppu.mmio.bgpa[id] = matrix[id][0];
+    ppu.mmio.bgpb[id] = matrix[id][1];
+    ppu.mmio.bgpc[id] = matrix[id][2];
+    ppu.mmio.bgpd[id] = matrix[id][3];
+    for (int i = 0; i < 4; i++) {
+      ppu.mmio.bgx[id].Write(i, u8(0x1000 >> (i * 8)));
+      ppu.mmio.bgy[id].Write(i, u8(0x0800 >> (i * 8)));
+    }
+  }
+  write_dispcnt(ppu, 0x0C02);
+}
+
+/// 128 sprites of random shape, size and color depth, a quarter of them affine.
+void setup_oam(PPU& ppu) {
+  for (int i = 0; i < 128; i++) {
+    auto affine = (i & 3) == 0;
+    auto attr0 = u16(next_random() % 160) | (next_random() & 0x2000) | ((next_random() % 3) << 14);
+    auto attr1 = u16(next_random() % 240) | (next_random() & 0xC000);
+    auto attr2 = u16(next_random() & 0xFFFF);
+
+    if (affine) {
+      attr0 |= 0x0100 | (next_random() & 0x0200);
+      attr1 |= (i >> 2) << 9;
+    } else {
+      attr1 |= next_random() & 0x3000;
+    }
+
+    ppu.WriteOAM<u16>(i * 8 + 0, attr0);
+    ppu.WriteOAM<u16>(i * 8 + 2, attr1);
+    ppu.WriteOAM<u16>(i * 8 + 4, attr2);
+  }
+
+  for (int group = 0; group < 32; group++) {
+    s16 matrix[4] { 0x0100, s16(group * 8), s16(-group * 8), 0x0100 };
+    for (int i = 0; i < 4; i++) {
+      ppu.WriteOAM<u16>(group * 32 + i * 8 + 6, u16(matrix[i]));
+    }
+  }
+  write_dispcnt(ppu, 0x1040);
+}
+
+/// The text scene with sprites, two windows and alpha blending on top.
+void setup_compose(PPU& ppu) {
+  setup_oam(ppu);
+  setup_text(ppu);
+
+  ppu.mmio.winh[0].Write(0, 200);
+  ppu.mmio.winh[0].Write(1, 40);
+  ppu.mmio.winv[0].Write(0, 130);
+  ppu.mmio.winv[0].Write(1, 30);
+  ppu.mmio.winh[1].Write(0, 120);
+  ppu.mmio.winh[1].Write(1, 0);
+  ppu.mmio.winv[1].Write(0, 160);
+  ppu.mmio.winv[1].Write(1, 80);
+  ppu.mmio.winin.Write(0, 0x3F);
+  ppu.mmio.winin.Write(1, 0x3E);
+  ppu.mmio.winout.Write(0, 0x1F);
+  ppu.mmio.bldcnt.Write(0, 0x51);
+  ppu.mmio.bldcnt.Write(1, 0x2E);
+  ppu.mmio.eva = 10;
+  ppu.mmio.evb = 6;
+  write_dispcnt(ppu, 0x7F40);
+}
+
+} // anonymous namespace
+
+void register_ppu_kernels(std::vector<KernelInfo>& kernels) {
+  kernels.push_back({"ppu/backdrop", "scanline", []() { return std::make_unique<Scene>([](PPU&) {}); }});
+  kernels.push_back({"ppu/text",     "scanline", []() { return std::make_unique<Scene>(setup_text); }});
+  kernels.push_back({"ppu/affine",   "scanline", []() { return std::make_unique<Scene>(setup_affine); }});
+  kernels.push_back({"ppu/oam",      "scanline", []() { return std::make_unique<Scene>(setup_oam); }});
+  kernels.push_back({"ppu/compose",  "scanline", []() { return std::make_unique<Scene>(setup_compose); }});
+}
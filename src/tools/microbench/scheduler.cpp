@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <emulator/core/scheduler.hpp>
+#include <iterator>
+
+#include "kernel.hpp"
+
+using nba::core::Scheduler;
+
+namespace {
+
+/**
+ * A handful of periodic event streams (scanlines, timers, audio),
+ * which are stepped the way the ARM core steps the scheduler.
+ */
+struct SchedulerPeriodic : Kernel {
+  static constexpr int kCyclesPerFrame = 280896;
+  static constexpr int kPeriods[] { 1006, 226, 4096, 512, 64, 1232, 16384, 128 };
+
+  SchedulerPeriodic() {
+    scheduler.Register(Scheduler::EventClass::TM_Overflow, [this](u64 stream) {
+      scheduler.Add(kPeriods[stream], Scheduler::EventClass::TM_Overflow, stream);
+      events++;
+    });
+
+    for (int stream = 0; stream < int(std::size(kPeriods)); stream++) {
+      scheduler.Add(kPeriods[stream], Scheduler::EventClass::TM_Overflow, stream);
+    }
+  }
+
+  auto Run() -> u64 final {
+    events = 0;
+    for (int cycles = 0; cycles < kCyclesPerFrame; cycles += 4) {
+      scheduler.AddCycles(4);
+    }
+    return events;
+  }
+
+private:
+  Scheduler scheduler;
+  u64 events;
+};
+
+/// Steps the scheduler by single cycles while no event is due.
+struct SchedulerStep : Kernel {
+  static constexpr int kSteps = 65536;
+
+  auto Run() -> u64 final {
+    scheduler.Reset();
+    for (int i = 0; i < kSteps; i++) {
+      scheduler.AddCycles(1);
+    }
+    return kSteps;
+  }
+
+private:
+  Scheduler scheduler;
+};
+
+/// Adds and immediately cancels events, like a timer being reprogrammed.
+struct SchedulerAddCancel : Kernel {
+  static constexpr int kPending = 16;
+  static constexpr int kOperations = 16384;
+
+  SchedulerAddCancel() {
+    scheduler.Register(Scheduler::EventClass::TM_Overflow, [](u64) {});
+
+    for (int i = 0; i < kPending; i++) {
+      scheduler.Add(100000 + i * 977, Scheduler::EventClass::TM_Overflow);
+    }
+  }
+
+  auto Run() -> u64 final {
+    u32 delay = 1;
+
+    for (int i = 0; i < kOperations; i++) {
+      delay = (delay * 1103515245 + 12345) & 0x3FFFF;
+      scheduler.Cancel(scheduler.Add(delay, Scheduler::EventClass::TM_Overflow));
+    }
+    return kOperations;
+  }
+
+private:
+  Scheduler scheduler;
+};
+
+} // anonymous namespace
+
+void register_scheduler_kernels(std::vector<KernelInfo>& kernels) {
+  kernels.push_back({"scheduler/periodic",   "event", []() { return std::make_unique<SchedulerPeriodic>(); }});
+  kernels.push_back({"scheduler/step",       "step",  []() { return std::make_unique<SchedulerStep>(); }});
+  kernels.push_back({"scheduler/add-cancel", "pair",  []() { return std::make_unique<SchedulerAddCancel>(); }});
+}
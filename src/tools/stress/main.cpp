@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2021 fleroviux
+ *
+ * Licensed under GPLv3 or any later version.
+ * Refer to the included LICENSE file.
+ */
+
+#include <algorithm>
+#include <common/hash.hpp>
+#include <common/log.hpp>
+#include <cstdlib>
+#include <emulator/emulator.hpp>
+#include <fmt/format.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr auto kNativeWidth = 240;
+static constexpr auto kNativeHeight = 160;
+
+/// Number of frames that the pseudo-random key state is held for.
+static constexpr auto kFramesPerInput = 16;
+
+static auto g_config = std::make_shared<nba::Config>();
+static auto g_rom_path = std::string{};
+static auto g_frames = 600;
+static auto g_instances = 0;
+static auto g_rounds = 1;
+
+struct HashVideoDevice : nba::VideoDevice {
+  void Draw(u32* buffer) final {
+    hash = common::xxh64(buffer, kNativeWidth * kNativeHeight * sizeof(u32));
+  }
+
+  u64 hash = 0;
+};
+
+/// What a run leaves behind: the video hash of every frame and the final machine state.
+struct Result {
+  bool loaded = false;
+  std::vector<u64> frame_hashes;
+  std::unique_ptr<nba::SaveState> state = std::make_unique<nba::SaveState>();
+};
+
+void usage(char* app_name) {
+  fmt::print("Usage: {0} [--bios bios_path] [--skip-bios] [--frames count] [--instances count] [--rounds count] rom_path\n", app_name);
+  fmt::print("\nRuns the game once on its own and then on many emulator instances on parallel threads,\n"
+             "with the same pseudo-random input, and checks that every instance produced the same\n"
+             "frames and final state as the single run.\n");
+  std::exit(-1);
+}
+
+void parse_arguments(int argc, char** argv) {
+  auto i = 1;
+
+  auto next = [&]() -> std::string {
+    if (i == argc) {
+      usage(argv[0]);
+    }
+    return argv[i++];
+  };
+
+  while (i < argc) {
+    auto key = std::string{argv[i++]};
+    if (key == "--bios") {
+      g_config->bios_path = next();
+    } else if (key == "--skip-bios") {
+      g_config->skip_bios = true;
+    } else if (key == "--frames") {
+      g_frames = std::atoi(next().c_str());
+    } else if (key == "--instances") {
+      g_instances = std::atoi(next().c_str());
+    } else if (key == "--rounds") {
+      g_rounds = std::atoi(next().c_str());
+    } else if (key.rfind("--", 0) == 0 || !g_rom_path.empty()) {
+      usage(argv[0]);
+    } else {
+      g_rom_path = key;
+    }
+  }
+
+  if (g_rom_path.empty() || g_frames <= 0 || g_instances < 0 || g_rounds <= 0) {
+    usage(argv[0]);
+  }
+}
+
+/// KEYINPUT value (active low) for a frame, the same for every run.
+auto get_keyinput(int frame) -> u16 {
+  auto period = u64(frame / kFramesPerInput);
+  return u16(common::xxh64(&period, sizeof(period)) & 0x3FF);
+}
+
+void run_instance(Result& result) {
+  auto config = std::make_shared<nba::Config>(*g_config);
+  auto video_dev = std::make_shared<HashVideoDevice>();
+
+  config->audio_dev = std::make_shared<nba::NullAudioDevice>();
+  config->input_dev = std::make_shared<nba::NullInputDevice>();
+  config->video_dev = video_dev;
+
+  // Keep the log quiet, only the outcome of the comparison matters.
+  common::logger::set_thread_sink([](common::logger::Level, std::string const&) { });
+
+  auto emulator = std::make_unique<nba::Emulator>(config);
+
+  if (emulator->LoadGame(g_rom_path) == nba::Emulator::StatusCode::Ok) {
+    emulator->Reset();
+
+    result.frame_hashes.reserve(g_frames);
+
+    for (int frame = 0; frame < g_frames; frame++) {
+      if (frame % kFramesPerInput == 0) {
+        emulator->QueueInput(get_keyinput(frame));
+      }
+      emulator->Frame();
+      result.frame_hashes.push_back(video_dev->hash);
+    }
+
+    emulator->CopyState(*result.state);
+    result.loaded = true;
+  }
+
+  common::logger::set_thread_sink({});
+}
+
+/// Returns an empty string if the instance matches the reference run, otherwise what differs.
+auto compare(Result const& reference, Result const& result) -> std::string {
+  if (!result.loaded) {
+    return "cannot load ROM";
+  }
+
+  auto mismatch = std::mismatch(reference.frame_hashes.begin(), reference.frame_hashes.end(), result.frame_hashes.begin());
+  if (mismatch.first != reference.frame_hashes.end()) {
+    return fmt::format("video differs first at frame {0}", mismatch.first - reference.frame_hashes.begin());
+  }
+
+  auto a = (u8 const*)reference.state.get();
+  auto b = (u8 const*)result.state.get();
+  auto offset = std::mismatch(a, a + sizeof(nba::SaveState), b).first - a;
+  if (offset != sizeof(nba::SaveState)) {
+    return fmt::format("final state differs first at byte 0x{0:X}", offset);
+  }
+
+  return "";
+}
+
+int main(int argc, char** argv) {
+  common::logger::init();
+  parse_arguments(argc, argv);
+
+  auto instances = g_instances > 0 ? g_instances : std::max(2, int(std::thread::hardware_concurrency()));
+
+  // Every instance must start from an erased backup and the same clock (2001-01-01 00:00:00 UTC).
+  g_config->memory_save = true;
+  g_config->rtc_base_time = 978307200;
+  g_config->analysis_cache_path = "";
+  g_config->rewind.enable = false;
+  g_config->run_ahead = 0;
+
+  auto reference = Result{};
+
+  run_instance(reference);
+  if (!reference.loaded) {
+    fmt::print("Cannot load ROM: {0}\n", g_rom_path);
+    return -2;
+  }
+
+  auto failures = 0;
+
+  for (int round = 0; round < g_rounds; round++) {
+    auto results = std::vector<Result>(instances);
+    auto threads = std::vector<std::thread>{};
+
+    for (auto& result : results) {
+      threads.emplace_back(run_instance, std::ref(result));
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    for (int i = 0; i < instances; i++) {
+      auto difference = compare(reference, results[i]);
+      if (!difference.empty()) {
+        fmt::print("{0}: round {1}, instance {2}: {3}.\n", g_rom_path, round, i, difference);
+        failures++;
+      }
+    }
+  }
+
+  fmt::print("{0}: {1} round(s) of {2} instance(s) for {3} frames, {4} differed from the single run.\n",
+    g_rom_path, g_rounds, instances, g_frames, failures);
+  return failures == 0 ? 0 : 1;
+}